@@ -22,4 +22,25 @@
 #define P2P_REGISTRY_URL "https://your-registry.workers.dev"
 #define P2P_NETWORK_KEY "your-network-secret"
 
+// LAN peer sharing (UDP multicast 239.255.83.84:45454, works without the registry)
+// Tickers on the same network answer each other's quote lookups directly.
+// Every datagram is signed with P2P_NETWORK_KEY above (HMAC-SHA256), which
+// keeps separate groups apart and stops other LAN hosts from injecting
+// quotes. Set your own key before enabling this; the LAN transport won't
+// start with an empty key or the placeholder above.
+#define P2P_LAN_ENABLED false
+
+// Firmware sharing over the LAN (needs P2P_LAN_ENABLED): one ticker per
+// network downloads a release from GitHub and the rest fetch it from
+// each other. A ticker only installs or serves an image signed with your
+// release key, so paste that key's public half here; generate it with
+// tools/sign_firmware.py --pubkey. Without it every ticker uses GitHub.
+// #define LAN_OTA_PUBLIC_KEY "-----BEGIN PUBLIC KEY-----\n...\n-----END PUBLIC KEY-----\n"
+
+// Video wall (optional, needs P2P_LAN_ENABLED): displays with the same name
+// share a LAN clock and flip their rotation together. Give them the same
+// rotation list and interval; WALL_POSITION offsets each display into it.
+// #define WALL_NAME "lobby"
+// #define WALL_POSITION 0
+
 #endif
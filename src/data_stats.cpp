@@ -0,0 +1,85 @@
+// data_stats.cpp - Provider/cache counters and JSON snapshot (see data_stats.h)
+
+#include "data_stats.h"
+#include "sys_health.h"
+
+#include <ArduinoJson.h>
+
+ProviderStats providerStats[PROVIDER_COUNT];
+CacheStats cacheStats[CACHE_COUNT];
+
+static const char *const PROVIDER_NAMES[PROVIDER_COUNT] = {
+  "twelvedata_quote", "twelvedata_time_series", "finnhub", "polygon", "p2p_registry", "github"
+};
+
+static const char *const CACHE_NAMES[CACHE_COUNT] = {
+  "quote", "one_month", "p2p", "lan_peer", "symbol_table", "price_history"
+};
+
+static void atomicMax(std::atomic<uint32_t> &target, uint32_t value) {
+  uint32_t prev = target.load(std::memory_order_relaxed);
+  while (value > prev && !target.compare_exchange_weak(prev, value, std::memory_order_relaxed)) {
+  }
+}
+
+void dataStatsRecordCall(DataProvider provider, int httpCode, uint32_t latencyMs,
+                         size_t bytesIn, size_t bytesOut) {
+  if (provider >= PROVIDER_COUNT) return;
+  ProviderStats &s = providerStats[provider];
+  s.calls.fetch_add(1, std::memory_order_relaxed);
+  // 304 is a conditional GET that found nothing new, not a failure
+  if ((httpCode < 200 || httpCode >= 300) && httpCode != 304) s.errors.fetch_add(1, std::memory_order_relaxed);
+  s.bytesIn.fetch_add((uint32_t)bytesIn, std::memory_order_relaxed);
+  s.bytesOut.fetch_add((uint32_t)bytesOut, std::memory_order_relaxed);
+  s.latencyTotalMs.fetch_add(latencyMs, std::memory_order_relaxed);
+  atomicMax(s.latencyMaxMs, latencyMs);
+
+  uint8_t bucket = 0;
+  while (bucket < DATA_STATS_LATENCY_BUCKETS - 1 && latencyMs > DATA_STATS_LATENCY_BOUNDS_MS[bucket]) bucket++;
+  s.latency[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+String dataStatsJson() {
+  JsonDocument doc;
+  doc["uptimeSec"] = millis() / 1000;
+  doc["freeHeap"] = ESP.getFreeHeap();
+
+  JsonArray bounds = doc["latencyBucketsMs"].to<JsonArray>();
+  for (uint8_t i = 0; i < DATA_STATS_LATENCY_BUCKETS - 1; i++) bounds.add(DATA_STATS_LATENCY_BOUNDS_MS[i]);
+
+  JsonObject providers = doc["providers"].to<JsonObject>();
+  for (uint8_t p = 0; p < PROVIDER_COUNT; p++) {
+    const ProviderStats &s = providerStats[p];
+    JsonObject o = providers[PROVIDER_NAMES[p]].to<JsonObject>();
+    uint32_t calls = s.calls.load(std::memory_order_relaxed);
+    o["calls"] = calls;
+    o["errors"] = s.errors.load(std::memory_order_relaxed);
+    o["bytesIn"] = s.bytesIn.load(std::memory_order_relaxed);
+    o["bytesOut"] = s.bytesOut.load(std::memory_order_relaxed);
+    o["latencyAvgMs"] = calls ? s.latencyTotalMs.load(std::memory_order_relaxed) / calls : 0;
+    o["latencyMaxMs"] = s.latencyMaxMs.load(std::memory_order_relaxed);
+    JsonArray hist = o["latencyHist"].to<JsonArray>();
+    for (uint8_t b = 0; b < DATA_STATS_LATENCY_BUCKETS; b++) hist.add(s.latency[b].load(std::memory_order_relaxed));
+  }
+
+  JsonObject caches = doc["caches"].to<JsonObject>();
+  for (uint8_t c = 0; c < CACHE_COUNT; c++) {
+    const CacheStats &s = cacheStats[c];
+    JsonObject o = caches[CACHE_NAMES[c]].to<JsonObject>();
+    uint32_t hits = s.hits.load(std::memory_order_relaxed);
+    uint32_t misses = s.misses.load(std::memory_order_relaxed);
+    o["hits"] = hits;
+    o["misses"] = misses;
+    o["hitRate"] = (hits + misses) ? (float)hits / (float)(hits + misses) : 0.0f;
+    o["inserts"] = s.inserts.load(std::memory_order_relaxed);
+    o["evictions"] = s.evictions.load(std::memory_order_relaxed);
+    o["bytes"] = s.bytes.load(std::memory_order_relaxed);
+  }
+
+  // Heap regions, TLS buffers, LVGL lock and per-task CPU (sys_health.h)
+  sysHealthJson(doc["system"].to<JsonObject>());
+
+  String out;
+  serializeJson(doc, out);
+  return out;
+}
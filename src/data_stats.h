@@ -0,0 +1,98 @@
+// data_stats.h - Counters for every data provider and cache
+//
+// All counters are lock-free atomics (relaxed), so they can be bumped from any
+// task (loop, GitHub OTA task, LVGL callbacks) without taking a mutex. They
+// reset on reboot. dataStatsJson() renders a snapshot for the /stats endpoint.
+
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+
+enum DataProvider : uint8_t {
+  PROVIDER_TWELVEDATA_QUOTE = 0,
+  PROVIDER_TWELVEDATA_SERIES,
+  PROVIDER_FINNHUB,
+  PROVIDER_POLYGON,
+  PROVIDER_P2P_REGISTRY,
+  PROVIDER_GITHUB,
+  PROVIDER_COUNT
+};
+
+enum DataCache : uint8_t {
+  CACHE_QUOTE = 0,      // symbolCache (per-symbol quotes)
+  CACHE_ONE_MONTH,      // 1-month range cache
+  CACHE_P2P,            // Registry /stock lookups (network-wide cache)
+  CACHE_LAN_PEER,       // LAN peer lookups (UDP multicast)
+  CACHE_SYMBOL_TABLE,   // Flash-mapped company names
+  CACHE_PRICE_HISTORY,  // Compressed intraday history
+  CACHE_COUNT
+};
+
+// Latency histogram upper bounds in ms; the last bucket is everything slower.
+#define DATA_STATS_LATENCY_BUCKETS 7
+static const uint16_t DATA_STATS_LATENCY_BOUNDS_MS[DATA_STATS_LATENCY_BUCKETS - 1] = {
+  100, 250, 500, 1000, 2000, 5000
+};
+
+struct ProviderStats {
+  std::atomic<uint32_t> calls{0};
+  std::atomic<uint32_t> errors{0};     // Transport failures and non-2xx responses
+  std::atomic<uint32_t> bytesIn{0};    // Response payload bytes
+  std::atomic<uint32_t> bytesOut{0};   // Request body bytes
+  std::atomic<uint32_t> latencyTotalMs{0};
+  std::atomic<uint32_t> latencyMaxMs{0};
+  std::atomic<uint32_t> latency[DATA_STATS_LATENCY_BUCKETS];
+};
+
+struct CacheStats {
+  std::atomic<uint32_t> hits{0};
+  std::atomic<uint32_t> misses{0};
+  std::atomic<uint32_t> inserts{0};
+  std::atomic<uint32_t> evictions{0};  // Entries dropped or recycled to make room
+  std::atomic<uint32_t> bytes{0};      // Current footprint (gauge)
+};
+
+extern ProviderStats providerStats[PROVIDER_COUNT];
+extern CacheStats cacheStats[CACHE_COUNT];
+
+// Record one provider request. httpCode <= 0 is a transport error.
+void dataStatsRecordCall(DataProvider provider, int httpCode, uint32_t latencyMs,
+                         size_t bytesIn, size_t bytesOut = 0);
+
+inline uint32_t dataStatsCalls(DataProvider provider) {
+  return providerStats[provider].calls.load(std::memory_order_relaxed);
+}
+
+inline void dataStatsHit(DataCache cache) { cacheStats[cache].hits.fetch_add(1, std::memory_order_relaxed); }
+inline void dataStatsMiss(DataCache cache) { cacheStats[cache].misses.fetch_add(1, std::memory_order_relaxed); }
+inline void dataStatsInsert(DataCache cache) { cacheStats[cache].inserts.fetch_add(1, std::memory_order_relaxed); }
+inline void dataStatsEvict(DataCache cache, uint32_t n = 1) {
+  cacheStats[cache].evictions.fetch_add(n, std::memory_order_relaxed);
+}
+inline void dataStatsSetBytes(DataCache cache, size_t bytes) {
+  cacheStats[cache].bytes.store((uint32_t)bytes, std::memory_order_relaxed);
+}
+
+// Stream wrapper for bodies parsed straight off the socket: counts the bytes
+// the parser actually read, for bytesIn (getSize() is -1 on chunked responses).
+class DataStatsCountingStream : public Stream {
+ public:
+  DataStatsCountingStream(Stream &inner, unsigned long timeoutMs) : inner_(inner) { setTimeout(timeoutMs); }
+  int available() override { return inner_.available(); }
+  int read() override {
+    int c = inner_.read();
+    if (c >= 0) count_++;
+    return c;
+  }
+  int peek() override { return inner_.peek(); }
+  size_t write(uint8_t) override { return 0; }
+  size_t count() const { return count_; }
+
+ private:
+  Stream &inner_;
+  size_t count_ = 0;
+};
+
+// JSON snapshot: {"uptimeSec":..,"providers":{..},"caches":{..}}
+String dataStatsJson();
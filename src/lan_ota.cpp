@@ -0,0 +1,411 @@
+// lan_ota.cpp - Serve and fetch firmware images between LAN peers (see lan_ota.h)
+//
+// GET /firmware.bin without a valid proof is answered 401 with
+//   X-Firmware-Nonce:     32 hex chars, single use, valid LAN_OTA_NONCE_TTL_MS
+// and is repeated with
+//   X-Firmware-Proof:     hex HMAC-SHA256(P2P_NETWORK_KEY, nonce)
+// Response headers on the 200:
+//   Content-Length:       image length (the running app image, not the whole slot)
+//   X-Firmware-Version:   FIRMWARE_VERSION of the source
+//   X-Firmware-SHA256:    hex digest of the body
+//   X-Firmware-Signature: hex DER ECDSA signature over SHA-256("<version>:<sha256>")
+
+#include "lan_ota.h"
+
+#include <WiFi.h>
+#include <HTTPClient.h>
+#include <ESPAsyncWebServer.h>
+#include <Update.h>
+#include <Preferences.h>
+#include <esp_ota_ops.h>
+#include <esp_image_format.h>
+#include <esp_random.h>
+#include <mbedtls/sha256.h>
+#include <mbedtls/md.h>
+#include <mbedtls/pk.h>
+#include <freertos/semphr.h>
+
+#define SIG_MAX_BYTES 72            // DER-encoded ECDSA P-256 signature
+#define SIG_PREFS_NS "lan_ota"
+#define SIG_PREFS_KEY "sig"
+
+// Set once by lanOtaBegin()
+static const char *lanOtaPublicKey = nullptr;
+static const char *lanOtaNetworkKey = "";
+static const char *lanOtaVersion = "";
+
+// Running image info: written once under lanOtaInfoLock, then read freely
+static volatile bool lanOtaInfoReady = false;
+static size_t lanOtaLength = 0;
+static char lanOtaSha[65];
+static char lanOtaSig[SIG_MAX_BYTES * 2 + 1];
+static bool lanOtaSigned = false;  // lanOtaSig verifies against the running image
+static StaticSemaphore_t lanOtaInfoLockBuf;
+static SemaphoreHandle_t lanOtaInfoLock = nullptr;
+static portMUX_TYPE lanOtaInfoMux = portMUX_INITIALIZER_UNLOCKED;
+
+static void toHex(const uint8_t *in, size_t len, char *out) {
+  static const char digits[] = "0123456789abcdef";
+  for (size_t i = 0; i < len; i++) {
+    out[i * 2] = digits[in[i] >> 4];
+    out[i * 2 + 1] = digits[in[i] & 0x0F];
+  }
+  out[len * 2] = '\0';
+}
+
+static int hexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+static bool fromHex(const char *hex, uint8_t *out, size_t maxLen, size_t &len) {
+  size_t n = strlen(hex);
+  if (n == 0 || n % 2 != 0 || n / 2 > maxLen) return false;
+  for (size_t i = 0; i < n; i += 2) {
+    int hi = hexValue(hex[i]);
+    int lo = hexValue(hex[i + 1]);
+    if (hi < 0 || lo < 0) return false;
+    out[i / 2] = (uint8_t)((hi << 4) | lo);
+  }
+  len = n / 2;
+  return true;
+}
+
+static void proofFor(const char *nonceHex, char proofHex[65]) {
+  uint8_t mac[32];
+  mbedtls_md_hmac(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), (const uint8_t *)lanOtaNetworkKey,
+                  strlen(lanOtaNetworkKey), (const uint8_t *)nonceHex, strlen(nonceHex), mac);
+  toHex(mac, sizeof(mac), proofHex);
+}
+
+// True when sigHex is the release key's signature over "<version>:<shaHex>"
+static bool signatureValid(const char *version, const char *shaHex, const char *sigHex) {
+  if (lanOtaPublicKey == nullptr) return false;
+  uint8_t sig[SIG_MAX_BYTES];
+  size_t sigLen;
+  if (!fromHex(sigHex, sig, sizeof(sig), sigLen)) return false;
+  String message = String(version) + ":" + shaHex;
+  uint8_t hash[32];
+  mbedtls_sha256((const uint8_t *)message.c_str(), message.length(), hash, 0);
+  mbedtls_pk_context pk;
+  mbedtls_pk_init(&pk);
+  bool ok = mbedtls_pk_parse_public_key(&pk, (const uint8_t *)lanOtaPublicKey, strlen(lanOtaPublicKey) + 1) == 0 &&
+            mbedtls_pk_verify(&pk, MBEDTLS_MD_SHA256, hash, sizeof(hash), sig, sigLen) == 0;
+  mbedtls_pk_free(&pk);
+  return ok;
+}
+
+// Compare without an early exit so response timing doesn't leak the MAC
+static bool macEquals(const String &a, const char *b) {
+  if (a.length() != strlen(b)) return false;
+  uint8_t diff = 0;
+  for (size_t i = 0; i < a.length(); i++) diff |= (uint8_t)(a[i] ^ b[i]);
+  return diff == 0;
+}
+
+// Hash the running image into lanOtaLength/lanOtaSha. Called with the info lock held.
+static bool hashRunningImage() {
+  const esp_partition_t *running = esp_ota_get_running_partition();
+  if (running == nullptr) return false;
+
+  // image_len covers segments, checksum padding and the appended digest,
+  // i.e. exactly the firmware.bin that was flashed
+  esp_partition_pos_t pos = {running->address, running->size};
+  esp_image_metadata_t meta;
+  if (esp_image_get_metadata(&pos, &meta) != ESP_OK || meta.image_len == 0) return false;
+
+  uint8_t *buf = (uint8_t *)malloc(LAN_OTA_CHUNK);
+  if (buf == nullptr) return false;
+  uint32_t startMs = millis();
+  mbedtls_sha256_context ctx;
+  mbedtls_sha256_init(&ctx);
+  mbedtls_sha256_starts(&ctx, 0);
+  bool ok = true;
+  for (size_t offset = 0; offset < meta.image_len; offset += LAN_OTA_CHUNK) {
+    size_t n = min((size_t)LAN_OTA_CHUNK, (size_t)meta.image_len - offset);
+    if (esp_partition_read(running, offset, buf, n) != ESP_OK) {
+      ok = false;
+      break;
+    }
+    mbedtls_sha256_update(&ctx, buf, n);
+  }
+  uint8_t digest[32];
+  mbedtls_sha256_finish(&ctx, digest);
+  mbedtls_sha256_free(&ctx);
+  free(buf);
+  if (!ok) return false;
+
+  lanOtaLength = meta.image_len;
+  toHex(digest, sizeof(digest), lanOtaSha);
+  Serial.printf("[LAN OTA] Running image: %u bytes, sha256 %.16s... (%lu ms)\n", (unsigned)lanOtaLength, lanOtaSha,
+                (unsigned long)(millis() - startMs));
+  return true;
+}
+
+// Load the signature the running image was installed with and check it.
+// Called with the info lock held, once the image is hashed.
+static void loadSignature() {
+  Preferences p;
+  p.begin(SIG_PREFS_NS, true);
+  String sig = p.getString(SIG_PREFS_KEY, "");
+  p.end();
+  strlcpy(lanOtaSig, sig.c_str(), sizeof(lanOtaSig));
+  lanOtaSigned = signatureValid(lanOtaVersion, lanOtaSha, lanOtaSig);
+  if (!lanOtaSigned) Serial.println("[LAN OTA] Running image has no valid release signature; not serving it");
+}
+
+bool lanOtaBegin(const char *publicKeyPem, const char *networkKey, const char *firmwareVersion) {
+  mbedtls_pk_context pk;
+  mbedtls_pk_init(&pk);
+  bool ok = publicKeyPem != nullptr &&
+            mbedtls_pk_parse_public_key(&pk, (const uint8_t *)publicKeyPem, strlen(publicKeyPem) + 1) == 0;
+  mbedtls_pk_free(&pk);
+  if (!ok) {
+    Serial.println("[LAN OTA] LAN_OTA_PUBLIC_KEY doesn't parse; LAN OTA stays off");
+    return false;
+  }
+  lanOtaPublicKey = publicKeyPem;
+  lanOtaNetworkKey = networkKey;
+  lanOtaVersion = firmwareVersion;
+  return true;
+}
+
+void lanOtaSaveSignature(const char *sigHex) {
+  Preferences p;
+  p.begin(SIG_PREFS_NS, false);
+  if (sigHex[0] == '\0') p.remove(SIG_PREFS_KEY);
+  else p.putString(SIG_PREFS_KEY, sigHex);
+  p.end();
+}
+
+// Created on first use; the first caller may be setup() or an OTA task
+static SemaphoreHandle_t infoLock() {
+  portENTER_CRITICAL(&lanOtaInfoMux);
+  if (lanOtaInfoLock == nullptr) lanOtaInfoLock = xSemaphoreCreateMutexStatic(&lanOtaInfoLockBuf);
+  portEXIT_CRITICAL(&lanOtaInfoMux);
+  return lanOtaInfoLock;
+}
+
+bool lanOtaImageInfo(size_t &length, char shaHex[65], bool wait) {
+  if (!lanOtaInfoReady) {
+    if (!wait) return false;
+    SemaphoreHandle_t lock = infoLock();
+    xSemaphoreTake(lock, portMAX_DELAY);
+    if (!lanOtaInfoReady && hashRunningImage()) {
+      loadSignature();
+      lanOtaInfoReady = true;
+    }
+    bool ready = lanOtaInfoReady;
+    xSemaphoreGive(lock);
+    if (!ready) return false;
+  }
+  length = lanOtaLength;
+  memcpy(shaHex, lanOtaSha, sizeof(lanOtaSha));
+  return true;
+}
+
+// Handed out and consumed by lanOtaServe() on the AsyncTCP task only
+struct LanOtaNonce {
+  char hex[33];
+  uint32_t issuedMs;
+};
+static LanOtaNonce lanOtaNonces[LAN_OTA_NONCES];
+static uint8_t lanOtaNextNonce = 0;
+
+static const char *issueNonce() {
+  LanOtaNonce &nonce = lanOtaNonces[lanOtaNextNonce];
+  lanOtaNextNonce = (lanOtaNextNonce + 1) % LAN_OTA_NONCES;
+  uint8_t raw[16];
+  esp_fill_random(raw, sizeof(raw));
+  toHex(raw, sizeof(raw), nonce.hex);
+  nonce.issuedMs = millis();
+  return nonce.hex;
+}
+
+// True (and the nonce is spent) when proof answers a live nonce
+static bool consumeNonce(const String &proof) {
+  if (proof.length() != 64) return false;
+  for (LanOtaNonce &nonce : lanOtaNonces) {
+    if (nonce.hex[0] == '\0' || millis() - nonce.issuedMs > LAN_OTA_NONCE_TTL_MS) continue;
+    char expected[65];
+    proofFor(nonce.hex, expected);
+    if (macEquals(proof, expected)) {
+      nonce.hex[0] = '\0';
+      return true;
+    }
+  }
+  return false;
+}
+
+void lanOtaServe(AsyncWebServerRequest *request) {
+  size_t length;
+  char sha[65];
+  const esp_partition_t *running = esp_ota_get_running_partition();
+  if (running == nullptr || !lanOtaImageInfo(length, sha, false) || !lanOtaSigned) {
+    request->send(503, "text/plain", "Firmware image unavailable");
+    return;
+  }
+  if (!consumeNonce(request->header("X-Firmware-Proof"))) {
+    AsyncWebServerResponse *challenge = request->beginResponse(401, "text/plain", "Proof required");
+    challenge->addHeader("X-Firmware-Nonce", issueNonce());
+    request->send(challenge);
+    return;
+  }
+
+  // The filler reads straight into the response's send buffer; the peer's
+  // TCP window decides how fast it is called
+  String peer = request->client()->remoteIP().toString();
+  uint32_t startMs = millis();
+  AsyncWebServerResponse *response = request->beginResponse("application/octet-stream", length,
+    [running, length, peer, startMs](uint8_t *buf, size_t maxLen, size_t index) -> size_t {
+      size_t n = min(maxLen, length - index);
+      if (esp_partition_read(running, index, buf, n) != ESP_OK) {
+        Serial.printf("[LAN OTA] Flash read failed at %u; dropping %s\n", (unsigned)index, peer.c_str());
+        return 0;
+      }
+      if (index + n == length) {
+        Serial.printf("[LAN OTA] Served %u bytes to %s in %lu ms\n", (unsigned)length, peer.c_str(),
+                      (unsigned long)(millis() - startMs));
+      }
+      return n;
+    });
+  response->addHeader("X-Firmware-Version", lanOtaVersion);
+  response->addHeader("X-Firmware-SHA256", sha);
+  response->addHeader("X-Firmware-Signature", lanOtaSig);
+  request->send(response);
+}
+
+// GET the image, with a proof of the network key when there is one; returns
+// the HTTP code (negative when the request couldn't be made)
+static int requestImage(HTTPClient &http, const IPAddress &peer, const char *proof) {
+  http.useHTTP10(true);  // Plain body, no chunk framing to strip
+  http.setConnectTimeout(5000);
+  http.setTimeout(LAN_OTA_DATA_TIMEOUT_MS);
+  if (!http.begin(String("http://") + peer.toString() + LAN_OTA_PATH)) return -1;
+  const char *headerKeys[] = {"X-Firmware-Version", "X-Firmware-SHA256", "X-Firmware-Signature", "X-Firmware-Nonce"};
+  http.collectHeaders(headerKeys, 4);
+  if (proof != nullptr) http.addHeader("X-Firmware-Proof", proof);
+  return http.GET();
+}
+
+LanOtaResult lanOtaDownload(const IPAddress &peer, const char *version, LanOtaProgressFn progress) {
+  if (lanOtaPublicKey == nullptr) return LAN_OTA_AUTH_FAILED;
+
+  HTTPClient http;
+  int code = requestImage(http, peer, nullptr);
+  if (code == 401) {
+    // Answer the source's nonce to show we hold the network key
+    String nonce = http.header("X-Firmware-Nonce");
+    http.end();
+    char proof[65];
+    proofFor(nonce.c_str(), proof);
+    code = nonce.length() == 32 ? requestImage(http, peer, proof) : 401;
+  }
+  int length = http.getSize();
+  if (code != 200 || length <= 0) {
+    Serial.printf("[LAN OTA] GET from %s failed: HTTP %d, length %d\n", peer.toString().c_str(), code, length);
+    http.end();
+    return code == 401 ? LAN_OTA_AUTH_FAILED : LAN_OTA_HTTP_ERROR;
+  }
+
+  String servedVersion = http.header("X-Firmware-Version");
+  String sha = http.header("X-Firmware-SHA256");
+  sha.toLowerCase();
+  String signature = http.header("X-Firmware-Signature");
+  if (servedVersion != version || sha.length() != 64 ||
+      !signatureValid(servedVersion.c_str(), sha.c_str(), signature.c_str())) {
+    Serial.printf("[LAN OTA] %s served v%s without a valid release signature; ignoring it\n",
+                  peer.toString().c_str(), servedVersion.c_str());
+    http.end();
+    return LAN_OTA_AUTH_FAILED;
+  }
+
+  if (!Update.begin(length)) {
+    Update.printError(Serial);
+    http.end();
+    return LAN_OTA_NO_SPACE;
+  }
+
+  uint8_t *buf = (uint8_t *)malloc(LAN_OTA_CHUNK);
+  if (buf == nullptr) {
+    Update.abort();
+    http.end();
+    return LAN_OTA_TRANSFER_FAILED;
+  }
+
+  mbedtls_sha256_context ctx;
+  mbedtls_sha256_init(&ctx);
+  mbedtls_sha256_starts(&ctx, 0);
+  WiFiClient *stream = http.getStreamPtr();
+  size_t total = (size_t)length;
+  size_t written = 0;
+  int lastPct = -1;
+  uint32_t startMs = millis();
+  uint32_t lastDataMs = startMs;
+  while (written < total) {
+    size_t available = stream->available();
+    if (available == 0) {
+      if (!stream->connected() || millis() - lastDataMs > LAN_OTA_DATA_TIMEOUT_MS) break;
+      vTaskDelay(pdMS_TO_TICKS(5));
+      continue;
+    }
+    size_t want = min(available, min((size_t)LAN_OTA_CHUNK, total - written));
+    size_t n = stream->readBytes(buf, want);
+    if (n == 0) continue;
+    lastDataMs = millis();
+    mbedtls_sha256_update(&ctx, buf, n);
+    if (Update.write(buf, n) != n) {
+      Update.printError(Serial);
+      break;
+    }
+    written += n;
+
+    int pct = (int)((written * 100ULL) / total);
+    if (progress && pct / 5 != lastPct / 5) {
+      lastPct = pct;
+      progress(written, total);
+    }
+  }
+  http.end();
+  free(buf);
+
+  uint8_t digest[32];
+  char digestHex[65];
+  mbedtls_sha256_finish(&ctx, digest);
+  mbedtls_sha256_free(&ctx);
+  toHex(digest, sizeof(digest), digestHex);
+
+  if (written != total) {
+    Serial.printf("[LAN OTA] Transfer stopped at %u/%u bytes\n", (unsigned)written, (unsigned)total);
+    Update.abort();
+    return LAN_OTA_TRANSFER_FAILED;
+  }
+  if (sha != digestHex) {
+    Serial.printf("[LAN OTA] SHA-256 mismatch (got %.16s..., expected %.16s...)\n", digestHex, sha.c_str());
+    Update.abort();
+    return LAN_OTA_VERIFY_FAILED;
+  }
+  if (!Update.end(true)) {
+    Update.printError(Serial);
+    return LAN_OTA_VERIFY_FAILED;
+  }
+  lanOtaSaveSignature(signature.c_str());  // So we can pass it on after the reboot
+  uint32_t elapsedMs = millis() - startMs;
+  Serial.printf("[LAN OTA] Installed v%s from %s: %u bytes in %lu ms (%lu KB/s)\n", version, peer.toString().c_str(),
+                (unsigned)total, (unsigned long)elapsedMs, (unsigned long)(elapsedMs ? total / elapsedMs : 0));
+  return LAN_OTA_OK;
+}
+
+const char *lanOtaResultName(LanOtaResult result) {
+  switch (result) {
+    case LAN_OTA_OK: return "ok";
+    case LAN_OTA_HTTP_ERROR: return "http error";
+    case LAN_OTA_AUTH_FAILED: return "auth failed";
+    case LAN_OTA_NO_SPACE: return "no space";
+    case LAN_OTA_TRANSFER_FAILED: return "transfer failed";
+    case LAN_OTA_VERIFY_FAILED: return "verify failed";
+  }
+  return "unknown";
+}
@@ -0,0 +1,79 @@
+// lan_ota.h - Firmware distribution between LAN peers
+//
+// Instead of every ticker downloading firmware.bin from GitHub over TLS, one
+// device per site does (the rendezvous owner of LAN_OTA_OWNER_KEY, see
+// lanPeerOwnerOf()). Update.end() verifies the image, the device boots it, and
+// its beacon then advertises the newer version. From that point it serves its
+// own running app partition at http://<ip>/firmware.bin, and peers stream the
+// image straight into Update.write() over plain HTTP. Every device that
+// updates this way becomes a source for the rest.
+//
+// Authorization: P2P_NETWORK_KEY ships inside the very image being served,
+// so it can't be what lets a peer flash one. Releases are signed offline
+// (tools/sign_firmware.py, ECDSA P-256 over SHA-256("<version>:<sha256>"))
+// and only the public key, LAN_OTA_PUBLIC_KEY, is built in. The GitHub path
+// keeps the release's signature asset; after booting the image a ticker
+// serves it only if that signature verifies against the running image, and
+// the receiver checks it before writing anything and the digest before
+// Update.end(), which also validates the ESP image's own appended hash.
+// Without the signing key nobody can get a ticker to install an image, and
+// without a public key LAN OTA stays off.
+//
+// The image also holds the API keys, so it isn't handed to just anyone on
+// the LAN: the source answers with a one-time nonce, and serves the image
+// only to a request carrying HMAC-SHA256(P2P_NETWORK_KEY, nonce).
+
+#pragma once
+
+#include <Arduino.h>
+
+class AsyncWebServerRequest;
+
+#define LAN_OTA_PATH "/firmware.bin"
+#define LAN_OTA_SIG_ASSET "firmware.bin.sig"  // Release asset written by tools/sign_firmware.py
+#define LAN_OTA_OWNER_KEY "#firmware"     // Rendezvous key electing the site's GitHub downloader
+#define LAN_OTA_CHUNK 4096
+#define LAN_OTA_DATA_TIMEOUT_MS 15000     // Abort when the source stops sending
+#define LAN_OTA_NONCES 4                  // Outstanding nonces (peers fetching at once)
+#define LAN_OTA_NONCE_TTL_MS 10000        // A nonce must be answered within this
+
+enum LanOtaResult {
+  LAN_OTA_OK,
+  LAN_OTA_HTTP_ERROR,       // Source unreachable or not serving an image
+  LAN_OTA_AUTH_FAILED,      // Wrong version, bad release signature, or our proof was refused
+  LAN_OTA_NO_SPACE,         // Update.begin() refused the size
+  LAN_OTA_TRANSFER_FAILED,  // Stall, short read or flash write error
+  LAN_OTA_VERIFY_FAILED,    // SHA-256 mismatch or Update.end() rejected the image
+};
+
+// Called every few percent while downloading.
+typedef void (*LanOtaProgressFn)(size_t written, size_t total);
+
+// Set the release public key (PEM) and the network key the other calls use.
+// Returns false, leaving LAN OTA off, when the public key doesn't parse.
+bool lanOtaBegin(const char *publicKeyPem, const char *networkKey, const char *firmwareVersion);
+
+// Length and SHA-256 (hex) of the running firmware image. Hashed once per boot
+// by the first caller; callers on other tasks wait for that hash instead of
+// reading it half-written. With wait = false, returns false unless the hash
+// is already done (for the AsyncTCP task, which must not hash or block).
+// The stored release signature is checked against it at the same time.
+bool lanOtaImageInfo(size_t &length, char shaHex[65], bool wait = true);
+
+// Keep the release signature (hex DER) of the image just installed, so it can
+// be served after the reboot. An empty string forgets the old one.
+void lanOtaSaveSignature(const char *sigHex);
+
+// Async web server handler for LAN_OTA_PATH: stream the running image to a
+// peer that proved the network key, or answer 401 with a fresh nonce. 503
+// unless the running image carries a valid release signature. The body is
+// read from flash as the TCP window opens, so other requests keep being
+// served during the transfer.
+void lanOtaServe(AsyncWebServerRequest *request);
+
+// Fetch `version` from a peer and install it into the next OTA slot. On
+// LAN_OTA_OK the new image is set to boot, with its signature saved; the
+// caller restarts.
+LanOtaResult lanOtaDownload(const IPAddress &peer, const char *version, LanOtaProgressFn progress);
+
+const char *lanOtaResultName(LanOtaResult result);
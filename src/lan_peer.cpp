@@ -0,0 +1,561 @@
+// lan_peer.cpp - UDP multicast peer discovery and quote lookups (see lan_peer.h)
+//
+// Messages are small MessagePack maps (one per datagram), shown here as JSON:
+//   {"v":2,"t":"hello","n":node,"k":net,"fw":"1.9.82","s":12,"w":["AAPL","MSFT"]}
+//   {"v":2,"t":"q","n":node,"k":net,"id":7,"sym":"AAPL","age":900}
+//   {"v":2,"t":"quote","n":node,"k":net,"id":7,"q":[...]}   (unicast reply, p2p_wire.h layout)
+//   {"v":2,"t":"push","n":node,"k":net,"q":[...]}           (unicast to each watcher)
+//   {"v":2,"t":"ts","n":node,"k":net,"id":3,"a":t0}         (clock sample, unicast to the wall reference)
+//   {"v":2,"t":"tr","n":node,"k":net,"id":3,"a":t0,"b":t1,"c":t2}   (reply: wall time at receive/send)
+// Beacons of wall members also carry "g":"<wall name>", plus "ws":true once
+// they hold the wall time.
+//
+// Every datagram ends with LAN_PEER_MAC_LEN bytes of HMAC-SHA256(P2P_NETWORK_KEY,
+// msgpack), checked before the message is parsed. "k" (a hash of the key)
+// stays as a cheap filter for other networks on the same group.
+
+#include "lan_peer.h"
+
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include <ESPmDNS.h>
+#include <ArduinoJson.h>
+#include <esp_timer.h>
+#include <mbedtls/md.h>
+
+static WiFiUDP lanUdp;
+static bool lanActive = false;
+static String lanNodeId;
+static uint32_t lanNetworkTag = 0;
+static String lanNetworkKey;
+static String lanFirmware;
+static LanPeerCallbacks lanCallbacks = {};
+static uint32_t lanLastBeaconMs = 0;
+static uint16_t lanNextQueryId = 1;
+
+static LanPeer lanPeers[LAN_PEER_MAX_PEERS];
+static int lanPeerTotal = 0;
+
+// Video wall clock: wall time = esp_timer_get_time() + lanWallOffsetUs
+static char lanWall[LAN_WALL_NAME_LEN] = "";
+static int64_t lanWallOffsetUs = 0;
+static bool lanWallAnchored = false;   // Offset seeded from NTP
+static bool lanWallFollowed = false;   // Offset has come from a reference at least once
+static bool lanWallHeld = false;       // Our offset is the wall's time (followed it, or started it)
+static uint32_t lanWallJoinedMs = 0;
+static char lanWallLeaderId[16] = "";  // Reference the samples below were taken against
+static int64_t lanWallSampleOffset[LAN_WALL_SAMPLES];
+static uint32_t lanWallSampleRtt[LAN_WALL_SAMPLES];
+static int lanWallSampleCount = 0;
+static int lanWallSampleNext = 0;
+static uint32_t lanWallBestRttUs = 0;
+static uint32_t lanWallLastSampleMs = 0;
+static uint32_t lanWallLastSyncMs = 0;
+static uint16_t lanWallPendingId = 0;  // Outstanding "ts" request
+static uint16_t lanWallNextId = 1;
+
+static const IPAddress LAN_GROUP(LAN_PEER_GROUP_A, LAN_PEER_GROUP_B, LAN_PEER_GROUP_C, LAN_PEER_GROUP_D);
+
+// FNV-1a: cheap network tag so peers with a different P2P_NETWORK_KEY ignore us.
+static uint32_t fnv1a(const char *s) {
+  uint32_t h = 2166136261u;
+  while (*s) {
+    h ^= (uint8_t)*s++;
+    h *= 16777619u;
+  }
+  return h;
+}
+
+static void datagramMac(const uint8_t *data, size_t len, uint8_t mac[32]) {
+  mbedtls_md_hmac(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), (const uint8_t *)lanNetworkKey.c_str(),
+                  lanNetworkKey.length(), data, len, mac);
+}
+
+// Compare without an early exit so timing doesn't leak the MAC
+static bool datagramMacValid(const uint8_t *data, size_t len) {
+  if (len <= LAN_PEER_MAC_LEN) return false;
+  uint8_t mac[32];
+  datagramMac(data, len - LAN_PEER_MAC_LEN, mac);
+  uint8_t diff = 0;
+  for (size_t i = 0; i < LAN_PEER_MAC_LEN; i++) diff |= mac[i] ^ data[len - LAN_PEER_MAC_LEN + i];
+  return diff == 0;
+}
+
+// symbols < 0 / fw == nullptr: not carried by this message, keep what we had
+static void notePeer(const char *nodeId, IPAddress ip, const char *fw, int symbols) {
+  uint32_t now = millis();
+  int slot = -1;
+  for (int i = 0; i < lanPeerTotal; i++) {
+    if (strncmp(lanPeers[i].nodeId, nodeId, sizeof(lanPeers[i].nodeId)) == 0) {
+      slot = i;
+      break;
+    }
+  }
+  if (slot < 0) {
+    if (lanPeerTotal >= LAN_PEER_MAX_PEERS) return;
+    slot = lanPeerTotal++;
+    strlcpy(lanPeers[slot].nodeId, nodeId, sizeof(lanPeers[slot].nodeId));
+    lanPeers[slot].symbols = 0;
+    lanPeers[slot].firmware[0] = '\0';
+    lanPeers[slot].watchCount = 0;
+    lanPeers[slot].wall[0] = '\0';
+    lanPeers[slot].wallSynced = false;
+    Serial.printf("[LAN] Peer %s joined at %s\n", nodeId, ip.toString().c_str());
+  }
+  LanPeer &p = lanPeers[slot];
+  p.ip = ip;
+  p.lastSeenMs = now;
+  if (fw) strlcpy(p.firmware, fw, sizeof(p.firmware));
+  if (symbols >= 0) p.symbols = (uint16_t)symbols;
+}
+
+// Replace a peer's subscription with the watchlist from its beacon
+static void noteWatchlist(const char *nodeId, JsonArrayConst watch) {
+  for (int i = 0; i < lanPeerTotal; i++) {
+    LanPeer &p = lanPeers[i];
+    if (strncmp(p.nodeId, nodeId, sizeof(p.nodeId)) != 0) continue;
+    p.watchCount = 0;
+    for (JsonVariantConst sym : watch) {
+      if (p.watchCount >= LAN_PEER_MAX_WATCH) break;
+      const char *s = sym | "";
+      if (s[0]) strlcpy(p.watch[p.watchCount++], s, LAN_PEER_SYMBOL_LEN);
+    }
+    return;
+  }
+}
+
+static void noteWall(const char *nodeId, const char *wall, bool synced) {
+  for (int i = 0; i < lanPeerTotal; i++) {
+    if (strncmp(lanPeers[i].nodeId, nodeId, sizeof(lanPeers[i].nodeId)) == 0) {
+      strlcpy(lanPeers[i].wall, wall, sizeof(lanPeers[i].wall));
+      lanPeers[i].wallSynced = wall[0] && synced;
+      return;
+    }
+  }
+}
+
+static bool peerWatches(const LanPeer &p, const char *symbol) {
+  for (int i = 0; i < p.watchCount; i++) {
+    if (strcmp(p.watch[i], symbol) == 0) return true;
+  }
+  return false;
+}
+
+static bool leaseLive(const LanPeer &p, uint32_t now) {
+  return now - p.lastSeenMs <= LAN_PEER_LEASE_MS;
+}
+
+// Rendezvous (highest random weight) score of a node for a symbol. FNV-1a over
+// "node:symbol", then a murmur3 finalizer so similar IDs spread evenly.
+static uint32_t ownerScore(const char *nodeId, const char *symbol) {
+  uint32_t h = 2166136261u;
+  for (const char *c = nodeId; *c; c++) h = (h ^ (uint8_t)*c) * 16777619u;
+  h = (h ^ ':') * 16777619u;
+  for (const char *c = symbol; *c; c++) h = (h ^ (uint8_t)*c) * 16777619u;
+  h ^= h >> 16;
+  h *= 0x85ebca6bu;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35u;
+  h ^= h >> 16;
+  return h;
+}
+
+static void expirePeers() {
+  uint32_t now = millis();
+  for (int i = 0; i < lanPeerTotal;) {
+    if (now - lanPeers[i].lastSeenMs > LAN_PEER_EXPIRY_MS) {
+      Serial.printf("[LAN] Peer %s expired\n", lanPeers[i].nodeId);
+      lanPeers[i] = lanPeers[--lanPeerTotal];
+    } else {
+      i++;
+    }
+  }
+}
+
+static void stampHeader(JsonDocument &doc, const char *type) {
+  doc["v"] = P2P_WIRE_V2_MSGPACK;
+  doc["t"] = type;
+  doc["n"] = lanNodeId;
+  doc["k"] = lanNetworkTag;
+}
+
+static void sendDoc(const JsonDocument &doc, IPAddress ip, uint16_t port) {
+  uint8_t buf[LAN_PEER_MAX_PACKET];
+  size_t len = serializeMsgPack(doc, buf, sizeof(buf) - LAN_PEER_MAC_LEN);
+  if (len == 0 || len >= sizeof(buf) - LAN_PEER_MAC_LEN) return;
+  uint8_t mac[32];
+  datagramMac(buf, len, mac);
+  memcpy(buf + len, mac, LAN_PEER_MAC_LEN);
+  lanUdp.beginPacket(ip, port);
+  lanUdp.write(buf, len + LAN_PEER_MAC_LEN);
+  lanUdp.endPacket();
+}
+
+static void sendBeacon() {
+  JsonDocument doc;
+  stampHeader(doc, "hello");
+  doc["fw"] = lanFirmware;
+  doc["s"] = lanCallbacks.symbolCount ? lanCallbacks.symbolCount() : 0;
+  if (lanCallbacks.watchlist) {
+    const char *symbols[LAN_PEER_MAX_WATCH];
+    int count = lanCallbacks.watchlist(symbols, LAN_PEER_MAX_WATCH);
+    JsonArray watch = doc["w"].to<JsonArray>();
+    for (int i = 0; i < count; i++) watch.add(symbols[i]);
+  }
+  if (lanWall[0]) {
+    doc["g"] = lanWall;
+    if (lanWallHeld) doc["ws"] = true;
+  }
+  sendDoc(doc, LAN_GROUP, LAN_PEER_PORT);
+  lanLastBeaconMs = millis();
+}
+
+enum LanPollResult { LAN_POLL_IDLE, LAN_POLL_HANDLED, LAN_POLL_REPLY };
+
+static void forgetWallSamples() {
+  lanWallSampleCount = 0;
+  lanWallSampleNext = 0;
+  lanWallBestRttUs = 0;
+  lanWallPendingId = 0;
+}
+
+// One four-timestamp exchange: t0/t3 are our raw timer at send/receive, t1/t2
+// the reference's wall time at receive/send. Keep the last LAN_WALL_SAMPLES
+// and steer to the one with the shortest round trip, whose two legs are the
+// most likely to be symmetric.
+static void noteWallSample(int64_t t0, int64_t t1, int64_t t2, int64_t t3) {
+  int64_t rtt = (t3 - t0) - (t2 - t1);
+  if (rtt < 0 || rtt > LAN_WALL_MAX_RTT_US) return;
+  lanWallSampleOffset[lanWallSampleNext] = ((t1 - t0) + (t2 - t3)) / 2;
+  lanWallSampleRtt[lanWallSampleNext] = (uint32_t)rtt;
+  lanWallSampleNext = (lanWallSampleNext + 1) % LAN_WALL_SAMPLES;
+  if (lanWallSampleCount < LAN_WALL_SAMPLES) lanWallSampleCount++;
+
+  int best = 0;
+  for (int i = 1; i < lanWallSampleCount; i++) {
+    if (lanWallSampleRtt[i] < lanWallSampleRtt[best]) best = i;
+  }
+  int64_t step = lanWallSampleOffset[best] - lanWallOffsetUs;
+  if (!lanWallFollowed || step > 1000 || step < -1000) {
+    Serial.printf("[WALL] Clock %s %s by %lld us (rtt %u us)\n", lanWallFollowed ? "stepped" : "locked to",
+                  lanWallLeaderId, (long long)step, lanWallSampleRtt[best]);
+  }
+  lanWallOffsetUs = lanWallSampleOffset[best];
+  lanWallBestRttUs = lanWallSampleRtt[best];
+  lanWallLastSampleMs = millis();
+  lanWallFollowed = true;
+  if (!lanWallHeld) {
+    lanWallHeld = true;
+    sendBeacon();  // Let the others know we can serve as the reference now
+  }
+}
+
+// Read and dispatch one pending datagram. If it is the reply to query `waitId`,
+// decode it into `reply` and return LAN_POLL_REPLY.
+static LanPollResult pollOnce(uint16_t waitId, PeerQuote *reply) {
+  int size = lanUdp.parsePacket();
+  if (size <= 0) return LAN_POLL_IDLE;
+  int64_t rxUs = esp_timer_get_time();  // As close to arrival as loop() lets us get
+
+  uint8_t buf[LAN_PEER_MAX_PACKET];
+  int len = lanUdp.read(buf, sizeof(buf));
+  if (len <= 0 || len > (int)sizeof(buf) || !datagramMacValid(buf, len)) return LAN_POLL_HANDLED;
+  IPAddress from = lanUdp.remoteIP();
+  uint16_t fromPort = lanUdp.remotePort();
+
+  JsonDocument doc;
+  if (deserializeMsgPack(doc, buf, len - LAN_PEER_MAC_LEN)) return LAN_POLL_HANDLED;
+  if ((doc["v"] | 0) != P2P_WIRE_V2_MSGPACK || (doc["k"] | 0u) != lanNetworkTag) return LAN_POLL_HANDLED;
+  const char *node = doc["n"] | "";
+  if (lanNodeId == node) return LAN_POLL_HANDLED;  // Our own multicast looped back
+
+  const char *type = doc["t"] | "";
+  if (strcmp(type, "hello") == 0) {
+    notePeer(node, from, doc["fw"] | "", doc["s"] | 0);
+    noteWatchlist(node, doc["w"].as<JsonArrayConst>());
+    noteWall(node, doc["g"] | "", doc["ws"] | false);
+  } else if (strcmp(type, "q") == 0) {
+    PeerQuote quote;
+    memset(&quote, 0, sizeof(quote));
+    const char *sym = doc["sym"] | "";
+    if (lanCallbacks.lookup && sym[0] && lanCallbacks.lookup(sym, doc["age"] | 0u, quote)) {
+      JsonDocument resp;
+      stampHeader(resp, "quote");
+      resp["id"] = doc["id"] | 0;
+      p2pWireEncodeQuote(resp["q"].to<JsonArray>(), quote, true);
+      sendDoc(resp, from, fromPort);
+    }
+  } else if (strcmp(type, "quote") == 0) {
+    notePeer(node, from, nullptr, -1);
+    if (reply && (doc["id"] | 0) == waitId) {
+      if (!p2pWireDecodeQuote(doc["q"].as<JsonArrayConst>(), *reply)) return LAN_POLL_HANDLED;
+      return LAN_POLL_REPLY;
+    }
+  } else if (strcmp(type, "push") == 0) {
+    notePeer(node, from, nullptr, -1);
+    PeerQuote quote;
+    if (lanCallbacks.onPush && p2pWireDecodeQuote(doc["q"].as<JsonArrayConst>(), quote)) {
+      lanCallbacks.onPush(quote);
+    }
+  } else if (strcmp(type, "ts") == 0) {
+    if (!lanWall[0]) return LAN_POLL_HANDLED;
+    JsonDocument resp;
+    stampHeader(resp, "tr");
+    resp["id"] = doc["id"] | 0;
+    resp["a"] = doc["a"] | (int64_t)0;
+    resp["b"] = rxUs + lanWallOffsetUs;
+    resp["c"] = esp_timer_get_time() + lanWallOffsetUs;
+    sendDoc(resp, from, fromPort);
+  } else if (strcmp(type, "tr") == 0) {
+    if (lanWallPendingId == 0 || (doc["id"] | 0) != lanWallPendingId) return LAN_POLL_HANDLED;
+    lanWallPendingId = 0;
+    noteWallSample(doc["a"] | (int64_t)0, doc["b"] | (int64_t)0, doc["c"] | (int64_t)0, rxUs);
+  }
+  return LAN_POLL_HANDLED;
+}
+
+bool lanPeerBegin(const String &nodeId, const char *networkKey, const char *firmwareVersion,
+                  const LanPeerCallbacks &callbacks) {
+  if (lanActive) return true;
+  if (networkKey == nullptr || networkKey[0] == '\0' || strcmp(networkKey, LAN_PEER_PLACEHOLDER_KEY) == 0) {
+    static bool warned = false;  // Called again every few seconds; say it once
+    if (!warned) Serial.println("[LAN] Not starting: set P2P_NETWORK_KEY in config.h to your own secret");
+    warned = true;
+    return false;
+  }
+  if (WiFi.status() != WL_CONNECTED) return false;
+
+  if (!lanUdp.beginMulticast(LAN_GROUP, LAN_PEER_PORT)) {
+    Serial.println("[LAN] Multicast join failed");
+    return false;
+  }
+  lanNodeId = nodeId;
+  lanNetworkTag = fnv1a(networkKey);
+  lanNetworkKey = networkKey;
+  lanFirmware = firmwareVersion;
+  lanCallbacks = callbacks;
+  lanActive = true;
+
+  // Harmless if mDNS isn't running yet; it's only for discovery tooling.
+  MDNS.addService("stockticker", "udp", LAN_PEER_PORT);
+
+  sendBeacon();
+  Serial.printf("[LAN] Peer transport up on %d.%d.%d.%d:%d as %s\n", LAN_PEER_GROUP_A, LAN_PEER_GROUP_B,
+                LAN_PEER_GROUP_C, LAN_PEER_GROUP_D, LAN_PEER_PORT, lanNodeId.c_str());
+  return true;
+}
+
+bool lanPeerActive() {
+  return lanActive;
+}
+
+void lanPeerAnnounce() {
+  if (lanActive) sendBeacon();
+}
+
+// Take one clock sample from the wall reference, waiting briefly for the
+// reply so its receive timestamp isn't delayed by the rest of loop()
+static void wallSyncTick() {
+  if (!lanWall[0] || millis() - lanWallLastSyncMs < LAN_WALL_SYNC_MS) return;
+  lanWallLastSyncMs = millis();
+
+  const LanPeer *leader = lanPeerWallLeader();
+  if (leader == nullptr) {
+    // We are the reference; keep the offset we had so the wall doesn't jump
+    if (lanWallLeaderId[0]) Serial.println("[WALL] Now the clock reference");
+    lanWallLeaderId[0] = '\0';
+    forgetWallSamples();
+    return;
+  }
+  if (strcmp(leader->nodeId, lanWallLeaderId) != 0) {
+    strlcpy(lanWallLeaderId, leader->nodeId, sizeof(lanWallLeaderId));
+    forgetWallSamples();
+  }
+
+  uint16_t id = lanWallNextId++;
+  if (lanWallNextId == 0) lanWallNextId = 1;
+  JsonDocument doc;
+  stampHeader(doc, "ts");
+  doc["id"] = id;
+  lanWallPendingId = id;
+  doc["a"] = esp_timer_get_time();
+  sendDoc(doc, leader->ip, LAN_PEER_PORT);
+
+  uint32_t start = millis();
+  while (lanWallPendingId == id && millis() - start < LAN_WALL_SYNC_WAIT_MS) {
+    if (pollOnce(0, nullptr) == LAN_POLL_IDLE) delayMicroseconds(200);
+  }
+  lanWallPendingId = 0;
+}
+
+void lanPeerTick() {
+  if (!lanActive) return;
+  // Bounded so a chatty LAN can't starve loop()
+  for (int i = 0; i < 8; i++) {
+    if (pollOnce(0, nullptr) == LAN_POLL_IDLE) break;
+  }
+  if (millis() - lanLastBeaconMs >= LAN_PEER_BEACON_MS) {
+    sendBeacon();
+    expirePeers();
+  }
+  wallSyncTick();
+}
+
+bool lanPeerQuery(const char *symbol, uint32_t maxAgeSec, PeerQuote &out) {
+  if (!lanActive || lanPeerTotal == 0) return false;
+
+  uint16_t id = lanNextQueryId++;
+  if (lanNextQueryId == 0) lanNextQueryId = 1;
+
+  JsonDocument doc;
+  stampHeader(doc, "q");
+  doc["id"] = id;
+  doc["sym"] = symbol;
+  doc["age"] = maxAgeSec;
+  sendDoc(doc, LAN_GROUP, LAN_PEER_PORT);
+
+  uint32_t start = millis();
+  while (millis() - start < LAN_PEER_QUERY_TIMEOUT_MS) {
+    LanPollResult r = pollOnce(id, &out);
+    if (r == LAN_POLL_REPLY) return true;
+    if (r == LAN_POLL_IDLE) delay(2);
+  }
+  return false;
+}
+
+int lanPeerPublish(const PeerQuote &quote) {
+  if (!lanActive || lanPeerTotal == 0) return 0;
+  JsonDocument doc;
+  stampHeader(doc, "push");
+  p2pWireEncodeQuote(doc["q"].to<JsonArray>(), quote, true);
+
+  int sent = 0;
+  for (int i = 0; i < lanPeerTotal; i++) {
+    if (!peerWatches(lanPeers[i], quote.symbol)) continue;
+    sendDoc(doc, lanPeers[i].ip, LAN_PEER_PORT);
+    sent++;
+  }
+  return sent;
+}
+
+const LanPeer *lanPeerOwnerOf(const char *symbol) {
+  if (!lanActive) return nullptr;
+  uint32_t now = millis();
+  const LanPeer *owner = nullptr;
+  const char *ownerId = lanNodeId.c_str();
+  uint32_t best = ownerScore(ownerId, symbol);
+  for (int i = 0; i < lanPeerTotal; i++) {
+    const LanPeer &p = lanPeers[i];
+    if (!leaseLive(p, now)) continue;
+    uint32_t score = ownerScore(p.nodeId, symbol);
+    // Ties (practically never) go to the lower node ID so every node agrees
+    if (score > best || (score == best && strcmp(p.nodeId, ownerId) < 0)) {
+      best = score;
+      owner = &p;
+      ownerId = p.nodeId;
+    }
+  }
+  return owner;
+}
+
+int lanPeerWatchedSymbols(const char **out, int max) {
+  uint32_t now = millis();
+  int count = 0;
+  for (int i = 0; i < lanPeerTotal; i++) {
+    const LanPeer &p = lanPeers[i];
+    if (!leaseLive(p, now)) continue;
+    for (int w = 0; w < p.watchCount; w++) {
+      bool seen = false;
+      for (int j = 0; j < count && !seen; j++) seen = strcmp(out[j], p.watch[w]) == 0;
+      if (seen) continue;
+      if (count >= max) return count;
+      out[count++] = p.watch[w];
+    }
+  }
+  return count;
+}
+
+int lanPeerCount() {
+  return lanPeerTotal;
+}
+
+const LanPeer *lanPeerAt(int index) {
+  return (index >= 0 && index < lanPeerTotal) ? &lanPeers[index] : nullptr;
+}
+
+void lanPeerJoinWall(const char *wall) {
+  if (strcmp(wall, lanWall) == 0) return;
+  strlcpy(lanWall, wall, sizeof(lanWall));
+  lanWallLeaderId[0] = '\0';
+  lanWallHeld = false;
+  lanWallJoinedMs = millis();
+  forgetWallSamples();
+  if (lanActive) sendBeacon();
+}
+
+// A live member of our wall holds the wall time
+static bool wallPeerSynced() {
+  uint32_t now = millis();
+  for (int i = 0; i < lanPeerTotal; i++) {
+    const LanPeer &p = lanPeers[i];
+    if (leaseLive(p, now) && p.wallSynced && strcmp(p.wall, lanWall) == 0) return true;
+  }
+  return false;
+}
+
+const LanPeer *lanPeerWallLeader() {
+  if (!lanActive || !lanWall[0]) return nullptr;
+  uint32_t now = millis();
+  // Only members holding the wall time qualify while any does, so one that
+  // just rebooted follows the wall before it can lead it
+  bool heldOnly = lanWallHeld || wallPeerSynced();
+  const LanPeer *leader = nullptr;
+  const char *leaderId = (heldOnly && !lanWallHeld) ? nullptr : lanNodeId.c_str();
+  for (int i = 0; i < lanPeerTotal; i++) {
+    const LanPeer &p = lanPeers[i];
+    if (!leaseLive(p, now) || strcmp(p.wall, lanWall) != 0 || (heldOnly && !p.wallSynced)) continue;
+    if (leaderId == nullptr || strcmp(p.nodeId, leaderId) < 0) {
+      leader = &p;
+      leaderId = p.nodeId;
+    }
+  }
+  return leader;
+}
+
+int lanPeerWallSize() {
+  if (!lanWall[0]) return 0;
+  uint32_t now = millis();
+  int count = 1;
+  for (int i = 0; i < lanPeerTotal; i++) {
+    if (leaseLive(lanPeers[i], now) && strcmp(lanPeers[i].wall, lanWall) == 0) count++;
+  }
+  return count;
+}
+
+int64_t lanPeerWallClockUs() {
+  return esp_timer_get_time() + lanWallOffsetUs;
+}
+
+void lanPeerAnchorWallClock(int64_t epochUs) {
+  if (lanWallFollowed || (lanWall[0] && wallPeerSynced())) return;  // Follow the running wall instead
+  if (!lanWallAnchored) {
+    lanWallOffsetUs = epochUs - esp_timer_get_time();
+    lanWallAnchored = true;
+  }
+  // Give members a beacon round to show up; if none holds the wall time by
+  // then, it starts from our NTP anchor
+  if (lanWall[0] && !lanWallHeld && millis() - lanWallJoinedMs >= LAN_WALL_START_WAIT_MS) {
+    lanWallHeld = true;
+    Serial.println("[WALL] No member holds the wall time; starting it from NTP");
+    if (lanActive) sendBeacon();
+  }
+}
+
+bool lanPeerWallSynced(uint32_t *errorUs) {
+  if (errorUs) *errorUs = 0;
+  if (!lanWall[0]) return false;
+  if (lanPeerWallLeader() == nullptr) return true;
+  if (lanWallSampleCount == 0 || millis() - lanWallLastSampleMs > LAN_WALL_SAMPLE_TTL_MS) return false;
+  if (errorUs) *errorUs = lanWallBestRttUs / 2;
+  return true;
+}
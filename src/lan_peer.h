@@ -0,0 +1,145 @@
+// lan_peer.h - LAN peer discovery and quote sharing (no cloud round trip)
+//
+// Tickers on the same network find each other with UDP multicast beacons (and
+// advertise _stockticker._udp over mDNS for tooling). A quote lookup is one
+// multicast query; any peer holding fresh data answers by unicast, typically
+// within a few milliseconds. The cloud registry is only consulted when no LAN
+// peer answers before LAN_PEER_QUERY_TIMEOUT_MS.
+//
+// Beacons also carry the sender's watchlist. Whoever fetches a quote from an
+// API publishes it with lanPeerPublish(), which pushes it straight to every
+// peer watching that symbol, so one device's API call refreshes them all.
+//
+// Fetching is sharded: every symbol on any watchlist has exactly one owner,
+// elected by rendezvous hashing over the peers whose lease is live (a beacon
+// within LAN_PEER_LEASE_MS). The owner calls the APIs for it and pushes to
+// the others, so API usage scales with distinct symbols rather than devices.
+// Every node computes the same owner from the same membership, so there are no
+// election messages; when an owner's lease lapses its symbols fail over to the
+// next-ranked peer.
+//
+// Tickers mounted together as a video wall join the same wall name. The
+// member with the lowest node ID is the wall's clock reference; the others
+// sample it NTP-style (four timestamps per exchange, lowest round trip wins)
+// every LAN_WALL_SYNC_MS, so all members share a microsecond clock that main
+// schedules rotation on. Members that already hold the wall time say so in
+// their beacons and outrank those that don't, so a member coming back from
+// a reboot follows the running wall instead of re-seeding it from NTP; the
+// wall time only starts from NTP when no member holds it.
+//
+// Datagrams use the v2 MessagePack schema from p2p_wire.h, followed by a
+// truncated HMAC-SHA256 keyed with P2P_NETWORK_KEY (LAN_PEER_MAC_LEN bytes).
+// Peers drop anything whose MAC doesn't verify, so a host on the LAN without
+// the key can't push quotes, claim symbols or join a wall, and separate
+// networks sharing a LAN don't mix.
+
+#pragma once
+
+#include <Arduino.h>
+#include "p2p_wire.h"
+
+#define LAN_PEER_PORT 45454
+#define LAN_PEER_GROUP_A 239
+#define LAN_PEER_GROUP_B 255
+#define LAN_PEER_GROUP_C 83
+#define LAN_PEER_GROUP_D 84
+#define LAN_PEER_MAX_PEERS 16
+#define LAN_PEER_BEACON_MS 30000         // Announce ourselves every 30 s
+#define LAN_PEER_EXPIRY_MS 95000         // Forget peers after ~3 missed beacons
+#define LAN_PEER_QUERY_TIMEOUT_MS 150    // Wait this long for a LAN answer
+#define LAN_PEER_MAX_PACKET 768
+#define LAN_PEER_MAC_LEN 16              // Truncated HMAC-SHA256 trailer on every datagram
+#define LAN_PEER_PLACEHOLDER_KEY "your-network-secret"  // config.example.h's P2P_NETWORK_KEY
+#define LAN_PEER_LEASE_MS 75000          // Ownership lapses after ~2.5 missed beacons
+#define LAN_PEER_MAX_WATCH 20            // Symbols per subscription (matches the rotation list)
+#define LAN_PEER_SYMBOL_LEN 12
+#define LAN_WALL_NAME_LEN 16
+#define LAN_WALL_SYNC_MS 2000            // Take a clock sample from the wall reference
+#define LAN_WALL_SYNC_WAIT_MS 30         // Longest we wait for the sample's reply
+#define LAN_WALL_SAMPLES 8               // Offset comes from the best of the last 8 samples
+#define LAN_WALL_MAX_RTT_US 20000        // Slower round trips are too asymmetric to trust
+#define LAN_WALL_SAMPLE_TTL_MS 30000     // Unsynced after this long without a usable sample
+#define LAN_WALL_START_WAIT_MS 45000     // Listen this long for members holding the wall time
+
+struct LanPeer {
+  char nodeId[16];
+  IPAddress ip;
+  uint32_t lastSeenMs;
+  uint16_t symbols;  // Symbols the peer currently holds
+  char firmware[12];
+  uint8_t watchCount;
+  char watch[LAN_PEER_MAX_WATCH][LAN_PEER_SYMBOL_LEN];  // Symbols the peer displays
+  char wall[LAN_WALL_NAME_LEN];  // Video wall it belongs to ("" = none)
+  bool wallSynced;               // Holds the wall time (can serve as reference)
+};
+
+// Answer a peer's query from local data. Return false if nothing fresh enough.
+typedef bool (*LanQuoteLookupFn)(const char *symbol, uint32_t maxAgeSec, PeerQuote &out);
+// Number of symbols we hold (advertised in beacons).
+typedef uint16_t (*LanSymbolCountFn)();
+// Fill `out` with the symbols we display (our subscription); returns the count.
+typedef int (*LanWatchlistFn)(const char **out, int max);
+// A peer pushed a quote for a symbol we watch.
+typedef void (*LanQuotePushFn)(const PeerQuote &quote);
+
+struct LanPeerCallbacks {
+  LanQuoteLookupFn lookup;
+  LanSymbolCountFn symbolCount;
+  LanWatchlistFn watchlist;
+  LanQuotePushFn onPush;
+};
+
+// Refuses to start (returns false) with an empty or placeholder network key,
+// which would let anyone on the LAN sign datagrams.
+bool lanPeerBegin(const String &nodeId, const char *networkKey, const char *firmwareVersion,
+                  const LanPeerCallbacks &callbacks);
+bool lanPeerActive();
+
+// Send a beacon now (e.g. the watchlist changed) instead of waiting for the next one.
+void lanPeerAnnounce();
+
+// Poll the socket (answer queries, track beacons), send our beacon, expire peers.
+void lanPeerTick();
+
+// Ask the LAN for a quote no older than maxAgeSec. Blocks up to
+// LAN_PEER_QUERY_TIMEOUT_MS while still serving other peers' packets.
+bool lanPeerQuery(const char *symbol, uint32_t maxAgeSec, PeerQuote &out);
+
+// Push a freshly fetched quote to every peer watching its symbol.
+// Returns the number of peers it was sent to.
+int lanPeerPublish(const PeerQuote &quote);
+
+// Owner (fetch leader) of a symbol among lease-holding peers and ourselves.
+// Returns nullptr when this device owns it (including when alone on the LAN).
+const LanPeer *lanPeerOwnerOf(const char *symbol);
+
+// Union of the symbols lease-holding peers watch. Pointers stay valid until
+// the next lanPeerTick().
+int lanPeerWatchedSymbols(const char **out, int max);
+
+int lanPeerCount();
+const LanPeer *lanPeerAt(int index);
+
+// Join a video wall ("" leaves it). Members are announced in beacons.
+void lanPeerJoinWall(const char *wall);
+
+// Clock reference of our wall: the live member with the lowest node ID among
+// those holding the wall time (all members, if none does yet).
+// Returns nullptr when this device is the reference (including when alone).
+const LanPeer *lanPeerWallLeader();
+
+// Wall members with a live lease, including ourselves (0 when not on a wall).
+int lanPeerWallSize();
+
+// Shared wall time in microseconds. Before the first sync it is local time
+// seeded by lanPeerAnchorWallClock().
+int64_t lanPeerWallClockUs();
+
+// Seed the wall clock from NTP (epoch microseconds). Ignored once we have
+// followed a reference, or while another member holds the wall time, so a
+// wall never jumps to a member's coarser NTP time.
+void lanPeerAnchorWallClock(int64_t epochUs);
+
+// True when we are the reference, or have a recent low-latency sample of it.
+// errorUs is half the best round trip: the bound on our offset error.
+bool lanPeerWallSynced(uint32_t *errorUs);
@@ -20,6 +20,12 @@ static TaskHandle_t lvgl_task_handle = nullptr;
 static esp_timer_handle_t lvgl_tick_timer = NULL;
 static void *lvgl_buf[LVGL_PORT_BUFFER_NUM_MAX] = {};
 
+// Lock instrumentation; only the mutex holder touches the hold fields
+static lvgl_port_lock_stats_t lock_stats = {};
+static portMUX_TYPE lock_stats_mux = portMUX_INITIALIZER_UNLOCKED;
+static int lock_depth = 0;
+static int64_t lock_hold_start_us = 0;
+
 #if LVGL_PORT_ROTATION_DEGREE != 0
 static void *get_next_frame_buffer(LCD *lcd)
 {
@@ -812,18 +818,61 @@ bool lvgl_port_lock(int timeout_ms)
     ESP_UTILS_CHECK_NULL_RETURN(lvgl_mux, false, "LVGL mutex is not initialized");
 
     const TickType_t timeout_ticks = (timeout_ms < 0) ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
-    return (xSemaphoreTakeRecursive(lvgl_mux, timeout_ticks) == pdTRUE);
+    int64_t start_us = esp_timer_get_time();
+    bool locked = (xSemaphoreTakeRecursive(lvgl_mux, timeout_ticks) == pdTRUE);
+    int64_t now_us = esp_timer_get_time();
+    uint32_t wait_us = (uint32_t)(now_us - start_us);
+
+    portENTER_CRITICAL(&lock_stats_mux);
+    if (locked) {
+        lock_stats.locks++;
+    } else {
+        lock_stats.timeouts++;
+    }
+    lock_stats.wait_total_us += wait_us;
+    if (wait_us > lock_stats.wait_max_us) {
+        lock_stats.wait_max_us = wait_us;
+    }
+    portEXIT_CRITICAL(&lock_stats_mux);
+
+    if (locked && lock_depth++ == 0) {
+        lock_hold_start_us = now_us;
+    }
+    return locked;
 }
 
 bool lvgl_port_unlock(void)
 {
     ESP_UTILS_CHECK_NULL_RETURN(lvgl_mux, false, "LVGL mutex is not initialized");
 
+    if (lock_depth > 0 && --lock_depth == 0) {
+        uint32_t hold_us = (uint32_t)(esp_timer_get_time() - lock_hold_start_us);
+        portENTER_CRITICAL(&lock_stats_mux);
+        lock_stats.hold_total_us += hold_us;
+        bool longest = hold_us > lock_stats.hold_max_us;
+        if (longest) {
+            lock_stats.hold_max_us = hold_us;
+        }
+        portEXIT_CRITICAL(&lock_stats_mux);
+        if (longest) {
+            strlcpy(lock_stats.hold_max_task, pcTaskGetName(nullptr), sizeof(lock_stats.hold_max_task));
+        }
+    }
     xSemaphoreGiveRecursive(lvgl_mux);
 
     return true;
 }
 
+void lvgl_port_get_lock_stats(lvgl_port_lock_stats_t *stats, bool reset)
+{
+    portENTER_CRITICAL(&lock_stats_mux);
+    *stats = lock_stats;
+    if (reset) {
+        lock_stats = {};
+    }
+    portEXIT_CRITICAL(&lock_stats_mux);
+}
+
 bool lvgl_port_deinit(void)
 {
 #if !LV_TICK_CUSTOM
@@ -173,6 +173,27 @@ bool lvgl_port_lock(int timeout_ms);
  */
 bool lvgl_port_unlock(void);
 
+/**
+ * @brief LVGL mutex contention counters, accumulated in `lvgl_port_lock()`/`lvgl_port_unlock()`.
+ *
+ * Hold times are measured from the outermost lock to the matching unlock, so the LVGL task's entries
+ * are the duration of one `lv_timer_handler()` pass (rendering and flushing included).
+ */
+typedef struct {
+    uint32_t locks;             // Successful lock calls
+    uint32_t timeouts;          // Lock calls that gave up
+    uint64_t wait_total_us;
+    uint32_t wait_max_us;       // Longest time a caller waited for the mutex
+    uint64_t hold_total_us;
+    uint32_t hold_max_us;       // Longest time the mutex was held
+    char hold_max_task[16];     // Task that held it that long
+} lvgl_port_lock_stats_t;
+
+/**
+ * @brief Copy the lock counters, optionally resetting them (e.g. once per sampling interval).
+ */
+void lvgl_port_get_lock_stats(lvgl_port_lock_stats_t *stats, bool reset);
+
 /**
  * @brief Suspend the LVGL task. Call this before long operations that conflict with LVGL rendering.
  */
@@ -10,11 +10,26 @@
 #define GITHUB_REPO "dereksix/Waveshare-ESP32-S3-Touch-LCD-7-Stock-Ticker-Display"
 
 #include <Arduino.h>
+#include <atomic>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
 #include <esp_display_panel.hpp>
 #include <lvgl.h>
 #include "lvgl_v8_port.h"
+#include "symbol_table.h"
+#include "price_history.h"
+#include "data_stats.h"
+#include "lan_peer.h"
+#include "lan_ota.h"
+#include "ota_pipeline.h"
+#include "ota_session.h"
+#include "ota_inflate.h"
+#include "ota_delta.h"
+#include "ota_upload.h"
+#include "sys_health.h"
+#include "p2p_wire.h"
 #include <WiFi.h>
 #include <WiFiClientSecure.h>
 #include <HTTPClient.h>
@@ -22,12 +37,35 @@
 #include <NTPClient.h>
 #include <WiFiUdp.h>
 #include <Preferences.h>
-#include <WebServer.h>
+#include <ESPAsyncWebServer.h>
 #include <Update.h>
 #include <ESPmDNS.h>
 #include <esp_heap_caps.h>
 #include "config.h"
 
+// LAN peer sharing needs no cloud service, but trusts whoever knows
+// P2P_NETWORK_KEY; off unless config.h turns it on
+#ifndef P2P_LAN_ENABLED
+#define P2P_LAN_ENABLED false
+#endif
+
+// Passing firmware between LAN peers also needs the public half of the
+// release signing key (tools/sign_firmware.py); the network key is in every
+// image, so it can't authorize a flash. Without it each ticker uses GitHub.
+#if P2P_LAN_ENABLED && defined(LAN_OTA_PUBLIC_KEY)
+#define LAN_OTA_ENABLED true
+#else
+#define LAN_OTA_ENABLED false
+#endif
+
+// Video wall: tickers sharing a WALL_NAME rotate in lockstep over the LAN
+#ifndef WALL_NAME
+#define WALL_NAME ""
+#endif
+#ifndef WALL_POSITION
+#define WALL_POSITION 0  // Offset into the rotation list (0, 1, 2... left to right)
+#endif
+
 using namespace esp_panel::board;
 
 // WiFi logging to PC
@@ -38,8 +76,9 @@ static bool wifiLogConnected = false;
 #define WEB_LOG_LINES 50
 #define WEB_LOG_LINE_LEN 120
 static char webLogBuffer[WEB_LOG_LINES][WEB_LOG_LINE_LEN];
-static int webLogHead = 0;  // Next write position
-static int webLogCount = 0; // Number of valid entries
+static uint32_t webLogSeq = 0;  // Lines ever written; line n lives in slot n % WEB_LOG_LINES
+static TaskHandle_t webLogStreamTask = nullptr;  // Pushes new lines to /logs/stream clients
+static portMUX_TYPE webLogMux = portMUX_INITIALIZER_UNLOCKED;  // Written from several tasks, read by the web server
 
 Preferences prefs;
 WiFiUDP ntpUDP;
@@ -57,9 +96,42 @@ void webLog(const char* msg) {
   }
   
   // Copy to buffer with timestamp
-  snprintf(webLogBuffer[webLogHead], WEB_LOG_LINE_LEN, "%s%s", timestamp, msg);
-  webLogHead = (webLogHead + 1) % WEB_LOG_LINES;
-  if (webLogCount < WEB_LOG_LINES) webLogCount++;
+  char line[WEB_LOG_LINE_LEN];
+  snprintf(line, sizeof(line), "%s%s", timestamp, msg);
+  portENTER_CRITICAL(&webLogMux);
+  memcpy(webLogBuffer[webLogSeq % WEB_LOG_LINES], line, sizeof(line));
+  webLogSeq++;
+  portEXIT_CRITICAL(&webLogMux);
+  if (webLogStreamTask != nullptr) xTaskNotifyGive(webLogStreamTask);
+}
+
+// Copy the log lines out, oldest first; returns the count
+static int webLogSnapshot(char (*out)[WEB_LOG_LINE_LEN]) {
+  portENTER_CRITICAL(&webLogMux);
+  uint32_t count = webLogSeq < WEB_LOG_LINES ? webLogSeq : WEB_LOG_LINES;
+  uint32_t first = webLogSeq - count;
+  for (uint32_t i = 0; i < count; i++) memcpy(out[i], webLogBuffer[(first + i) % WEB_LOG_LINES], WEB_LOG_LINE_LEN);
+  portEXIT_CRITICAL(&webLogMux);
+  return count;
+}
+
+// Copy line `seq` out. False when it hasn't been written yet, or when it has
+// already been overwritten (`lost`).
+static bool webLogRead(uint32_t seq, char *out, bool &lost) {
+  portENTER_CRITICAL(&webLogMux);
+  lost = webLogSeq - seq > WEB_LOG_LINES && seq < webLogSeq;
+  bool ok = seq < webLogSeq && !lost;
+  if (ok) memcpy(out, webLogBuffer[seq % WEB_LOG_LINES], WEB_LOG_LINE_LEN);
+  portEXIT_CRITICAL(&webLogMux);
+  return ok;
+}
+
+// Sequence number of the oldest line still in the ring, and of the next one
+static void webLogRange(uint32_t &oldest, uint32_t &next) {
+  portENTER_CRITICAL(&webLogMux);
+  next = webLogSeq;
+  oldest = webLogSeq < WEB_LOG_LINES ? 0 : webLogSeq - WEB_LOG_LINES;
+  portEXIT_CRITICAL(&webLogMux);
 }
 
 // Log to both Serial and web log buffer
@@ -77,10 +149,113 @@ void dualLog(const char* format, ...) {
 }
 
 // OTA Web Server
-WebServer otaServer(80);
-bool otaInProgress = false;
+AsyncWebServer otaServer(80);
+std::atomic<bool> otaInProgress{false};  // Also written by the upload handler and OTA tasks
 String otaStatus = "";
 
+// Live log stream (Server-Sent Events). Each client has a cursor into the
+// web log ring; the stream task sends it whatever it hasn't seen yet, one
+// event per line with the line's sequence number + 1 as the event id, so a
+// reconnecting EventSource (Last-Event-ID) picks up where it left off.
+// A client that stops reading isn't buffered for: once its send queue is
+// full it waits, and if the ring overwrites lines it hasn't been sent, it's
+// dropped (the browser reconnects and starts again from the ring).
+#define WEB_LOG_STREAM_PATH "/logs/stream"
+#define WEB_LOG_STREAM_CLIENTS 4       // Concurrent viewers; more are refused
+#define WEB_LOG_STREAM_MAX_QUEUED 16   // Unsent events per client before it has to wait
+#define WEB_LOG_STREAM_RETRY_MS 100    // Re-check waiting clients this often
+#define WEB_LOG_STREAM_IDLE_MS 15000   // Keep-alive after this long without log lines
+
+struct WebLogStreamClient {
+  AsyncEventSourceClient *client;
+  uint32_t cursor;  // Sequence number of the next line to send
+  char ip[16];      // For log lines, saved at connect
+};
+static AsyncEventSource webLogEvents(WEB_LOG_STREAM_PATH);
+static WebLogStreamClient webLogStreamClients[WEB_LOG_STREAM_CLIENTS];
+// Guards the slots; held while sending and closing. Recursive because
+// close() may run webLogStreamDisconnect() on the closing task.
+static SemaphoreHandle_t webLogStreamLock = nullptr;
+
+static void webLogStreamConnect(AsyncEventSourceClient *client) {
+  // Resume after the last line the browser saw, else replay the whole ring
+  uint32_t oldest, next;
+  webLogRange(oldest, next);
+  uint32_t cursor = client->lastId();
+  if (cursor < oldest || cursor > next) cursor = oldest;
+
+  String ip = client->client() ? client->client()->remoteIP().toString() : String("?");
+  bool added = false;
+  xSemaphoreTakeRecursive(webLogStreamLock, portMAX_DELAY);
+  for (WebLogStreamClient &slot : webLogStreamClients) {
+    if (slot.client == nullptr) {
+      slot.client = client;
+      slot.cursor = cursor;
+      strlcpy(slot.ip, ip.c_str(), sizeof(slot.ip));
+      added = true;
+      break;
+    }
+  }
+  xSemaphoreGiveRecursive(webLogStreamLock);
+  if (!added) {
+    client->close();
+    return;
+  }
+  xTaskNotifyGive(webLogStreamTask);
+}
+
+// Also runs for the clients we close. The library frees `client` after this
+// returns, which can't happen mid-send or mid-close because both hold the lock.
+static void webLogStreamDisconnect(AsyncEventSourceClient *client) {
+  xSemaphoreTakeRecursive(webLogStreamLock, portMAX_DELAY);
+  for (WebLogStreamClient &slot : webLogStreamClients) {
+    if (slot.client == client) slot.client = nullptr;
+  }
+  xSemaphoreGiveRecursive(webLogStreamLock);
+}
+
+static void webLogStreamTaskFn(void *pv) {
+  char line[WEB_LOG_LINE_LEN];
+  TickType_t wait = pdMS_TO_TICKS(WEB_LOG_STREAM_IDLE_MS);
+  for (;;) {
+    bool idle = ulTaskNotifyTake(pdTRUE, wait) == 0 && wait == pdMS_TO_TICKS(WEB_LOG_STREAM_IDLE_MS);
+    bool waiting = false;
+
+    xSemaphoreTakeRecursive(webLogStreamLock, portMAX_DELAY);
+    for (WebLogStreamClient &slot : webLogStreamClients) {
+      if (slot.client == nullptr) continue;
+      bool lost = false;
+      while (webLogRead(slot.cursor, line, lost)) {
+        if (slot.client->packetsWaiting() >= WEB_LOG_STREAM_MAX_QUEUED) {
+          waiting = true;
+          break;
+        }
+        slot.client->send(line, nullptr, slot.cursor + 1);
+        slot.cursor++;
+      }
+      if (lost) {
+        // Closed under the lock so the library can't free it first
+        AsyncEventSourceClient *client = slot.client;
+        slot.client = nullptr;
+        Serial.printf("[Logs] Dropping slow log stream client %s\n", slot.ip);
+        client->close();
+      } else if (idle) {
+        slot.client->send("", nullptr, 0);  // Empty event: EventSource ignores it, but a dead peer shows up
+      }
+    }
+    xSemaphoreGiveRecursive(webLogStreamLock);
+    wait = pdMS_TO_TICKS(waiting ? WEB_LOG_STREAM_RETRY_MS : WEB_LOG_STREAM_IDLE_MS);
+  }
+}
+
+static void webLogStreamBegin() {
+  webLogStreamLock = xSemaphoreCreateRecursiveMutex();
+  xTaskCreatePinnedToCore(webLogStreamTaskFn, "log_stream", 3072, nullptr, 1, &webLogStreamTask, tskNO_AFFINITY);
+  webLogEvents.onConnect(webLogStreamConnect);
+  webLogEvents.onDisconnect(webLogStreamDisconnect);
+  otaServer.addHandler(&webLogEvents);
+}
+
 // GitHub OTA state
 bool pendingGitHubOTA = false;
 lv_obj_t *otaProgressPopup = nullptr;
@@ -100,16 +275,58 @@ struct GitHubOtaTaskArgs {
   char url[512];
 };
 
+// Firmware downloads resume with Range: bytes=N- into the same Update session
+#define OTA_RESUME_MAX_RETRIES 5      // Reconnects per download before giving up
+#define OTA_RESUME_STALL_MS 12000     // Reconnect after this long without data (under the 25 s supervisor)
+#define OTA_RESUME_BACKOFF_MS 2000    // First retry delay, doubled per retry
+#define OTA_RESUME_BACKOFF_MAX_MS 10000
+
+// LVGL keeps rendering during the GitHub download unless the largest
+// internal-RAM block is below OTA_LVGL_SUSPEND_BELOW_BYTES. Building with
+// -DOTA_LVGL_ALWAYS_SUSPEND (see platformio.ini) restores the old behaviour
+// of suspending it for every download.
+#define OTA_LVGL_SUSPEND_BELOW_BYTES 24576
+#define OTA_HEALTH_LOG_MS 15000         // sys_health line per stage, repeated this often while an OTA runs
+
 bool isNewerVersion(const String& remote, const String& local);
 static void githubOtaTask(void *pv);
+static bool startLanOTAFromPeer();
+#if LAN_OTA_ENABLED
+static bool lanOtaReady = false;             // LAN_OTA_PUBLIC_KEY parsed; set by setupOTA()
+static volatile int lanOtaFailureCount = 0;  // Failed LAN updates since boot
+#endif
 
 // ===== Scheduled GitHub OTA (weekly @ ~3:00 AM local time) =====
 // Uses NTPClient's configured offset, so "3:00 AM" is local-to-that-offset.
+// With LAN OTA, only the owner of LAN_OTA_OWNER_KEY goes to GitHub at 3:00;
+// the others take the release from it once it has rebooted into it (lan_ota.h)
+// and only check GitHub themselves if nothing turned up by 3:10. A peer and
+// version that failed to install isn't tried again, and after
+// AUTO_OTA_LAN_MAX_FAILURES failed LAN updates we go to GitHub right away,
+// so a broken or forged beacon can't hold the fleet back.
+#define AUTO_OTA_WINDOW_MINS 15        // 3:00-3:14
+#define AUTO_OTA_FALLBACK_MINUTE 10    // Non-owners stop waiting for a LAN source
+#define AUTO_OTA_LAN_MAX_FAILURES 2    // Failed LAN updates before going straight to GitHub
 static const char *PREFS_NS = "stock";
 static const char *PREF_AUTO_OTA_LAST_EPOCH = "auto_ota_wk";  // uint32 epoch seconds
+static const char *PREF_OTA_NO_DELTA_TAG = "ota_nodelta";    // Release whose delta failed; use the full image
+static const char *PREF_OTA_RELEASE_ETAG = "ota_etag";       // ETag of the last releases/latest response
+static const char *PREF_OTA_RELEASE_TAG = "ota_reltag";      // tag_name from that response
 
 static uint32_t lastAutoOtaSchedulerMs = 0;
 
+// Persist last-run time so we only do this weekly.
+// Use NTP-derived epoch (preferred). If NTP isn't ready, fall back to 0 and we'll try again later.
+static void markAutoOtaRun() {
+  uint32_t epoch = timeClient.getEpochTime();
+  if (epoch > 0) {
+    Preferences p;
+    p.begin(PREFS_NS, false);
+    p.putUInt(PREF_AUTO_OTA_LAST_EPOCH, epoch);
+    p.end();
+  }
+}
+
 static void startGitHubOTASilentCheckAndUpdate() {
   if (otaInProgress || githubOtaTaskHandle != nullptr) {
     return;
@@ -147,15 +364,7 @@ static void startGitHubOTASilentCheckAndUpdate() {
     return;
   }
 
-  // Persist last-run time so we only do this weekly.
-  // Use NTP-derived epoch (preferred). If NTP isn't ready, fall back to 0 and we'll try again later.
-  uint32_t epoch = timeClient.getEpochTime();
-  if (epoch > 0) {
-    Preferences p;
-    p.begin(PREFS_NS, false);
-    p.putUInt(PREF_AUTO_OTA_LAST_EPOCH, epoch);
-    p.end();
-  }
+  markAutoOtaRun();
 }
 
 static void autoOtaSchedulerTick() {
@@ -173,7 +382,7 @@ static void autoOtaSchedulerTick() {
   const int minute = timeClient.getMinutes();
 
   // Only run during a small window around 3:00 AM to tolerate loop timing.
-  const bool inWindow = (hour == 3 && minute >= 0 && minute < 5);
+  const bool inWindow = (hour == 3 && minute >= 0 && minute < AUTO_OTA_WINDOW_MINS);
   if (!inWindow) return;
 
   const uint32_t epoch = timeClient.getEpochTime();
@@ -193,6 +402,20 @@ static void autoOtaSchedulerTick() {
     return;
   }
 
+  bool githubNow = minute < 5 || minute >= AUTO_OTA_FALLBACK_MINUTE;
+#if LAN_OTA_ENABLED
+  if (!lanOtaReady) {
+    // No usable public key: update from GitHub like a standalone ticker
+  } else if (lanOtaFailureCount >= AUTO_OTA_LAN_MAX_FAILURES) {
+    githubNow = true;  // LAN sources keep failing; stop waiting on beacons
+  } else if (minute < AUTO_OTA_FALLBACK_MINUTE) {
+    if (startLanOTAFromPeer()) return;
+    const bool githubOwner = !lanPeerActive() || lanPeerOwnerOf(LAN_OTA_OWNER_KEY) == nullptr;
+    if (!githubOwner) return;  // The owner is fetching it for us
+  }
+#endif
+  if (!githubNow) return;
+
   startGitHubOTASilentCheckAndUpdate();
 }
 
@@ -213,7 +436,7 @@ static void githubOtaSetWarn(const char *msg) {
 static void githubOtaSetProgress(int percent) {
   if (!githubOtaProgressBar) return;
   if (!lvgl_port_lock(250)) return;
-  lv_bar_set_value(githubOtaProgressBar, percent, LV_ANIM_OFF);
+  lv_bar_set_value(githubOtaProgressBar, percent, LV_ANIM_ON);
   lvgl_port_unlock();
 }
 
@@ -229,19 +452,46 @@ static void githubOtaOverlayDestroy() {
   lvgl_port_unlock();
 }
 
+static bool githubOtaLvglSuspended = false;
+
+static void githubOtaHealthLog(const char *line) {
+  dualLog("%s\n", line);
+}
+
 static void githubOtaLvglSafeSuspend() {
+#ifndef OTA_LVGL_ALWAYS_SUSPEND
+  // Hypothesis, not yet confirmed on hardware: the TLS wedge the suspension
+  // works around is internal RAM running out, which moving the TLS record
+  // buffers to PSRAM (sys_health.h) should fix. If so, LVGL only needs to
+  // stop while internal RAM is still tight. The health log shows whether a
+  // stall still happens with it running.
+  SysHeapSnapshot heap = sysHealthHeap();
+  if (heap.internalLargest >= OTA_LVGL_SUSPEND_BELOW_BYTES) return;
+  dualLog("[GitHub OTA] Internal RAM low (largest block %lu); suspending LVGL\n",
+          (unsigned long)heap.internalLargest);
+#endif
+
   // Never suspend the LVGL task while it may be holding the LVGL mutex.
   // If we can't obtain the mutex promptly, skip suspension rather than deadlock.
   if (!lvgl_port_lock(2000)) return;
   lvgl_port_suspend();
+  githubOtaLvglSuspended = true;
   lvgl_port_unlock();
 }
 
 static void githubOtaLvglSafeResume() {
   lvgl_port_resume();
+  githubOtaLvglSuspended = false;
 }
 
 static void githubOtaUiPulse(const char *status, int progressPercent) {
+  if (!githubOtaLvglSuspended) {
+    // LVGL is live: just update the widgets, it renders them itself
+    if (status) githubOtaSetStatus(status);
+    if (progressPercent >= 0) githubOtaSetProgress(progressPercent);
+    return;
+  }
+
   // Briefly resume LVGL so it can render a frame, then suspend again.
   // This keeps the progress bar visible while reducing RGB tearing/fragmentation.
   githubOtaLvglSafeResume();
@@ -255,6 +505,89 @@ static void githubOtaUiPulse(const char *status, int progressPercent) {
   githubOtaLvglSafeSuspend();
 }
 
+// Pipeline progress: every 1% with LVGL live; when it had to be suspended,
+// 10% increments throttled to avoid display fragmentation.
+static int githubOtaLastPct = -1;
+static uint32_t githubOtaLastUiPulseMs = 0;
+
+// Bytes already written by earlier connections, and the whole download's length
+static size_t githubOtaResumeOffset = 0;
+static size_t githubOtaDownloadTotal = 0;
+
+// Download state for the task (static: the sinks below are plain function pointers)
+static OtaSession githubOtaSession;
+static OtaSinkFn githubOtaChunkOut = nullptr;
+
+static size_t githubOtaUpdateSink(uint8_t *data, size_t len) {
+  return Update.write(data, len);
+}
+
+static size_t githubOtaDechunk(uint8_t *data, size_t len) {
+  return githubOtaSession.chunks().write(data, len, githubOtaChunkOut);
+}
+
+static OtaBodyEnd githubOtaBodyEnd(OtaPipelineResult result) {
+  switch (result) {
+    case OTA_PIPE_OK: return OTA_BODY_OK;
+    case OTA_PIPE_STALLED: return OTA_BODY_STALLED;
+    case OTA_PIPE_DISCONNECTED: return OTA_BODY_DISCONNECTED;
+    default: return OTA_BODY_SINK_FAILED;
+  }
+}
+
+static void githubOtaPipelineProgress(size_t written, size_t total) {
+  githubOtaLastProgressMs = millis();
+  written += githubOtaResumeOffset;
+  total = githubOtaDownloadTotal;
+  if (total == 0) return;
+  int pct = static_cast<int>((written * 100ULL) / static_cast<uint64_t>(total));
+  if (pct > 100) pct = 100;
+  const int step = githubOtaLvglSuspended ? 10 : 1;
+  const uint32_t minGapMs = githubOtaLvglSuspended ? 700 : 200;
+  if (pct / step == githubOtaLastPct / step) return;
+  uint32_t now = millis();
+  if (githubOtaLastUiPulseMs != 0 && (now - githubOtaLastUiPulseMs) < minGapMs) return;
+  githubOtaLastPct = pct;
+  githubOtaLastUiPulseMs = now;
+
+  char msg[32];
+  snprintf(msg, sizeof(msg), "Installing: %d%%", pct);
+  githubOtaUiPulse(msg, pct);
+}
+
+static void githubOtaResumeBackoff(uint8_t retry, uint32_t waitMs) {
+  char msg[40];
+  snprintf(msg, sizeof(msg), "Connection lost, retry %u/%u", retry, OTA_RESUME_MAX_RETRIES);
+  githubOtaUiPulse(msg, -1);
+  githubOtaLastProgressMs = millis();  // Waiting isn't a wedge; keep the supervisor off
+  sysHealthSetStage("fw retry wait");
+  vTaskDelay(pdMS_TO_TICKS(waitMs));
+  githubOtaLastProgressMs = millis();
+}
+
+#if LAN_OTA_ENABLED
+// The release's LAN_OTA_SIG_ASSET (one line of hex). Saved once the image is
+// installed and checked against it after the reboot, so plain TLS will do.
+static String githubOtaFetchSignature(const String &url) {
+  WiFiClientSecure client;
+  client.setInsecure();
+  client.setTimeout(20000);
+  HTTPClient http;
+  http.setConnectTimeout(10000);
+  http.setTimeout(20000);
+  http.setFollowRedirects(HTTPC_STRICT_FOLLOW_REDIRECTS);  // Release assets redirect to a CDN
+  if (!http.begin(client, url)) return String();
+  http.addHeader("User-Agent", "ESP32-Stock-Ticker");
+  uint32_t startMs = millis();
+  int code = http.GET();
+  String sig = code == 200 ? http.getString() : String();
+  dataStatsRecordCall(PROVIDER_GITHUB, code, millis() - startMs, sig.length());
+  http.end();
+  sig.trim();
+  return sig;
+}
+#endif
+
 static void githubOtaTask(void *pv) {
   Serial.printf("[GitHub OTA] Task entry core=%d freeHeap=%u freePsram=%u\n",
                 xPortGetCoreID(), ESP.getFreeHeap(), ESP.getFreePsram());
@@ -262,11 +595,19 @@ static void githubOtaTask(void *pv) {
   GitHubOtaTaskArgs *args = static_cast<GitHubOtaTaskArgs *>(pv);
   String firmwareUrl = args ? String(args->url) : String();
   if (args) free(args);
+#if LAN_OTA_ENABLED
+  String releaseSig;  // Signature of the release being installed, for LAN peers
+#endif
 
   Serial.printf("[GitHub OTA] Task args: urlLen=%u\n", static_cast<unsigned>(firmwareUrl.length()));
 
   githubOtaLastProgressMs = millis();
 
+  // A line per stage with the heap, LVGL lock and CPU picture, so a stall
+  // shows where it happened (and the supervisor names the stage)
+  sysHealthSetStage("ota start");
+  sysHealthMonitorStart(OTA_HEALTH_LOG_MS, githubOtaHealthLog);
+
   // Improve reliability of long HTTPS transfers.
   WiFi.setSleep(false);
 
@@ -304,6 +645,25 @@ static void githubOtaTask(void *pv) {
     apiHttp.setTimeout(20000);
     apiHttp.setConnectTimeout(10000);
     apiHttp.setReuse(false);
+    apiHttp.useHTTP10(true);  // No chunked framing, so the body is parsed straight off the socket
+    const char *apiHeaders[] = {"ETag"};
+    apiHttp.collectHeaders(apiHeaders, 1);
+
+    // The release JSON is tens of KB (every asset, the release notes). If the
+    // last one we saw wasn't newer than this build, ask for it conditionally:
+    // an unchanged release is answered with an empty 304, which also doesn't
+    // count against GitHub's rate limit. A newer cached tag means its update
+    // never landed, so fetch the body again for the asset URLs.
+    String cachedEtag;
+    {
+      Preferences p;
+      p.begin(PREFS_NS, true);
+      String cachedTag = p.getString(PREF_OTA_RELEASE_TAG, "");
+      if (cachedTag.length() > 0 && !isNewerVersion(cachedTag, FIRMWARE_VERSION)) {
+        cachedEtag = p.getString(PREF_OTA_RELEASE_ETAG, "");
+      }
+      p.end();
+    }
 
     Serial.printf("[GitHub OTA] Stage: apiHttp.begin url=%s\n", apiUrl.c_str());
     if (!apiHttp.begin(apiClient, apiUrl)) {
@@ -313,6 +673,8 @@ static void githubOtaTask(void *pv) {
       githubOtaSetWarn("Closing...");
       delay(2000);
       githubOtaOverlayDestroy();
+      sysHealthMonitorStop();
+      sysHealthSetStage("idle");
       otaInProgress = false;
       githubOtaTaskHandle = nullptr;
       vTaskDelete(nullptr);
@@ -321,11 +683,15 @@ static void githubOtaTask(void *pv) {
     apiHttp.addHeader("User-Agent", "ESP32-Stock-Ticker");
     apiHttp.addHeader("Accept", "application/json");
     apiHttp.addHeader("Connection", "close");
+    if (cachedEtag.length() > 0) apiHttp.addHeader("If-None-Match", cachedEtag);
 
     Serial.println("[GitHub OTA] Stage: apiHttp.GET begin");
+    sysHealthSetStage("api tls+get");
     uint32_t getStartMs = millis();
     int apiCode = apiHttp.GET();
     Serial.printf("[GitHub OTA] Stage: apiHttp.GET done in %lu ms\n", (unsigned long)(millis() - getStartMs));
+    if (apiCode != 200) dataStatsRecordCall(PROVIDER_GITHUB, apiCode, millis() - getStartMs, 0);
+    if (apiCode == HTTP_CODE_NOT_MODIFIED) Serial.println("[GitHub OTA] Release unchanged (304)");
     Serial.printf("GitHub API GET HTTP: %d\n", apiCode);
 
     githubOtaLvglSafeResume();
@@ -337,27 +703,51 @@ static void githubOtaTask(void *pv) {
     }
     delay(120);
 
+    if (apiCode == HTTP_CODE_NOT_MODIFIED) {
+      apiHttp.end();
+      githubOtaSetStatus("You're up to date!");
+      delay(2000);
+      githubOtaOverlayDestroy();
+      sysHealthMonitorStop();
+      sysHealthSetStage("idle");
+      otaInProgress = false;
+      githubOtaTaskHandle = nullptr;
+      vTaskDelete(nullptr);
+    }
+
     if (apiCode != 200) {
       apiHttp.end();
       githubOtaSetStatus("Failed to check GitHub");
       githubOtaSetWarn("Closing...");
       delay(2000);
       githubOtaOverlayDestroy();
+      sysHealthMonitorStop();
+      sysHealthSetStage("idle");
       otaInProgress = false;
       githubOtaTaskHandle = nullptr;
       vTaskDelete(nullptr);
     }
 
-    String payload = apiHttp.getString();
-    apiHttp.end();
-
+    // Parse off the socket, keeping only the tag and the asset names/URLs
+    sysHealthSetStage("api read");
+    String etag = apiHttp.header("ETag");
+    JsonDocument filter;
+    filter["tag_name"] = true;
+    filter["assets"][0]["name"] = true;
+    filter["assets"][0]["browser_download_url"] = true;
+    filter["assets"][0]["url"] = true;
     JsonDocument doc;
-    DeserializationError error = deserializeJson(doc, payload);
+    DataStatsCountingStream apiBody(apiHttp.getStream(), 20000);
+    DeserializationError error = deserializeJson(doc, apiBody, DeserializationOption::Filter(filter));
+    apiHttp.end();
+    dataStatsRecordCall(PROVIDER_GITHUB, apiCode, millis() - getStartMs, apiBody.count());
     if (error) {
       githubOtaSetStatus("Failed to parse release info");
       githubOtaSetWarn("Closing...");
       delay(2000);
       githubOtaOverlayDestroy();
+      sysHealthMonitorStop();
+      sysHealthSetStage("idle");
       otaInProgress = false;
       githubOtaTaskHandle = nullptr;
       vTaskDelete(nullptr);
@@ -367,6 +757,13 @@ static void githubOtaTask(void *pv) {
     if (tagName.startsWith("v") || tagName.startsWith("V")) {
       tagName = tagName.substring(1);
     }
+    if (tagName.length() > 0) {
+      Preferences p;
+      p.begin(PREFS_NS, false);
+      p.putString(PREF_OTA_RELEASE_TAG, tagName);
+      p.putString(PREF_OTA_RELEASE_ETAG, etag);
+      p.end();
+    }
 
     char versionMsg[64];
     snprintf(versionMsg, sizeof(versionMsg), "Current: v%s  Latest: v%s", FIRMWARE_VERSION, tagName.c_str());
@@ -377,36 +774,81 @@ static void githubOtaTask(void *pv) {
       githubOtaSetStatus("You're up to date!");
       delay(2000);
       githubOtaOverlayDestroy();
+      sysHealthMonitorStop();
+      sysHealthSetStage("idle");
       otaInProgress = false;
       githubOtaTaskHandle = nullptr;
       vTaskDelete(nullptr);
     }
 
-    // Find firmware.bin in assets
+    // Find firmware.bin in assets. Best first: a delta made for our running
+    // image (tools/make_delta.py), the compressed firmware.bin.z
+    // (tools/compress_firmware.py), then the plain image.
+    String deltaAsset = otaDeltaAssetName();
+    {
+      Preferences p;
+      p.begin(PREFS_NS, true);
+      if (p.getString(PREF_OTA_NO_DELTA_TAG, "") == tagName) deltaAsset = "";
+      p.end();
+    }
     JsonArray assets = doc["assets"];
+    int bestRank = 0;
+#if LAN_OTA_ENABLED
+    String releaseSigUrl;
+#endif
     for (JsonObject asset : assets) {
       String name = asset["name"] | "";
-      if (name == "firmware.bin") {
+#if LAN_OTA_ENABLED
+      if (name == LAN_OTA_SIG_ASSET) releaseSigUrl = asset["browser_download_url"] | "";
+#endif
+      int rank = 0;
+      if (deltaAsset.length() > 0 && name == deltaAsset) rank = 3;
+      else if (name == "firmware.bin" OTA_Z_ASSET_SUFFIX) rank = 2;
+      else if (name == "firmware.bin") rank = 1;
+      if (rank > bestRank) {
         // Prefer the public browser_download_url for OTA.
         // The API "url" field points at api.github.com and often requires auth.
-        firmwareUrl = asset["browser_download_url"] | "";
-        if (firmwareUrl.length() == 0) {
-          firmwareUrl = asset["url"] | "";
+        String url = asset["browser_download_url"] | "";
+        if (url.length() == 0) {
+          url = asset["url"] | "";
+        }
+        if (url.length() > 0) {
+          firmwareUrl = url;
+          bestRank = rank;
         }
-        break;
       }
     }
+    if (bestRank == 3) {
+      Serial.printf("[GitHub OTA] Using delta %s\n", deltaAsset.c_str());
+      // If the patch fails, the next attempt at this release takes the full image
+      Preferences p;
+      p.begin(PREFS_NS, false);
+      p.putString(PREF_OTA_NO_DELTA_TAG, tagName);
+      p.end();
+    }
 
     if (firmwareUrl.length() == 0) {
       githubOtaSetStatus("No firmware.bin in release");
       githubOtaSetWarn("Closing...");
       delay(2000);
       githubOtaOverlayDestroy();
+      sysHealthMonitorStop();
+      sysHealthSetStage("idle");
       otaInProgress = false;
       githubOtaTaskHandle = nullptr;
       vTaskDelete(nullptr);
     }
 
+#if LAN_OTA_ENABLED
+    if (lanOtaReady && releaseSigUrl.length() > 0) {
+      sysHealthSetStage("sig get");
+      githubOtaLvglSafeSuspend();
+      releaseSig = githubOtaFetchSignature(releaseSigUrl);
+      githubOtaLvglSafeResume();
+      Serial.printf("[GitHub OTA] Release signature %s\n", releaseSig.length() > 0 ? "fetched" : "unavailable");
+    }
+#endif
+
     githubOtaSetStatus("Starting download...");
     githubOtaSetProgress(0);
     Serial.println("Firmware URL: " + firmwareUrl);
@@ -417,164 +859,188 @@ static void githubOtaTask(void *pv) {
   githubOtaLvglSafeSuspend();
   delay(50);
 
-  WiFiClientSecure dlClient;
-  dlClient.setInsecure();
-  // Match the early 1.9.x OTA behavior: longer overall timeouts.
-  // (Arduino Stream timeout is milliseconds.)
-  dlClient.setTimeout(60000);
+  // A compressed image's size is in its header, so the slot is opened unsized.
+  // Deltas are compressed too, and rebuild the image from the running slot.
+  bool delta = firmwareUrl.endsWith(OTA_DELTA_ASSET_SUFFIX);
+  bool compressed = delta || firmwareUrl.endsWith(OTA_Z_ASSET_SUFFIX);
+
+  // Redirects, Range resumes and chunked bodies are decided by the session
+  // (ota_session.h, tested on the host with tools/ota_bench.py --host). A
+  // stalled or dropped transfer reconnects and asks for the rest, feeding the
+  // same Update session (and inflater / delta state) instead of rebooting.
+  OtaSessionConfig sessionConfig = {OTA_RESUME_MAX_RETRIES, OTA_RESUME_BACKOFF_MS, OTA_RESUME_BACKOFF_MAX_MS};
+  OtaSession &session = githubOtaSession;
+  session.begin(firmwareUrl.c_str(), sessionConfig);
+  OtaSessionStep step = OTA_STEP_REQUEST;
+  bool updateBegun = false;
+  githubOtaLastPct = -1;
+  githubOtaLastUiPulseMs = 0;
+
+  while (step == OTA_STEP_REQUEST || step == OTA_STEP_RETRY) {
+    if (step == OTA_STEP_RETRY) githubOtaResumeBackoff(session.retries(), session.retryDelayMs());
+
+    WiFiClientSecure dlClient;
+    dlClient.setInsecure();
+    // Match the early 1.9.x OTA behavior: longer overall timeouts.
+    // (Arduino Stream timeout is milliseconds.)
+    dlClient.setTimeout(60000);
 #if defined(ARDUINO_ARCH_ESP32)
-  dlClient.setHandshakeTimeout(30);
+    dlClient.setHandshakeTimeout(30);
 #endif
 
-  HTTPClient dlHttp;
-  dlHttp.setFollowRedirects(HTTPC_FORCE_FOLLOW_REDIRECTS);
-  dlHttp.setTimeout(60000);
-  dlHttp.setConnectTimeout(20000);
+    HTTPClient dlHttp;
+    dlHttp.setFollowRedirects(HTTPC_DISABLE_FOLLOW_REDIRECTS);  // The session follows them
+    dlHttp.setTimeout(60000);
+    dlHttp.setConnectTimeout(20000);
 
-  if (!dlHttp.begin(dlClient, firmwareUrl)) {
-    lvgl_port_resume();
-    delay(50);
-    githubOtaSetStatus("HTTP begin failed");
-    githubOtaSetWarn("Rebooting...");
-    delay(2500);
-    ESP.restart();
-  }
-
-  dlHttp.addHeader("User-Agent", "ESP32-Stock-Ticker");
-  dlHttp.addHeader("Accept", "application/octet-stream");
-  dlHttp.addHeader("Connection", "close");
-
-  Serial.println("OTA download URL: " + firmwareUrl);
-  Serial.println("Starting firmware GET...");
-
-  int httpCode = dlHttp.GET();
-  Serial.printf("Firmware GET HTTP: %d\n", httpCode);
-
-  if (httpCode != 200) {
-    char errMsg[48];
-    snprintf(errMsg, sizeof(errMsg), "Download failed: HTTP %d", httpCode);
-    githubOtaLvglSafeResume();
-    delay(50);
-    githubOtaSetStatus(errMsg);
-    githubOtaSetWarn("Rebooting...");
-    delay(2500);
-    dlHttp.end();
-    ESP.restart();
-  }
-
-  // Now entering the streaming write phase; show initial UI state, then suspend.
-  githubOtaUiPulse("Downloading...", 0);
-
-  int contentLength = dlHttp.getSize();
-  Serial.printf("Firmware size (Content-Length): %d\n", contentLength);
-
-  if (contentLength > 0) {
-    if (!Update.begin(contentLength)) {
-      githubOtaLvglSafeResume();
-      delay(50);
-      githubOtaSetStatus("Not enough space!");
-      Update.printError(Serial);
-      githubOtaSetWarn("Rebooting...");
-      delay(2500);
-      dlHttp.end();
-      ESP.restart();
-    }
-  } else {
-    // GitHub/CDN can respond with chunked transfer (no Content-Length).
-    if (!Update.begin(UPDATE_SIZE_UNKNOWN)) {
-      githubOtaLvglSafeResume();
+    if (!dlHttp.begin(dlClient, session.url())) {
+      lvgl_port_resume();
       delay(50);
-      githubOtaSetStatus("Not enough space!");
-      Update.printError(Serial);
+      githubOtaSetStatus("HTTP begin failed");
       githubOtaSetWarn("Rebooting...");
       delay(2500);
-      dlHttp.end();
       ESP.restart();
     }
-  }
-
-  WiFiClient *stream = dlHttp.getStreamPtr();
-  uint8_t buff[1024];
-  size_t written = 0;
-  int lastPct = -1;
-  uint32_t lastUiPulseMs = 0;
-  uint32_t lastDataTime = millis();
-  const uint32_t DATA_TIMEOUT_MS = 30000;
-
-  // v1.9.4/v1.9.12-style loop: available()+readBytes(), with timeout and connection checks.
-  // Keep LVGL suspended most of the time, but pulse it briefly for progress updates.
-  while (dlHttp.connected() && (contentLength <= 0 || written < static_cast<size_t>(contentLength))) {
-    taskYIELD();
 
-    size_t available = stream->available();
-    if (!stream->connected() && available == 0) {
-      Serial.println("Connection lost during OTA");
-      break;
+    dlHttp.addHeader("User-Agent", "ESP32-Stock-Ticker");
+    dlHttp.addHeader("Accept", "application/octet-stream");
+    dlHttp.addHeader("Connection", "close");
+    const char *dlHeaders[] = {"Content-Range", "Location", "Transfer-Encoding"};
+    dlHttp.collectHeaders(dlHeaders, 3);
+    if (session.rangeStart() > 0) {
+      dlHttp.addHeader("Range", String("bytes=") + session.rangeStart() + "-");
+      Serial.printf("[GitHub OTA] Resuming at byte %u (retry %u/%u)\n", static_cast<unsigned>(session.rangeStart()),
+                    session.retries(), OTA_RESUME_MAX_RETRIES);
+    } else {
+      Serial.printf("OTA download URL: %s\n", session.url());
+      Serial.println("Starting firmware GET...");
     }
 
-    if (available == 0) {
-      if (millis() - lastDataTime > DATA_TIMEOUT_MS) {
-        Serial.println("OTA download timeout - no data received");
-        break;
-      }
-      vTaskDelay(10 / portTICK_PERIOD_MS);
+    githubOtaLastProgressMs = millis();
+    sysHealthSetStage("fw tls+get");
+    int httpCode = dlHttp.GET();
+    int responseLength = dlHttp.getSize();
+    Serial.printf("Firmware GET HTTP: %d\n", httpCode);
+    step = session.response(httpCode, responseLength, dlHttp.header("Location").c_str(),
+                            dlHttp.header("Content-Range").c_str(),
+                            dlHttp.header("Transfer-Encoding").equalsIgnoreCase("chunked"));
+    if (step != OTA_STEP_STREAM) {
+      dlHttp.end();
       continue;
     }
 
-    lastDataTime = millis();
-    githubOtaLastProgressMs = lastDataTime;
-
-    size_t toRead = (available < sizeof(buff)) ? available : sizeof(buff);
-    size_t bytesRead = stream->readBytes(buff, toRead);
-    if (bytesRead == 0) {
-      vTaskDelay(1 / portTICK_PERIOD_MS);
-      continue;
+    if (!updateBegun) {
+      // Now entering the streaming write phase; show initial UI state, then suspend.
+      githubOtaUiPulse("Downloading...", 0);
+
+      long contentLength = session.totalLength();
+      Serial.printf("Firmware size (Content-Length): %ld%s\n", contentLength, session.chunked() ? " (chunked)" : "");
+
+      if (contentLength > 0 && !compressed) {
+        if (!Update.begin(contentLength)) {
+          githubOtaLvglSafeResume();
+          delay(50);
+          githubOtaSetStatus("Not enough space!");
+          Update.printError(Serial);
+          githubOtaSetWarn("Rebooting...");
+          delay(2500);
+          dlHttp.end();
+          ESP.restart();
+        }
+      } else {
+        // GitHub/CDN can respond with chunked transfer (no Content-Length).
+        // Compressed images land here too and are checked against their header.
+        if (!Update.begin(UPDATE_SIZE_UNKNOWN) || (delta && !otaDeltaBegin(nullptr)) ||
+            (compressed && !otaInflateBegin(delta ? otaDeltaWrite : nullptr))) {
+          githubOtaLvglSafeResume();
+          delay(50);
+          githubOtaSetStatus("Not enough space!");
+          Update.printError(Serial);
+          githubOtaSetWarn("Rebooting...");
+          delay(2500);
+          dlHttp.end();
+          ESP.restart();
+        }
+      }
+      updateBegun = true;
     }
 
-    size_t bytesWritten = Update.write(buff, bytesRead);
-    if (bytesWritten != bytesRead) {
-      Serial.println("Write error during OTA");
-      break;
+    // Network reads and flash writes overlap through PSRAM buffers (ota_pipeline.h).
+    // A chunked body is unframed on its way to the inflater / Update.
+    OtaPipelineConfig pipe = otaPipelineDefaults();
+    pipe.progress = githubOtaPipelineProgress;
+    pipe.dataTimeoutMs = OTA_RESUME_STALL_MS;
+    pipe.sink = compressed ? otaInflateWrite : githubOtaUpdateSink;
+    if (session.chunked()) {
+      githubOtaChunkOut = pipe.sink;
+      pipe.sink = githubOtaDechunk;
     }
-
-    written += bytesWritten;
-
-    if (contentLength > 0) {
-      int pct = static_cast<int>((written * 100ULL) / static_cast<uint64_t>(contentLength));
-      if (pct > 100) pct = 100;
-
-      // Update UI at 10% increments, throttled to avoid display fragmentation.
-      // (Also ensures the UI isn't pulsed too frequently if data arrives fast.)
-      if (pct != lastPct && (pct % 10 == 0)) {
-        uint32_t now = millis();
-        if (lastUiPulseMs == 0 || (now - lastUiPulseMs) >= 700) {
-          lastPct = pct;
-          lastUiPulseMs = now;
-
-          char msg[32];
-          snprintf(msg, sizeof(msg), "Installing: %d%%", pct);
-          githubOtaUiPulse(msg, pct);
-        }
-      }
+    githubOtaResumeOffset = session.received();
+    githubOtaDownloadTotal = session.totalLength() > 0 ? session.totalLength() : 0;
+    sysHealthSetStage("fw download");
+    OtaPipelineStats pipeStats;
+    OtaPipelineResult pipeResult =
+      otaPipelineRun(*dlHttp.getStreamPtr(), responseLength > 0 ? responseLength : 0, pipe, &pipeStats);
+    if (pipeResult != OTA_PIPE_OK) {
+      Serial.printf("OTA download %s after %u bytes\n", otaPipelineResultName(pipeResult),
+                    static_cast<unsigned>(session.received() + pipeStats.bytes));
     }
+    Serial.printf("[GitHub OTA] %u bytes in %lu ms: network wait %lu ms, flash %lu ms, buffer wait %lu ms\n",
+                  static_cast<unsigned>(pipeStats.bytes), (unsigned long)pipeStats.elapsedMs,
+                  (unsigned long)pipeStats.networkWaitMs, (unsigned long)pipeStats.writeMs,
+                  (unsigned long)pipeStats.bufferWaitMs);
+
+    dlHttp.end();
+    step = session.bodyEnd(githubOtaBodyEnd(pipeResult), pipeStats.bytes);
   }
 
-  dlHttp.end();
+  if (step == OTA_STEP_FAILED) {
+    Serial.printf("[GitHub OTA] Download failed: %s (HTTP %d, %u redirects, %u retries)\n",
+                  otaSessionErrorName(session.error()), session.httpCode(), session.redirects(), session.retries());
+  }
+  if (!updateBegun) {
+    char errMsg[48];
+    snprintf(errMsg, sizeof(errMsg), "Download failed: HTTP %d", session.httpCode());
+    githubOtaLvglSafeResume();
+    delay(50);
+    githubOtaSetStatus(errMsg);
+    githubOtaSetWarn("Rebooting...");
+    delay(2500);
+    ESP.restart();
+  }
 
-  Serial.printf("OTA wrote %u bytes\n", static_cast<unsigned>(written));
+  Serial.printf("OTA wrote %u bytes\n", static_cast<unsigned>(session.received()));
+  sysHealthSetStage("fw verify");
 
   bool ok = false;
-  if (contentLength > 0) {
-    ok = (written == static_cast<size_t>(contentLength)) && Update.end(true);
+  if (compressed) {
+    // Check the inflated image against the header's SHA-256 before committing
+    OtaInflateResult zResult = otaInflateEnd();
+    Serial.printf("OTA inflated %u bytes: %s\n", static_cast<unsigned>(otaInflateOutputBytes()),
+                  otaInflateResultName(zResult));
+    // A delta's rebuilt image is checked against its target SHA-256 as well
+    OtaDeltaResult dResult = OTA_DELTA_OK;
+    if (delta) {
+      dResult = otaDeltaEnd();
+      Serial.printf("OTA delta rebuilt %u bytes: %s\n", static_cast<unsigned>(otaDeltaOutputBytes()),
+                    otaDeltaResultName(dResult));
+    }
+    ok = step == OTA_STEP_DONE && zResult == OTA_Z_OK && dResult == OTA_DELTA_OK && Update.end(true);
+    if (!ok && (zResult != OTA_Z_OK || dResult != OTA_DELTA_OK)) Update.abort();
   } else {
-    ok = Update.end(true);
+    ok = step == OTA_STEP_DONE && Update.end(true);
   }
+  if (!ok && step != OTA_STEP_DONE) Update.abort();
 
   // Now we can resume LVGL and show final status.
   githubOtaLvglSafeResume();
   delay(50);
 
   if (ok) {
+#if LAN_OTA_ENABLED
+    // Without one (or for a direct URL) the new image just isn't served
+    if (lanOtaReady) lanOtaSaveSignature(releaseSig.c_str());
+#endif
     githubOtaSetStatus("Update Complete!");
     githubOtaSetWarn("Rebooting...");
     delay(1500);
@@ -588,6 +1054,110 @@ static void githubOtaTask(void *pv) {
   }
 }
 
+// ===== LAN firmware distribution (see lan_ota.h) =====
+#if LAN_OTA_ENABLED
+struct LanOtaTaskArgs {
+  IPAddress peer;
+  char version[12];
+  char nodeId[16];
+};
+
+// Peer + version pairs that failed to install; never retried until reboot
+static LanOtaTaskArgs lanOtaFailed[AUTO_OTA_LAN_MAX_FAILURES];
+
+static bool lanOtaSourceFailed(const LanPeer *peer) {
+  for (int i = 0; i < lanOtaFailureCount && i < AUTO_OTA_LAN_MAX_FAILURES; i++) {
+    if (strcmp(lanOtaFailed[i].nodeId, peer->nodeId) == 0 && strcmp(lanOtaFailed[i].version, peer->firmware) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void lanOtaProgress(size_t written, size_t total) {
+  githubOtaLastProgressMs = millis();
+  Serial.printf("[LAN OTA] %u%% (%u/%u bytes)\n", (unsigned)(written * 100ULL / total), (unsigned)written,
+                (unsigned)total);
+}
+
+static void lanOtaTask(void *pv) {
+  LanOtaTaskArgs args = *static_cast<LanOtaTaskArgs *>(pv);
+  free(pv);
+  WiFi.setSleep(false);
+
+  // Plain HTTP on the LAN: unlike the TLS path, LVGL keeps running
+  dualLog("[LAN OTA] Fetching v%s from %s (%s)\n", args.version, args.nodeId, args.peer.toString().c_str());
+  LanOtaResult result = lanOtaDownload(args.peer, args.version, lanOtaProgress);
+  if (result == LAN_OTA_OK) {
+    dualLog("[LAN OTA] v%s installed, rebooting\n", args.version);
+    delay(500);
+    ESP.restart();
+  }
+
+  // Leave the weekly marker unset so the next scheduler pass can retry
+  // another source or fall back to GitHub
+  dualLog("[LAN OTA] Update from %s failed: %s\n", args.nodeId, lanOtaResultName(result));
+  if (lanOtaFailureCount < AUTO_OTA_LAN_MAX_FAILURES) {
+    lanOtaFailed[lanOtaFailureCount] = args;
+    lanOtaFailureCount = lanOtaFailureCount + 1;
+  }
+  Preferences p;
+  p.begin(PREFS_NS, false);
+  p.remove(PREF_AUTO_OTA_LAST_EPOCH);
+  p.end();
+  otaInProgress = false;
+  githubOtaTaskHandle = nullptr;
+  vTaskDelete(nullptr);
+}
+
+// Start a LAN update if a lease-holding peer runs newer firmware than we do
+// (skipping peer + version pairs that already failed). Among peers on the newest version one is picked at random, so a fleet
+// spreads its downloads over every device that has already updated.
+static bool startLanOTAFromPeer() {
+  if (!lanOtaReady || !lanPeerActive() || otaInProgress || githubOtaTaskHandle != nullptr) return false;
+  const LanPeer *candidates[LAN_PEER_MAX_PEERS];
+  int count = 0;
+  String newest = FIRMWARE_VERSION;
+  for (int i = 0; i < lanPeerCount(); i++) {
+    const LanPeer *peer = lanPeerAt(i);
+    if (peer == nullptr || millis() - peer->lastSeenMs > LAN_PEER_LEASE_MS) continue;
+    String version = peer->firmware;
+    if (!isNewerVersion(version, FIRMWARE_VERSION) || lanOtaSourceFailed(peer)) continue;
+    if (isNewerVersion(version, newest)) {
+      newest = version;
+      count = 0;
+    }
+    if (version == newest) candidates[count++] = peer;
+  }
+  if (count == 0) return false;
+
+  const LanPeer *source = candidates[random(count)];
+  LanOtaTaskArgs *args = static_cast<LanOtaTaskArgs *>(calloc(1, sizeof(LanOtaTaskArgs)));
+  if (!args) return false;
+  args->peer = source->ip;
+  strlcpy(args->version, source->firmware, sizeof(args->version));
+  strlcpy(args->nodeId, source->nodeId, sizeof(args->nodeId));
+
+  otaInProgress = true;
+  githubOtaTaskStartMs = millis();
+  githubOtaLastProgressMs = githubOtaTaskStartMs;
+  // Shares the GitHub task handle so both paths exclude each other
+  BaseType_t ok = xTaskCreatePinnedToCore(lanOtaTask, "lan_ota", 8192, args, 2, &githubOtaTaskHandle,
+                                          ARDUINO_RUNNING_CORE);
+  if (ok != pdPASS || githubOtaTaskHandle == nullptr) {
+    free(args);
+    githubOtaTaskHandle = nullptr;
+    otaInProgress = false;
+    Serial.println("[LAN OTA] Failed to start OTA task");
+    return false;
+  }
+  markAutoOtaRun();
+  return true;
+}
+#else
+static bool startLanOTAFromPeer() { return false; }
+#endif
+
 // UI elements
 lv_obj_t *priceLabel = nullptr;
 lv_obj_t *changeLabel = nullptr;
@@ -654,15 +1224,34 @@ lv_obj_t *clockLabel = nullptr;
 static lv_point_t swipeStart;
 static bool swipeTracking = false;
 
-// API call tracking (resets on reboot)
-struct ApiStats {
-  uint32_t twelveDataQuoteCalls = 0;      // TwelveData /quote API calls
-  uint32_t twelveDataTimeSeriesCalls = 0; // TwelveData /time_series API calls
-  uint32_t localCacheHits = 0;            // Served from local RAM cache
-  uint32_t p2pCacheHits = 0;              // Served from P2P network
-  uint32_t lastLogTime = 0;               // Last time we logged stats
-};
-static ApiStats apiStats;
+// API call and cache counters live in data_stats.h (resets on reboot, served at /stats)
+static uint32_t lastApiStatsLogTime = 0;  // Last time we logged stats to Serial
+
+// Background revalidation runs in loop(), so touch and the clock wait for it.
+// While a fetch budget is set, every quote HTTP call (connect and read) gets
+// at most what's left of it, and prefetchStockData() stops trying further
+// providers once it's spent.
+#define SWR_REVALIDATE_BUDGET_MS 3000
+#define FETCH_MIN_TIMEOUT_MS 500   // Floor per call; a shorter TLS handshake can't succeed anyway
+static uint32_t fetchBudgetEndMs = 0;  // 0 = no budget (foreground fetches keep their own timeouts)
+
+static int32_t fetchBudgetLeftMs() {
+  return (int32_t)(fetchBudgetEndMs - millis());
+}
+
+static bool fetchBudgetSpent() {
+  return fetchBudgetEndMs != 0 && fetchBudgetLeftMs() <= 0;
+}
+
+static void applyFetchTimeouts(HTTPClient& http, uint32_t normalMs) {
+  uint32_t ms = normalMs;
+  if (fetchBudgetEndMs != 0) {
+    int32_t left = fetchBudgetLeftMs();
+    ms = left < FETCH_MIN_TIMEOUT_MS ? FETCH_MIN_TIMEOUT_MS : min(normalMs, (uint32_t)left);
+    http.setConnectTimeout(ms);
+  }
+  http.setTimeout(ms);
+}
 
 // Forward declaration: Prefetched stock data for smooth transitions
 // (Needed here for P2P code, full instance declared later)
@@ -682,6 +1271,11 @@ struct PrefetchedData {
   float oneMonthHigh;
   String companyName;
   bool marketOpen;
+  uint32_t fetchTime;  // millis() when the underlying quote was fetched (0 = just now)
+  uint32_t rangeFetchTime;  // millis() when the 52-week range was fetched (0 = not provided)
+  bool stale;          // Served from cache past its freshness window; revalidation queued
+  bool fromPeer;       // Came from a LAN peer or the registry, not one of our API calls
+  uint8_t fields;      // FreshField bits the source fills in (providerFields())
 };
 
 // Forward declaration: Cached data for error recovery and market-closed optimization
@@ -700,11 +1294,74 @@ struct CachedStockData {
   int dayRangePos, fiftyTwoPos, oneMonthPos;
   bool marketOpen;
   uint32_t fetchTime;  // millis() when data was fetched
+  uint32_t rangeFetchTime;  // millis() when the 52-week range was fetched
+  uint8_t fields;      // FreshField bits the quote's source fills in; only these can make it stale
+  uint32_t version;    // symbolCacheVersion when last written locally; 0 = came from a peer (delta heartbeats)
 };
 
 // Multi-symbol cache for rotation (up to 20 symbols) - declared early for P2P
 extern CachedStockData symbolCache[20];
 extern int symbolCacheCount;
+extern uint32_t symbolCacheVersion;  // Bumped on every cache write
+
+// ============ Freshness Policy ============
+// One declarative table of how long each class of cached field stays fresh per
+// market phase. Cache lookups go through evaluateFreshness() (defined with the
+// market-hours helpers below), which reports which fields are stale and why, so
+// a refresh only replaces what actually expired.
+enum FreshField : uint8_t {
+  FIELD_QUOTE = 0,   // Price, change, OHL, volume
+  FIELD_RANGE_52W,   // 52-week low/high
+  FIELD_RANGE_1M,    // 1-month low/high (TwelveData /time_series)
+  FIELD_NAME,        // Company name
+  FIELD_PEER_QUOTE,  // Quote shared over P2P (publish and accept)
+  FIELD_COUNT
+};
+
+enum MarketPhase : uint8_t { PHASE_OPEN = 0, PHASE_TRANSITION, PHASE_CLOSED, PHASE_COUNT };
+
+enum StaleReason : uint8_t { STALE_NONE = 0, STALE_MISSING, STALE_EXPIRED, STALE_DAY_ROLLOVER };
+
+const uint32_t TTL_NEVER = 0xFFFFFFFF;         // Never expires once present
+const uint32_t TTL_CALENDAR_DAY = 0xFFFFFFFE;  // Expires when the (device-local) day changes
+
+struct FreshnessRule {
+  const char* name;
+  uint32_t ttlMs[PHASE_COUNT];  // Indexed by MarketPhase
+};
+
+const FreshnessRule FRESHNESS_POLICY[FIELD_COUNT] = {
+  //           open               transition         closed
+  {"quote",   {120000,           300000,            3600000}},           // Closed: next hourly market check
+  {"52w",     {86400000,         86400000,          86400000}},
+  {"1m",      {TTL_CALENDAR_DAY, TTL_CALENDAR_DAY,  TTL_CALENDAR_DAY}},  // One /time_series call per day
+  {"name",    {TTL_NEVER,        TTL_NEVER,         TTL_NEVER}},
+  {"peer",    {900000,           900000,            900000}},            // 15 minutes max age on the network
+};
+
+// Fields each quote source fills in. Finnhub and Polygon return no ranges, so
+// an entry they produced can't be made fresh by revalidating its ranges.
+const uint8_t FIELDS_TWELVEDATA = (1u << FIELD_QUOTE) | (1u << FIELD_RANGE_52W) | (1u << FIELD_RANGE_1M);
+const uint8_t FIELDS_QUOTE_ONLY = (1u << FIELD_QUOTE);  // Finnhub, Polygon
+
+// Peers pass on the 52-week range when their source had one
+inline uint8_t peerFields(float fiftyTwoHigh) {
+  return fiftyTwoHigh > 0 ? (FIELDS_QUOTE_ONLY | (1u << FIELD_RANGE_52W)) : FIELDS_QUOTE_ONLY;
+}
+
+inline uint32_t freshnessTtlMs(FreshField field, MarketPhase phase) {
+  return FRESHNESS_POLICY[field].ttlMs[phase];
+}
+
+struct FreshnessReport {
+  MarketPhase phase;
+  uint8_t staleMask;               // Bit per FreshField
+  StaleReason reason[FIELD_COUNT];
+  uint32_t ageMs[FIELD_COUNT];
+  bool isStale(FreshField field) const { return staleMask & (1u << field); }
+};
+
+MarketPhase currentMarketPhase();
 
 // ============================================================================
 // P2P NETWORK CLIENT
@@ -713,18 +1370,6 @@ extern int symbolCacheCount;
 // reducing TwelveData API calls across the network.
 // ============================================================================
 
-#if defined(P2P_ENABLED) && P2P_ENABLED
-
-#define P2P_HEARTBEAT_INTERVAL_MS 600000    // Send heartbeat every 10 minutes (saves KV writes)
-#define P2P_STOCK_MAX_AGE_SEC 900           // 15 minutes max age
-#define P2P_STOCK_PREFERRED_AGE_SEC 600     // Prefer data < 10 min old
-
-static String p2pNodeId = "";
-static uint32_t lastP2PHeartbeat = 0;
-static bool p2pRegistered = false;
-static int p2pNodesOnline = 0;
-static int p2pStocksCached = 0;
-
 // Generate unique node ID from MAC address
 String getP2PNodeId() {
   uint8_t mac[6];
@@ -735,6 +1380,42 @@ String getP2PNodeId() {
   return String(macStr);
 }
 
+// Numeric <-> cache conversions (defined with the cache code below)
+void cachedToPrefetched(const CachedStockData& cached, PrefetchedData& out);
+void prefetchedToPeerQuote(const PrefetchedData& data, PeerQuote& out);
+void peerQuoteToPrefetched(const PeerQuote& quote, PrefetchedData& out);
+void prefetchedToCached(const PrefetchedData& data, CachedStockData& out);
+bool cachePeerQuote(const PrefetchedData& data);
+CachedStockData* findCachedSymbol(const String& symbol);
+void cacheSymbolData(const CachedStockData& data, bool fromPeer = false);
+void carryForwardFreshFields(PrefetchedData& data);
+bool evaluateFreshness(const CachedStockData& entry, FreshnessReport& report);
+
+#if defined(P2P_ENABLED) && P2P_ENABLED
+
+#define P2P_HEARTBEAT_SETTLE_MS 10000       // Upload this long after the first unsent fetch (batches a burst)
+#define P2P_HEARTBEAT_MIN_GAP_MS 60000      // Never upload more often than once a minute (saves KV writes)
+#define P2P_HEARTBEAT_KEEPALIVE_MS 600000   // Keep-alive with nothing new, market hours only
+#define P2P_STOCK_PREFERRED_AGE_SEC 600     // Prefer data < 10 min old
+#define P2P_BULK_MAX_SYMBOLS 20             // One /stocks request covers the whole rotation
+#define P2P_FULL_SYNC_EVERY 6               // Every 6th heartbeat (~hourly) re-sends everything
+
+static String p2pNodeId = "";
+static uint32_t lastP2PHeartbeat = 0;
+static uint32_t p2pPendingSince = 0;  // When a local fetch first went unsent; 0 = nothing pending
+static bool p2pRegistered = false;
+static int p2pNodesOnline = 0;
+static int p2pStocksCached = 0;
+static uint8_t p2pWireVersion = P2P_WIRE_V1_JSON;  // Negotiated at /register
+static bool p2pBulkSupported = true;   // Cleared if the registry has no /stocks
+static bool p2pWarmPending = false;    // Bulk-warm the rotation on the next tick
+static uint32_t lastP2PWarm = 0;
+static String p2pBulkSymbols[P2P_BULK_MAX_SYMBOLS];  // Asked for in the last bulk lookup
+static int p2pBulkSymbolCount = 0;
+static uint32_t p2pBulkAt = 0;
+static uint32_t p2pAckedVersion = 0;   // Cache version covered by the last accepted heartbeat
+static uint8_t p2pHeartbeatsSinceFull = 0;
+
 // Register this device with the P2P registry
 bool p2pRegister() {
   if (WiFi.status() != WL_CONNECTED) return false;
@@ -752,6 +1433,11 @@ bool p2pRegister() {
   doc["address"] = WiFi.localIP().toString();
   doc["firmwareVersion"] = FIRMWARE_VERSION;
   
+  // Wire versions we can speak; the registry answers with the one to use
+  JsonArray wire = doc["wire"].to<JsonArray>();
+  wire.add(P2P_WIRE_V1_JSON);
+  wire.add(P2P_WIRE_V2_MSGPACK);
+  
   // Tell registry what symbols we're tracking
   JsonArray symbols = doc["symbols"].to<JsonArray>();
   for (int i = 0; i < rotationCount; i++) {
@@ -764,15 +1450,23 @@ bool p2pRegister() {
   String body;
   serializeJson(doc, body);
   
+  uint32_t callStartMs = millis();
   int code = http.POST(body);
+  String payload = code == 200 ? http.getString() : String();
+  dataStatsRecordCall(PROVIDER_P2P_REGISTRY, code, millis() - callStartMs, payload.length(), body.length());
   
   if (code == 200) {
-    String payload = http.getString();
     JsonDocument resp;
     deserializeJson(resp, payload);
     p2pNodesOnline = resp["nodesOnline"] | 0;
+    // Registries that predate negotiation don't send "wire": stay on v1 JSON
+    int wireVersion = resp["wire"] | P2P_WIRE_V1_JSON;
+    p2pWireVersion = (wireVersion >= P2P_WIRE_V1_JSON && wireVersion <= P2P_WIRE_LATEST) ? wireVersion : P2P_WIRE_V1_JSON;
     p2pRegistered = true;
-    Serial.printf("[P2P] Registered as %s (%d nodes online)\n", p2pNodeId.c_str(), p2pNodesOnline);
+    p2pWarmPending = true;
+    p2pAckedVersion = 0;  // The registry may have lost our entries: next heartbeat is a full sync
+    Serial.printf("[P2P] Registered as %s (%d nodes online, wire v%u)\n", p2pNodeId.c_str(), p2pNodesOnline,
+                  p2pWireVersion);
   } else {
     Serial.printf("[P2P] Registration failed: %d\n", code);
   }
@@ -781,7 +1475,11 @@ bool p2pRegister() {
   return p2pRegistered;
 }
 
-// Send heartbeat and push cached stock data to registry
+// Send heartbeat and push cached stock data to registry.
+// Only entries written since the last accepted heartbeat are sent (a delta);
+// every P2P_FULL_SYNC_EVERY-th heartbeat and the first after registering send
+// everything, so a registry that dropped entries recovers. With nothing
+// changed the heartbeat is just a keep-alive.
 bool p2pHeartbeat() {
   if (WiFi.status() != WL_CONNECTED) return false;
   
@@ -792,23 +1490,45 @@ bool p2pHeartbeat() {
   
   HTTPClient http;
   http.begin(String(P2P_REGISTRY_URL) + "/heartbeat");
-  http.addHeader("Content-Type", "application/json");
   http.addHeader("X-Network-Key", P2P_NETWORK_KEY);
   http.setTimeout(10000);
   
   JsonDocument doc;
   doc["nodeId"] = p2pNodeId;
+  bool binary = p2pWireVersion >= P2P_WIRE_V2_MSGPACK;
+  bool full = p2pAckedVersion == 0 || p2pHeartbeatsSinceFull + 1 >= P2P_FULL_SYNC_EVERY;
+  uint32_t sendingVersion = symbolCacheVersion;
+  doc["full"] = full;
+  int entriesSent = 0;
   
   // Push cached stock data
-  JsonObject stockData = doc["stockData"].to<JsonObject>();
+  JsonObject stockData;
+  JsonArray quotes;
+  if (binary) {
+    doc["v"] = P2P_WIRE_V2_MSGPACK;
+    quotes = doc["quotes"].to<JsonArray>();
+  } else {
+    stockData = doc["stockData"].to<JsonObject>();
+  }
   uint32_t now = millis();
   
   for (int i = 0; i < symbolCacheCount; i++) {
     if (!symbolCache[i].valid) continue;
+    if (!full && symbolCache[i].version <= p2pAckedVersion) continue;  // Registry already has it
     
-    // Only push data less than 10 minutes old
+    // Only push data the freshness policy still allows on the network
     uint32_t ageMs = now - symbolCache[i].fetchTime;
-    if (ageMs > (P2P_STOCK_MAX_AGE_SEC * 1000)) continue;
+    if (ageMs > freshnessTtlMs(FIELD_PEER_QUOTE, currentMarketPhase())) continue;
+    
+    entriesSent++;
+    if (binary) {
+      PrefetchedData data = {false};
+      PeerQuote quote;
+      cachedToPrefetched(symbolCache[i], data);
+      prefetchedToPeerQuote(data, quote);
+      p2pWireEncodeQuote(quotes.add<JsonArray>(), quote, true);
+      continue;
+    }
     
     JsonObject stock = stockData[symbolCache[i].symbol].to<JsonObject>();
     stock["price"] = symbolCache[i].priceStr;
@@ -816,7 +1536,8 @@ bool p2pHeartbeat() {
     stock["dollarChange"] = symbolCache[i].dollarChangeStr;
     stock["volume"] = symbolCache[i].volumeStr;
     stock["ohl"] = symbolCache[i].ohlStr;
-    stock["name"] = symbolCache[i].companyName;
+    const char *tableName = symbolTableName(symbolCache[i].symbol.c_str(), false);
+    stock["name"] = tableName ? tableName : symbolCache[i].companyName.c_str();
     stock["low"] = symbolCache[i].low;
     stock["high"] = symbolCache[i].high;
     stock["fiftyTwoLow"] = symbolCache[i].fiftyTwoLow;
@@ -827,18 +1548,35 @@ bool p2pHeartbeat() {
     stock["timestamp"] = timeClient.getEpochTime() - (ageMs / 1000);
   }
   
-  String body;
-  serializeJson(doc, body);
-  
-  int code = http.POST(body);
+  // Serialize into one exact-size buffer (no String growth/reallocation)
+  size_t bodyLen = binary ? measureMsgPack(doc) : measureJson(doc);
+  uint8_t *body = (uint8_t *)malloc(bodyLen + 1);
+  if (body == nullptr) {
+    http.end();
+    return false;
+  }
+  if (binary) {
+    serializeMsgPack(doc, body, bodyLen);
+  } else {
+    serializeJson(doc, (char *)body, bodyLen + 1);
+  }
+  doc.clear();
+  http.addHeader("Content-Type", binary ? P2P_WIRE_MSGPACK_TYPE : "application/json");
+  uint32_t callStartMs = millis();
+  int code = http.POST(body, bodyLen);
+  free(body);
+  String payload = code == 200 ? http.getString() : String();
+  dataStatsRecordCall(PROVIDER_P2P_REGISTRY, code, millis() - callStartMs, payload.length(), bodyLen);
   
   if (code == 200) {
-    String payload = http.getString();
     JsonDocument resp;
     deserializeJson(resp, payload);
     p2pNodesOnline = resp["nodesOnline"] | p2pNodesOnline;
     p2pStocksCached = resp["stocksCached"] | p2pStocksCached;
-    Serial.printf("[P2P] Heartbeat OK (%d nodes, %d stocks)\n", p2pNodesOnline, p2pStocksCached);
+    p2pAckedVersion = sendingVersion;
+    p2pHeartbeatsSinceFull = full ? 0 : p2pHeartbeatsSinceFull + 1;
+    Serial.printf("[P2P] Heartbeat OK (%s, %d entries, %u bytes; %d nodes, %d stocks)\n", full ? "full" : "delta",
+                  entriesSent, (unsigned)bodyLen, p2pNodesOnline, p2pStocksCached);
   } else if (code == 404) {
     // Node expired, re-register
     p2pRegistered = false;
@@ -851,20 +1589,76 @@ bool p2pHeartbeat() {
   return (code == 200);
 }
 
+// True if the last bulk lookup (within one quote TTL) already asked for this symbol
+static bool p2pBulkCovers(const String& symbol) {
+  if (p2pBulkSymbolCount == 0 || millis() - p2pBulkAt > freshnessTtlMs(FIELD_QUOTE, currentMarketPhase())) {
+    return false;
+  }
+  for (int i = 0; i < p2pBulkSymbolCount; i++) {
+    if (p2pBulkSymbols[i] == symbol) return true;
+  }
+  return false;
+}
+
 // Try to fetch stock data from P2P network
 bool p2pFetchStock(const String& symbol, PrefetchedData& outData) {
   if (WiFi.status() != WL_CONNECTED) return false;
   
+  // The registry just answered for this symbol in bulk: it has nothing newer than
+  // what that stored, so skip the round trip. The stored copy is only shown
+  // within the normal quote TTL (not the longer peer TTL); past that, /stock
+  // couldn't do better either, so fall through to the APIs.
+  if (p2pBulkCovers(symbol)) {
+    CachedStockData* cached = findCachedSymbol(symbol);
+    if (cached == nullptr || millis() - cached->fetchTime > freshnessTtlMs(FIELD_QUOTE, currentMarketPhase())) {
+      return false;
+    }
+    cachedToPrefetched(*cached, outData);
+    Serial.printf("[P2P] %s covered by bulk lookup %lus ago\n", symbol.c_str(), (unsigned long)((millis() - p2pBulkAt) / 1000));
+    return true;
+  }
+  
   HTTPClient http;
   http.begin(String(P2P_REGISTRY_URL) + "/stock/" + symbol);
   http.addHeader("X-Network-Key", P2P_NETWORK_KEY);
-  http.setTimeout(8000);
+  applyFetchTimeouts(http, 8000);
+  const char *headerKeys[] = {"Content-Type"};
+  http.collectHeaders(headerKeys, 1);
+  if (p2pWireVersion >= P2P_WIRE_V2_MSGPACK) {
+    http.addHeader("Accept", P2P_WIRE_MSGPACK_TYPE);
+  }
   
+  uint32_t callStartMs = millis();
   int code = http.GET();
   
+  // v2: numeric MessagePack quote, decoded straight off the socket
+  if (code == 200 && http.header("Content-Type").startsWith(P2P_WIRE_MSGPACK_TYPE)) {
+    DataStatsCountingStream body(http.getStream(), 8000);
+    JsonDocument doc;
+    DeserializationError err = deserializeMsgPack(doc, body);
+    http.end();
+    dataStatsRecordCall(PROVIDER_P2P_REGISTRY, code, millis() - callStartMs, body.count());
+    
+    PeerQuote quote;
+    if (err || !(doc["found"] | false) || !p2pWireDecodeQuote(doc["q"].as<JsonArrayConst>(), quote)) {
+      Serial.printf("[P2P] No data for %s in network\n", symbol.c_str());
+      return false;
+    }
+    uint32_t nowEpoch = timeClient.getEpochTime();
+    uint32_t ageSeconds = nowEpoch > quote.timestamp ? nowEpoch - quote.timestamp : 0;
+    if (ageSeconds * 1000 > freshnessTtlMs(FIELD_PEER_QUOTE, currentMarketPhase())) {
+      Serial.printf("[P2P] Data for %s too old (%lus)\n", symbol.c_str(), (unsigned long)ageSeconds);
+      return false;
+    }
+    peerQuoteToPrefetched(quote, outData);
+    Serial.printf("[P2P] Got %s from network (age: %lus, v2)\n", symbol.c_str(), (unsigned long)ageSeconds);
+    return true;
+  }
+  
   if (code == 200) {
     String payload = http.getString();
     http.end();
+    dataStatsRecordCall(PROVIDER_P2P_REGISTRY, code, millis() - callStartMs, payload.length());
     
     JsonDocument doc;
     DeserializationError err = deserializeJson(doc, payload);
@@ -877,7 +1671,7 @@ bool p2pFetchStock(const String& symbol, PrefetchedData& outData) {
     int ageSeconds = doc["ageSeconds"] | 9999;
     
     // Reject if too old
-    if (ageSeconds > P2P_STOCK_MAX_AGE_SEC) {
+    if ((uint32_t)ageSeconds * 1000 > freshnessTtlMs(FIELD_PEER_QUOTE, currentMarketPhase())) {
       Serial.printf("[P2P] Data for %s too old (%ds)\n", symbol.c_str(), ageSeconds);
       return false;
     }
@@ -931,6 +1725,11 @@ bool p2pFetchStock(const String& symbol, PrefetchedData& outData) {
     else if (volStr.endsWith("K")) { volMult = 1e3; volStr.replace("K", ""); }
     outData.volume = volStr.toFloat() * volMult;
     
+    outData.fetchTime = millis() - (uint32_t)ageSeconds * 1000;
+    outData.rangeFetchTime = outData.fiftyTwoHigh > 0 ? outData.fetchTime : 0;
+    outData.stale = false;
+    outData.fromPeer = true;
+    outData.fields = peerFields(outData.fiftyTwoHigh);
     outData.valid = true;
     
     Serial.printf("[P2P] Got %s from network (age: %ds)\n", symbol.c_str(), ageSeconds);
@@ -938,9 +1737,119 @@ bool p2pFetchStock(const String& symbol, PrefetchedData& outData) {
   }
   
   http.end();
+  dataStatsRecordCall(PROVIDER_P2P_REGISTRY, code, millis() - callStartMs, 0);
   return false;
 }
 
+// Bulk lookup: one GET /stocks?symbols=A,B,C replaces a round trip per symbol.
+// The registry answers (v2 only) with a MessagePack header {"v":2,"n":count}
+// followed by `count` quote arrays (p2p_wire.h layout). Each quote is decoded
+// off the socket and cached as it arrives, so one small JsonDocument covers
+// the whole response. Returns how many symbols were cached.
+int p2pFetchBulk(const String* symbols, int count) {
+  if (WiFi.status() != WL_CONNECTED || count <= 0) return 0;
+  if (p2pWireVersion < P2P_WIRE_V2_MSGPACK || !p2pBulkSupported) return 0;
+  if (count > P2P_BULK_MAX_SYMBOLS) count = P2P_BULK_MAX_SYMBOLS;
+  
+  uint32_t maxAgeMs = freshnessTtlMs(FIELD_PEER_QUOTE, currentMarketPhase());
+  String url = String(P2P_REGISTRY_URL) + "/stocks?age=" + String(maxAgeMs / 1000) + "&symbols=";
+  for (int i = 0; i < count; i++) {
+    if (i > 0) url += ',';
+    url += symbols[i];
+  }
+  
+  HTTPClient http;
+  http.useHTTP10(true);  // No chunked framing, so the body can be read straight off the socket
+  http.begin(url);
+  http.addHeader("X-Network-Key", P2P_NETWORK_KEY);
+  http.addHeader("Accept", P2P_WIRE_MSGPACK_TYPE);
+  http.setTimeout(8000);
+  
+  uint32_t callStartMs = millis();
+  int code = http.GET();
+  if (code != 200) {
+    http.end();
+    dataStatsRecordCall(PROVIDER_P2P_REGISTRY, code, millis() - callStartMs, 0);
+    if (code == 404) {
+      p2pBulkSupported = false;  // Older registry: rotation falls back to /stock/{symbol}
+      Serial.println("[P2P] Registry has no bulk endpoint, using per-symbol lookups");
+    }
+    return 0;
+  }
+  
+  DataStatsCountingStream stream(http.getStream(), 8000);
+  JsonDocument doc;
+  int expected = 0;
+  if (!deserializeMsgPack(doc, stream)) {
+    expected = doc["n"] | 0;
+    for (int i = 0; i < count; i++) p2pBulkSymbols[i] = symbols[i];
+    p2pBulkSymbolCount = count;
+    p2pBulkAt = millis();
+  }
+  
+  int cached = 0;
+  uint32_t now = millis();
+  for (int i = 0; i < expected && i < count; i++) {
+    if (deserializeMsgPack(doc, stream)) break;
+    PeerQuote quote;
+    if (!p2pWireDecodeQuote(doc.as<JsonArrayConst>(), quote)) continue;
+    
+    PrefetchedData data = {false};
+    peerQuoteToPrefetched(quote, data);
+    if (now - data.fetchTime > maxAgeMs || !cachePeerQuote(data)) continue;
+    dataStatsHit(CACHE_P2P);
+    cached++;
+  }
+  http.end();
+  dataStatsRecordCall(PROVIDER_P2P_REGISTRY, code, millis() - callStartMs, stream.count());
+  for (int i = expected; i < count; i++) dataStatsMiss(CACHE_P2P);
+  
+  Serial.printf("[P2P] Bulk lookup: %d/%d symbols held, %d cached in %lu ms\n", expected, count, cached,
+                (unsigned long)(millis() - callStartMs));
+  return cached;
+}
+
+// Fill symbolCache for every rotation symbol that is missing or has a stale quote
+void p2pWarmRotation() {
+  if (!rotationEnabled || rotationCount < 2) return;
+  String wanted[P2P_BULK_MAX_SYMBOLS];
+  int wantedCount = 0;
+  for (int i = 0; i < rotationCount && wantedCount < P2P_BULK_MAX_SYMBOLS; i++) {
+    CachedStockData* cached = findCachedSymbol(rotationSymbols[i]);
+    if (cached != nullptr) {
+      FreshnessReport report;
+      evaluateFreshness(*cached, report);
+      if (!report.isStale(FIELD_QUOTE)) continue;
+    }
+    wanted[wantedCount++] = rotationSymbols[i];
+  }
+  if (wantedCount > 0) p2pFetchBulk(wanted, wantedCount);
+}
+
+// Rotation list changed: warm it on the next tick
+void p2pRequestWarm() {
+  p2pWarmPending = true;
+}
+
+// Heartbeats follow the data rather than a fixed timer. A local fetch makes
+// an upload due P2P_HEARTBEAT_SETTLE_MS later (so a rotation burst goes out as
+// one delta), at most once per P2P_HEARTBEAT_MIN_GAP_MS; peers then see quotes
+// seconds old instead of up to ten minutes old, well inside the peer TTL.
+// With nothing new, a keep-alive goes out during market hours only: while the
+// market is closed the client stays dormant, the registry expires the node,
+// and the first heartbeat after the open re-registers it.
+static bool p2pHeartbeatDue(uint32_t now) {
+  uint32_t sinceLast = now - lastP2PHeartbeat;
+  if (symbolCacheVersion > p2pAckedVersion) {
+    if (p2pPendingSince == 0) p2pPendingSince = now;
+    if ((now - p2pPendingSince) >= P2P_HEARTBEAT_SETTLE_MS && sinceLast >= P2P_HEARTBEAT_MIN_GAP_MS) return true;
+  } else {
+    p2pPendingSince = 0;
+  }
+  if (sinceLast < P2P_HEARTBEAT_KEEPALIVE_MS) return false;
+  return currentMarketPhase() != PHASE_CLOSED;
+}
+
 // P2P tick - call this in main loop
 void p2pTick() {
   if (WiFi.status() != WL_CONNECTED) return;
@@ -954,16 +1863,27 @@ void p2pTick() {
     return;
   }
   
-  // Periodic heartbeat
-  if ((now - lastP2PHeartbeat) >= P2P_HEARTBEAT_INTERVAL_MS) {
+  if (p2pHeartbeatDue(now)) {
     p2pHeartbeat();
     lastP2PHeartbeat = now;
   }
+  
+  // Keep the rotation warm with one bulk request per quote TTL instead of a
+  // /stock round trip per symbol at rotation time. Dormant while the market
+  // is closed; a pending warm-up waits for the open.
+  MarketPhase phase = currentMarketPhase();
+  if (phase == PHASE_CLOSED) return;
+  if (p2pWarmPending || (now - lastP2PWarm) >= freshnessTtlMs(FIELD_QUOTE, phase)) {
+    p2pWarmPending = false;
+    lastP2PWarm = now;
+    p2pWarmRotation();
+  }
 }
 
 #else
 // P2P disabled stubs
 inline void p2pTick() {}
+inline void p2pRequestWarm() {}
 inline bool p2pFetchStock(const String& symbol, PrefetchedData& outData) { return false; }
 #endif // P2P_ENABLED
 
@@ -978,6 +1898,7 @@ CachedStockData cachedData = {false};
 // Multi-symbol cache for rotation (up to 20 symbols)
 CachedStockData symbolCache[20];
 int symbolCacheCount = 0;
+uint32_t symbolCacheVersion = 0;
 
 // Find cached data for a symbol
 CachedStockData* findCachedSymbol(const String& symbol) {
@@ -989,21 +1910,93 @@ CachedStockData* findCachedSymbol(const String& symbol) {
   return nullptr;
 }
 
-// Add or update symbol in cache
-void cacheSymbolData(const CachedStockData& data) {
+// Add or update symbol in cache. Entries from peers/registry get version 0 so
+// delta heartbeats don't upload them back (full syncs still include them), and
+// re-caching the same quote (a repaint) keeps its version.
+void cacheSymbolData(const CachedStockData& data, bool fromPeer) {
   // Check if symbol already exists in cache
+  dataStatsInsert(CACHE_QUOTE);
   for (int i = 0; i < symbolCacheCount; i++) {
     if (symbolCache[i].symbol == data.symbol) {
+      bool sameQuote = symbolCache[i].fetchTime == data.fetchTime;
+      uint32_t version = symbolCache[i].version;
       symbolCache[i] = data;
+      symbolCache[i].version = sameQuote ? version : (fromPeer ? 0 : ++symbolCacheVersion);
       return;
     }
   }
   // Add new entry if space available
   if (symbolCacheCount < 20) {
-    symbolCache[symbolCacheCount++] = data;
+    symbolCache[symbolCacheCount] = data;
+    symbolCache[symbolCacheCount++].version = fromPeer ? 0 : ++symbolCacheVersion;
+    dataStatsSetBytes(CACHE_QUOTE, symbolCacheCount * sizeof(CachedStockData));
+  } else {
+    dataStatsEvict(CACHE_QUOTE);  // Full: the new entry is dropped
   }
 }
 
+// ============ Intraday Price History ============
+// Per-symbol compressed tick history (see price_history.h), kept in PSRAM.
+// 2 KB blocks at ~3 bytes/point hold ~680 one-minute ticks (~1.7 sessions);
+// 16 blocks per symbol is ~4 weeks of regular-hours history in 32 KB.
+const size_t PRICE_HISTORY_BLOCK_BYTES = 2048;
+const size_t PRICE_HISTORY_MAX_BLOCKS = 16;
+const uint32_t PRICE_HISTORY_MIN_SPACING_SEC = 30;  // Re-painting a cached quote must not add a point
+
+struct PriceHistorySlot {
+  String symbol;
+  PriceSeries series;
+};
+PriceHistorySlot priceHistory[20];
+int priceHistoryCount = 0;
+
+static void *priceHistoryAlloc(size_t size) {
+  void *p = heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+  return p ? p : malloc(size);
+}
+
+PriceSeries* findPriceHistory(const String& symbol) {
+  for (int i = 0; i < priceHistoryCount; i++) {
+    if (priceHistory[i].symbol == symbol) return &priceHistory[i].series;
+  }
+  return nullptr;
+}
+
+// Record a quote observed at `epoch`. Only called for live (market-open) quotes.
+void recordPriceHistory(const String& symbol, uint32_t epoch, float price) {
+  if (price <= 0 || epoch < 1000000000UL) return;  // Skip until NTP has synced
+  PriceSeries* series = findPriceHistory(symbol);
+  if (!series) {
+    if (priceHistoryCount >= 20) return;
+    PriceHistorySlot& slot = priceHistory[priceHistoryCount++];
+    slot.symbol = symbol;
+    slot.series.init(PRICE_HISTORY_BLOCK_BYTES, PRICE_HISTORY_MAX_BLOCKS, priceHistoryAlloc, free);
+    series = &slot.series;
+  }
+  if (series->count() > 0 && epoch < series->lastTimestamp() + PRICE_HISTORY_MIN_SPACING_SEC) return;
+  size_t evictedBefore = series->evictedBlocks();
+  if (!series->append(epoch, price)) {
+    Serial.printf("[HISTORY] Append failed for %s (out of memory?)\n", symbol.c_str());
+    return;
+  }
+  dataStatsInsert(CACHE_PRICE_HISTORY);
+  if (series->evictedBlocks() != evictedBefore) dataStatsEvict(CACHE_PRICE_HISTORY);
+  size_t bytes = 0;
+  for (int i = 0; i < priceHistoryCount; i++) bytes += priceHistory[i].series.bytesUsed();
+  dataStatsSetBytes(CACHE_PRICE_HISTORY, bytes);
+}
+
+// 1-Month data cache (per symbol, fetched once daily)
+struct OneMonthCache {
+  String symbol;
+  float low;
+  float high;
+  uint32_t fetchTime;  // millis() when fetched; expires per FRESHNESS_POLICY "1m"
+  bool valid;
+};
+OneMonthCache oneMonthCache[20];
+int oneMonthCacheCount = 0;
+
 // Last time we checked if market reopened (when closed)
 uint32_t lastMarketCheck = 0;
 const uint32_t MARKET_CLOSED_CHECK_INTERVAL = 3600000;  // 1 hour (default)
@@ -1043,20 +2036,102 @@ bool isNearMarketTransition() {
   return false;
 }
 
+// Market phase for freshness decisions. If rotation is enabled, we may not be
+// calling fetchPrice() periodically, which can leave isMarketOpen stale (e.g.,
+// stuck true after the close), so the market counts as closed when either the
+// API last said so or the local time is outside regular hours.
+MarketPhase currentMarketPhase() {
+  if (!isMarketOpen || !isRegularMarketHoursByTime()) return PHASE_CLOSED;
+  return isNearMarketTransition() ? PHASE_TRANSITION : PHASE_OPEN;
+}
+
+static const char* const MARKET_PHASE_NAMES[PHASE_COUNT] = {"open", "transition", "closed"};
+
+// Apply one policy rule to a field fetched at fetchMs (millis).
+static StaleReason checkFieldFreshness(FreshField field, MarketPhase phase, bool present,
+                                       uint32_t fetchMs, uint32_t& ageMs) {
+  ageMs = 0;
+  if (!present) return STALE_MISSING;
+  uint32_t ttl = freshnessTtlMs(field, phase);
+  if (ttl == TTL_NEVER) return STALE_NONE;
+  ageMs = millis() - fetchMs;
+  if (ttl == TTL_CALENDAR_DAY) {
+    uint32_t nowEpoch = timeClient.getEpochTime();
+    uint32_t fetchedEpoch = nowEpoch - ageMs / 1000;
+    return (nowEpoch / 86400 != fetchedEpoch / 86400) ? STALE_DAY_ROLLOVER : STALE_NONE;
+  }
+  return ageMs > ttl ? STALE_EXPIRED : STALE_NONE;
+}
+
+OneMonthCache* findOneMonthCache(const String& symbol);
+
+// Evaluate every field of a cached entry against FRESHNESS_POLICY.
+// Returns true if any field the display depends on (quote, ranges) is stale
+// and the entry's source fills it in: a Finnhub quote never has a 52-week
+// range, and revalidating it for one would only buy another Finnhub quote.
+bool evaluateFreshness(const CachedStockData& entry, FreshnessReport& report) {
+  report.phase = currentMarketPhase();
+  report.staleMask = 0;
+
+  // Captured while the market was still open: use the open window once to pick up the close.
+  MarketPhase quotePhase = (report.phase == PHASE_CLOSED && entry.marketOpen) ? PHASE_OPEN : report.phase;
+  OneMonthCache* month = findOneMonthCache(entry.symbol);
+  bool hasName = symbolTableName(entry.symbol.c_str(), false) != nullptr || entry.companyName.length() > 0;
+
+  report.reason[FIELD_QUOTE] = checkFieldFreshness(FIELD_QUOTE, quotePhase, entry.valid,
+                                                   entry.fetchTime, report.ageMs[FIELD_QUOTE]);
+  report.reason[FIELD_RANGE_52W] = checkFieldFreshness(FIELD_RANGE_52W, report.phase,
+                                                       entry.fiftyTwoHigh > 0 && entry.rangeFetchTime != 0,
+                                                       entry.rangeFetchTime, report.ageMs[FIELD_RANGE_52W]);
+  report.reason[FIELD_RANGE_1M] = checkFieldFreshness(FIELD_RANGE_1M, report.phase, month != nullptr,
+                                                      month ? month->fetchTime : 0, report.ageMs[FIELD_RANGE_1M]);
+  report.reason[FIELD_NAME] = checkFieldFreshness(FIELD_NAME, report.phase, hasName, 0, report.ageMs[FIELD_NAME]);
+  report.reason[FIELD_PEER_QUOTE] = checkFieldFreshness(FIELD_PEER_QUOTE, report.phase, entry.valid,
+                                                        entry.fetchTime, report.ageMs[FIELD_PEER_QUOTE]);
+
+  for (uint8_t f = 0; f < FIELD_COUNT; f++) {
+    if (report.reason[f] != STALE_NONE) report.staleMask |= (1u << f);
+  }
+  uint8_t sourceFields = entry.fields != 0 ? entry.fields : FIELDS_TWELVEDATA;  // 0: source unknown, check everything
+  return report.staleMask & sourceFields & ((1u << FIELD_QUOTE) | (1u << FIELD_RANGE_52W) | (1u << FIELD_RANGE_1M));
+}
+
+// Human-readable list of stale fields, e.g. "quote expired 183s>120s; 1m day-rollover (open)"
+String describeStaleness(const FreshnessReport& report) {
+  String out;
+  for (uint8_t f = 0; f < FIELD_COUNT; f++) {
+    if (!report.isStale((FreshField)f)) continue;
+    if (out.length() > 0) out += "; ";
+    out += FRESHNESS_POLICY[f].name;
+    switch (report.reason[f]) {
+      case STALE_MISSING: out += " missing"; break;
+      case STALE_DAY_ROLLOVER: out += " day-rollover"; break;
+      case STALE_EXPIRED: {
+        char buf[32];
+        snprintf(buf, sizeof(buf), " expired %lus>%lus", (unsigned long)(report.ageMs[f] / 1000),
+                 (unsigned long)(freshnessTtlMs((FreshField)f, report.phase) / 1000));
+        out += buf;
+        break;
+      }
+      default: break;
+    }
+  }
+  if (out.length() == 0) out = "all fresh";
+  out += " (";
+  out += MARKET_PHASE_NAMES[report.phase];
+  out += ")";
+  return out;
+}
+
 // PrefetchedData struct is defined earlier (before P2P code)
 // Just declare the instance here
 PrefetchedData prefetchedStock = {false};
 
-// 1-Month data cache (per symbol, fetched once daily)
-struct OneMonthCache {
-  String symbol;
-  float low;
-  float high;
-  int fetchDay;  // Day of month when fetched
-  bool valid;
-};
-OneMonthCache oneMonthCache[20];
-int oneMonthCacheCount = 0;
+// Stale-while-revalidate: age indicator threshold and the pending refresh
+// (freshness windows themselves live in FRESHNESS_POLICY)
+const uint32_t SWR_AGE_INDICATOR_MS = 60000;        // Show "(Nm ago)" once data is older than this
+String swrRevalidateSymbol = "";
+bool swrRevalidatePending = false;
 
 // WiFi setup state
 lv_obj_t *wifiPopup = nullptr;
@@ -1104,6 +2179,7 @@ void parseRotationList() {
     }
   }
   rotationIndex = 0;
+  p2pRequestWarm();
 }
 
 // Forward declaration
@@ -1123,17 +2199,20 @@ bool fetchFromFinnhub(const String& symbol) {
   // Finnhub quote endpoint
   String url = "https://finnhub.io/api/v1/quote?symbol=" + symbol + "&token=" + finnhubApiKey;
   http.begin(url);
-  http.setTimeout(5000);
+  applyFetchTimeouts(http, 5000);
+  uint32_t callStartMs = millis();
   int code = http.GET();
   
   if (code != 200) {
     dualLog("[FINNHUB] HTTP error: %d\n", code);
     http.end();
+    dataStatsRecordCall(PROVIDER_FINNHUB, code, millis() - callStartMs, 0);
     return false;
   }
   
   String payload = http.getString();
   http.end();
+  dataStatsRecordCall(PROVIDER_FINNHUB, code, millis() - callStartMs, payload.length());
   
   JsonDocument doc;
   DeserializationError err = deserializeJson(doc, payload);
@@ -1171,6 +2250,11 @@ bool fetchFromFinnhub(const String& symbol) {
   prefetchedStock.fiftyTwoHigh = 0.0f;
   prefetchedStock.oneMonthLow = 0.0f;
   prefetchedStock.oneMonthHigh = 0.0f;
+  prefetchedStock.fetchTime = millis();
+  prefetchedStock.rangeFetchTime = 0;
+  prefetchedStock.stale = false;
+  prefetchedStock.fromPeer = false;
+  prefetchedStock.fields = FIELDS_QUOTE_ONLY;
   prefetchedStock.valid = true;
   
   dualLog("[FINNHUB] OK: %s $%.2f (%.2f%%)\n", symbol.c_str(), currentPrice, pctChange);
@@ -1190,178 +2274,685 @@ bool fetchFromPolygon(const String& symbol) {
   // Polygon previous day endpoint (free tier)
   String url = "https://api.polygon.io/v2/aggs/ticker/" + symbol + "/prev?adjusted=true&apiKey=" + polygonApiKey;
   http.begin(url);
-  http.setTimeout(5000);
+  applyFetchTimeouts(http, 5000);
+  uint32_t callStartMs = millis();
   int code = http.GET();
   
   if (code != 200) {
     dualLog("[POLYGON] HTTP error: %d\n", code);
     http.end();
+    dataStatsRecordCall(PROVIDER_POLYGON, code, millis() - callStartMs, 0);
+    return false;
+  }
+  
+  String payload = http.getString();
+  http.end();
+  dataStatsRecordCall(PROVIDER_POLYGON, code, millis() - callStartMs, payload.length());
+  
+  JsonDocument doc;
+  DeserializationError err = deserializeJson(doc, payload);
+  if (err) {
+    dualLog("[POLYGON] JSON error: %s\n", err.c_str());
+    return false;
+  }
+  
+  // Polygon returns: results[0].c=close, h=high, l=low, o=open, v=volume, vw=vwap
+  JsonArray results = doc["results"];
+  if (results.size() == 0) {
+    dualLog("[POLYGON] No results returned\n");
+    return false;
+  }
+  
+  JsonObject result = results[0];
+  float closePrice = result["c"] | 0.0f;
+  float openPrice = result["o"] | 0.0f;
+  
+  if (closePrice == 0.0f) {
+    dualLog("[POLYGON] No price data in response\n");
+    return false;
+  }
+  
+  // Calculate percent change from open
+  float pctChange = 0.0f;
+  if (openPrice > 0) {
+    pctChange = ((closePrice - openPrice) / openPrice) * 100.0f;
+  }
+  
+  prefetchedStock.symbol = symbol;
+  prefetchedStock.closePrice = closePrice;
+  prefetchedStock.prevClose = openPrice;  // Use open as prev close
+  prefetchedStock.pctChange = pctChange;
+  prefetchedStock.openPrice = openPrice;
+  prefetchedStock.highPrice = result["h"] | 0.0f;
+  prefetchedStock.lowPrice = result["l"] | 0.0f;
+  prefetchedStock.volume = result["v"] | 0.0;
+  prefetchedStock.companyName = "";
+  prefetchedStock.marketOpen = false;  // prev endpoint = market was closed
+  prefetchedStock.fiftyTwoLow = 0.0f;
+  prefetchedStock.fiftyTwoHigh = 0.0f;
+  prefetchedStock.oneMonthLow = 0.0f;
+  prefetchedStock.oneMonthHigh = 0.0f;
+  prefetchedStock.fetchTime = millis();
+  prefetchedStock.rangeFetchTime = 0;
+  prefetchedStock.stale = false;
+  prefetchedStock.fromPeer = false;
+  prefetchedStock.fields = FIELDS_QUOTE_ONLY;
+  prefetchedStock.valid = true;
+  
+  dualLog("[POLYGON] OK: %s $%.2f (%.2f%%)\n", symbol.c_str(), closePrice, pctChange);
+  return true;
+}
+
+// Rebuild numeric quote fields from a cache entry's display strings.
+void cachedToPrefetched(const CachedStockData& cached, PrefetchedData& out) {
+  out.symbol = cached.symbol;
+  out.companyName = cached.companyName;
+  out.lowPrice = cached.low;
+  out.highPrice = cached.high;
+  out.fiftyTwoLow = cached.fiftyTwoLow;
+  out.fiftyTwoHigh = cached.fiftyTwoHigh;
+  out.rangeFetchTime = cached.rangeFetchTime;
+  out.marketOpen = cached.marketOpen;
+  
+  // Parse price from cached string (e.g., "$485.92")
+  String priceStr = cached.priceStr;
+  priceStr.replace("$", "");
+  priceStr.replace(",", "");
+  out.closePrice = priceStr.toFloat();
+  
+  // Parse percent change from cached string (e.g., "+0.40%" or "-1.23%")
+  String pctStr = cached.changeStr;
+  pctStr.replace("%", "");
+  pctStr.replace("+", "");
+  out.pctChange = pctStr.toFloat();
+  
+  // Parse dollar change (e.g., "+$1.94" or "-$2.50")
+  String dollarStr = cached.dollarChangeStr;
+  dollarStr.replace("$", "");
+  dollarStr.replace("+", "");
+  float dollarChange = dollarStr.toFloat();
+  out.prevClose = out.closePrice - dollarChange;
+  
+  // Parse volume from cached string (e.g., "Vol: 70.82M")
+  String volStr = cached.volumeStr;
+  volStr.replace("Vol: ", "");
+  float volMult = 1.0;
+  if (volStr.endsWith("B")) { volMult = 1000000000.0; volStr.replace("B", ""); }
+  else if (volStr.endsWith("M")) { volMult = 1000000.0; volStr.replace("M", ""); }
+  else if (volStr.endsWith("K")) { volMult = 1000.0; volStr.replace("K", ""); }
+  out.volume = volStr.toFloat() * volMult;
+  
+  // Parse open price from OHL string (e.g., "O: 487.36  H: 487.85  L: 482.49")
+  String ohlStr = cached.ohlStr;
+  int oIdx = ohlStr.indexOf("O: ");
+  int hIdx = ohlStr.indexOf("H: ");
+  if (oIdx >= 0 && hIdx > oIdx) {
+    out.openPrice = ohlStr.substring(oIdx + 3, hIdx).toFloat();
+  }
+  
+  // Restore 1-month data from cache
+  out.oneMonthLow = cached.oneMonthLow;
+  out.oneMonthHigh = cached.oneMonthHigh;
+  
+  // Keep the original fetch time so the age indicator and freshness checks stay honest
+  out.fetchTime = cached.fetchTime;
+  out.stale = false;
+  out.fromPeer = cached.version == 0;
+  out.fields = cached.fields;
+  out.valid = true;
+}
+
+// Restore a symbolCache entry into prefetchedStock (no network).
+bool loadCachedQuote(const String& symbol) {
+  CachedStockData* cached = findCachedSymbol(symbol);
+  if (cached == nullptr || !cached->valid) return false;
+  cachedToPrefetched(*cached, prefetchedStock);
+  return true;
+}
+
+// ============ P2P Wire Conversions ============
+// PrefetchedData <-> PeerQuote (numeric v2 wire form, see p2p_wire.h)
+void prefetchedToPeerQuote(const PrefetchedData& data, PeerQuote& out) {
+  memset(&out, 0, sizeof(out));
+  strlcpy(out.symbol, data.symbol.c_str(), sizeof(out.symbol));
+  // Always send the name: the receiver (or the registry) may have an older
+  // symbol table, or none at all
+  const char *tableName = symbolTableName(data.symbol.c_str(), false);
+  strlcpy(out.name, data.companyName.length() ? data.companyName.c_str() : (tableName ? tableName : ""),
+          sizeof(out.name));
+  out.price = data.closePrice;
+  out.prevClose = data.prevClose;
+  out.open = data.openPrice;
+  out.high = data.highPrice;
+  out.low = data.lowPrice;
+  out.volume = data.volume;
+  out.fiftyTwoLow = data.fiftyTwoLow;
+  out.fiftyTwoHigh = data.fiftyTwoHigh;
+  out.oneMonthLow = data.oneMonthLow;
+  out.oneMonthHigh = data.oneMonthHigh;
+  out.marketOpen = data.marketOpen;
+  out.timestamp = timeClient.getEpochTime() - (millis() - data.fetchTime) / 1000;
+}
+
+void peerQuoteToPrefetched(const PeerQuote& quote, PrefetchedData& out) {
+  uint32_t nowEpoch = timeClient.getEpochTime();
+  uint32_t ageSec = nowEpoch > quote.timestamp ? nowEpoch - quote.timestamp : 0;
+  out.symbol = quote.symbol;
+  out.companyName = quote.name;
+  out.closePrice = quote.price;
+  out.prevClose = quote.prevClose;
+  out.pctChange = quote.prevClose > 0 ? (quote.price - quote.prevClose) / quote.prevClose * 100.0f : 0.0f;
+  out.openPrice = quote.open;
+  out.highPrice = quote.high;
+  out.lowPrice = quote.low;
+  out.volume = quote.volume;
+  out.fiftyTwoLow = quote.fiftyTwoLow;
+  out.fiftyTwoHigh = quote.fiftyTwoHigh;
+  out.oneMonthLow = quote.oneMonthLow;
+  out.oneMonthHigh = quote.oneMonthHigh;
+  out.marketOpen = quote.marketOpen;
+  out.fetchTime = millis() - ageSec * 1000;
+  out.rangeFetchTime = quote.fiftyTwoHigh > 0 ? out.fetchTime : 0;
+  out.stale = false;
+  out.fromPeer = true;
+  out.fields = peerFields(quote.fiftyTwoHigh);
+  out.valid = true;
+}
+
+// Store a quote received from another device in symbolCache (no UI). Returns
+// false if we already hold one at least as new, e.g. one we fetched ourselves.
+bool cachePeerQuote(const PrefetchedData& data) {
+  uint32_t now = millis();
+  CachedStockData* existing = findCachedSymbol(data.symbol);
+  if (existing != nullptr && now - existing->fetchTime <= now - data.fetchTime) return false;
+  PrefetchedData merged = data;
+  carryForwardFreshFields(merged);
+  CachedStockData entry;
+  prefetchedToCached(merged, entry);
+  cacheSymbolData(entry, true);
+  return true;
+}
+
+// ============ LAN Peers ============
+// Quote sharing between tickers on the same network (see lan_peer.h).
+// Queried before the cloud registry; answers come back in milliseconds.
+#if P2P_LAN_ENABLED
+#define LAN_OWNER_TICK_MS 5000     // Owners refresh at most one expired symbol per tick
+#define LAN_OWNER_GRACE_MS 60000   // Past TTL + grace without a push, fetch it ourselves
+#define LAN_OWNER_MAX_SYMBOLS 20   // symbolCache capacity: we can't serve what we can't cache
+#define LAN_OWNER_RETRY_MS 30000   // First backoff after a failed owner fetch, doubling
+#define LAN_OWNER_RETRY_MAX_MS 600000
+#define LAN_OWNER_FETCH_BUDGET_MS SWR_REVALIDATE_BUDGET_MS  // Runs from loop(), like SWR revalidation
+
+bool prefetchStockData(const String& symbol, bool bypassCache);
+void applyPrefetchedData();
+
+static uint32_t lastLanStartAttempt = 0;
+static uint32_t lastLanOwnerTick = 0;
+static uint32_t lastLanWatchCheck = 0;
+static uint32_t lanWatchSignature = 0;
+static bool lanPushRepaintPending = false;
+static int lanOwnerCursor = 0;  // Round-robin position in the owned list
+
+// Failed owner fetches back off per symbol so one bad ticker doesn't eat
+// the API budget every tick
+struct LanOwnerBackoff {
+  char symbol[LAN_PEER_SYMBOL_LEN];
+  uint32_t failedAt;
+  uint32_t delayMs;
+};
+static LanOwnerBackoff lanOwnerBackoff[LAN_OWNER_MAX_SYMBOLS];
+
+// Oldest quote worth taking from a peer: it must still be fresh for display
+// here, and within what the policy allows to circulate between devices.
+static uint32_t lanMaxAgeSec() {
+  MarketPhase phase = currentMarketPhase();
+  uint32_t ttl = min(freshnessTtlMs(FIELD_QUOTE, phase), freshnessTtlMs(FIELD_PEER_QUOTE, phase));
+  return ttl / 1000;
+}
+
+// Answer a LAN peer's query from symbolCache
+static bool lanLookupQuote(const char *symbol, uint32_t maxAgeSec, PeerQuote& out) {
+  CachedStockData* cached = findCachedSymbol(String(symbol));
+  if (cached == nullptr || !cached->valid) return false;
+  uint32_t ageMs = millis() - cached->fetchTime;
+  if (ageMs > (uint32_t)maxAgeSec * 1000 || ageMs > freshnessTtlMs(FIELD_PEER_QUOTE, currentMarketPhase())) {
     return false;
   }
-  
-  String payload = http.getString();
-  http.end();
-  
-  JsonDocument doc;
-  DeserializationError err = deserializeJson(doc, payload);
-  if (err) {
-    dualLog("[POLYGON] JSON error: %s\n", err.c_str());
-    return false;
+  PrefetchedData data = {false};
+  cachedToPrefetched(*cached, data);
+  prefetchedToPeerQuote(data, out);
+  return out.price > 0;
+}
+
+static uint16_t lanHeldSymbols() {
+  return (uint16_t)symbolCacheCount;
+}
+
+// Our subscription: the rotation list, or just the symbol on screen
+static int lanWatchlist(const char **out, int max) {
+  if (rotationEnabled && rotationCount > 0) {
+    int count = min(rotationCount, max);
+    for (int i = 0; i < count; i++) out[i] = rotationSymbols[i].c_str();
+    return count;
+  }
+  if (max < 1) return 0;
+  out[0] = currentSymbol.c_str();
+  return 1;
+}
+
+// A peer fetched a symbol we watch. Runs inside lanPeerTick()/lanPeerQuery(),
+// so it only updates symbolCache; loop() repaints if the symbol is on screen.
+static void lanOnPush(const PeerQuote& quote) {
+  PrefetchedData data = {false};
+  peerQuoteToPrefetched(quote, data);
+  if (!cachePeerQuote(data)) return;
+  dataStatsInsert(CACHE_LAN_PEER);
+  if (data.symbol == currentSymbol) lanPushRepaintPending = true;
+  Serial.printf("[LAN] Push: %s $%.2f\n", quote.symbol, quote.price);
+}
+
+// Share a quote this device just fetched from an API with peers watching it
+void publishFreshQuote(const PrefetchedData& data) {
+  if (!lanPeerActive() || !data.valid || data.closePrice <= 0) return;
+  PeerQuote quote;
+  prefetchedToPeerQuote(data, quote);
+  int sent = lanPeerPublish(quote);
+  if (sent > 0) Serial.printf("[LAN] Pushed %s to %d watcher(s)\n", quote.symbol, sent);
+}
+
+bool lanTakePushRepaint() {
+  bool pending = lanPushRepaintPending;
+  lanPushRepaintPending = false;
+  return pending;
+}
+
+// Sharded fetching: a live peer owns this symbol and will push fresh quotes.
+// Returns true (with prefetchedStock loaded from cache) if we should wait for
+// that push instead of calling an API; false once the owner has been silent
+// for longer than the quote TTL plus LAN_OWNER_GRACE_MS (failover).
+bool lanDeferToOwner(const String& symbol) {
+  const LanPeer* owner = lanPeerOwnerOf(symbol.c_str());
+  if (owner == nullptr) return false;
+  CachedStockData* cached = findCachedSymbol(symbol);
+  if (cached == nullptr) return false;  // Nothing to show meanwhile
+  uint32_t ageMs = millis() - cached->fetchTime;
+  if (ageMs > freshnessTtlMs(FIELD_QUOTE, currentMarketPhase()) + LAN_OWNER_GRACE_MS) {
+    dualLog("[LAN] Owner %s silent on %s for %lus - fetching it ourselves\n", owner->nodeId, symbol.c_str(),
+            (unsigned long)(ageMs / 1000));
+    return false;
+  }
+  loadCachedQuote(symbol);
+  Serial.printf("[LAN] %s is fetched by %s, waiting for its push\n", symbol.c_str(), owner->nodeId);
+  return true;
+}
+
+static LanOwnerBackoff* lanOwnerBackoffFor(const char *symbol, bool create) {
+  LanOwnerBackoff *freeSlot = nullptr;
+  for (int i = 0; i < LAN_OWNER_MAX_SYMBOLS; i++) {
+    if (strcmp(lanOwnerBackoff[i].symbol, symbol) == 0) return &lanOwnerBackoff[i];
+    if (freeSlot == nullptr && lanOwnerBackoff[i].symbol[0] == '\0') freeSlot = &lanOwnerBackoff[i];
+  }
+  if (!create) return nullptr;
+  if (freeSlot == nullptr) {
+    // Full: reuse the entry whose backoff ends soonest
+    freeSlot = &lanOwnerBackoff[0];
+    for (int i = 1; i < LAN_OWNER_MAX_SYMBOLS; i++) {
+      LanOwnerBackoff &b = lanOwnerBackoff[i];
+      if (b.failedAt + b.delayMs < freeSlot->failedAt + freeSlot->delayMs) freeSlot = &b;
+    }
+  }
+  memset(freeSlot, 0, sizeof(*freeSlot));
+  strlcpy(freeSlot->symbol, symbol, sizeof(freeSlot->symbol));
+  return freeSlot;
+}
+
+// Symbols we own on the LAN: anything on our watchlist or a peer's that no
+// live peer owns, deduplicated and capped at what symbolCache can hold.
+// Symbols that would need a new cache slot when it's full are left to their
+// watchers, who fall back to fetching them themselves.
+static int lanOwnedSymbols(const char **out) {
+  const char *symbols[LAN_PEER_MAX_WATCH * 2];
+  int count = lanPeerWatchedSymbols(symbols, LAN_PEER_MAX_WATCH);
+  count += lanWatchlist(symbols + count, LAN_PEER_MAX_WATCH);
+  int owned = 0;
+  int freeSlots = 20 - symbolCacheCount;
+  for (int i = 0; i < count && owned < LAN_OWNER_MAX_SYMBOLS; i++) {
+    if (lanPeerOwnerOf(symbols[i]) != nullptr) continue;
+    bool duplicate = false;
+    for (int j = 0; j < owned && !duplicate; j++) duplicate = strcmp(out[j], symbols[i]) == 0;
+    if (duplicate) continue;
+    if (findCachedSymbol(String(symbols[i])) == nullptr) {
+      if (freeSlots <= 0) continue;
+      freeSlots--;
+    }
+    out[owned++] = symbols[i];
+  }
+  return owned;
+}
+
+// Refresh the symbols this device owns for the whole LAN once their quote
+// has expired. One API fetch per tick keeps the budget smooth; the scan
+// resumes after the last symbol tried, so a failing one can't starve the
+// rest. Nothing is refreshed while the market is closed. The fetch path
+// publishes the result to watchers.
+static void lanOwnerTick() {
+  if (otaInProgress || lanPeerCount() == 0) return;
+  if (millis() - lastLanOwnerTick < LAN_OWNER_TICK_MS) return;
+  lastLanOwnerTick = millis();
+  MarketPhase phase = currentMarketPhase();
+  if (phase == PHASE_CLOSED) return;
+  
+  const char *symbols[LAN_OWNER_MAX_SYMBOLS];
+  int count = lanOwnedSymbols(symbols);
+  if (count == 0) return;
+  uint32_t ttl = freshnessTtlMs(FIELD_QUOTE, phase);
+  for (int n = 0; n < count; n++) {
+    int i = (lanOwnerCursor + n) % count;
+    String symbol = symbols[i];
+    CachedStockData* cached = findCachedSymbol(symbol);
+    if (cached != nullptr && millis() - cached->fetchTime <= ttl) continue;
+    LanOwnerBackoff *backoff = lanOwnerBackoffFor(symbol.c_str(), false);
+    if (backoff != nullptr && millis() - backoff->failedAt < backoff->delayMs) continue;
+    lanOwnerCursor = (i + 1) % count;
+    
+    // prefetchedStock belongs to the rotation/SWR paths; keep it intact.
+    // The fetch is bounded so the clock, touch and UI don't stall on it.
+    PrefetchedData saved = prefetchedStock;
+    fetchBudgetEndMs = millis() + LAN_OWNER_FETCH_BUDGET_MS;
+    bool fetchedOk = prefetchStockData(symbol, true);
+    fetchBudgetEndMs = 0;
+    if (fetchedOk) {
+      PrefetchedData fetched = prefetchedStock;
+      carryForwardFreshFields(fetched);
+      CachedStockData entry;
+      prefetchedToCached(fetched, entry);
+      cacheSymbolData(entry, fetched.fromPeer);
+      if (backoff != nullptr) backoff->symbol[0] = '\0';
+      Serial.printf("[LAN] Owner refresh: %s\n", symbol.c_str());
+    } else {
+      // symbols[] points into peer watchlists, which the fetch may have rewritten
+      if (backoff == nullptr) backoff = lanOwnerBackoffFor(symbol.c_str(), true);
+      backoff->delayMs = backoff->delayMs ? min<uint32_t>(backoff->delayMs * 2, LAN_OWNER_RETRY_MAX_MS)
+                                          : LAN_OWNER_RETRY_MS;
+      backoff->failedAt = millis();
+      Serial.printf("[LAN] Owner refresh of %s failed, retry in %lus\n", symbol.c_str(),
+                    (unsigned long)(backoff->delayMs / 1000));
+    }
+    prefetchedStock = saved;
+    return;
+  }
+}
+
+bool lanFetchStock(const String& symbol, PrefetchedData& outData) {
+  PeerQuote quote;
+  uint32_t startMs = millis();
+  if (!lanPeerQuery(symbol.c_str(), lanMaxAgeSec(), quote)) return false;
+  peerQuoteToPrefetched(quote, outData);
+  dualLog("[LAN] %s from peer in %lu ms\n", symbol.c_str(), (unsigned long)(millis() - startMs));
+  return true;
+}
+
+// Start the LAN transport once WiFi is up, then service it every loop
+void lanTick() {
+  if (!lanPeerActive()) {
+    if (WiFi.status() != WL_CONNECTED || millis() - lastLanStartAttempt < 10000) return;
+    lastLanStartAttempt = millis();
+    LanPeerCallbacks callbacks = {lanLookupQuote, lanHeldSymbols, lanWatchlist, lanOnPush};
+    if (lanPeerBegin(getP2PNodeId(), P2P_NETWORK_KEY, FIRMWARE_VERSION, callbacks)) lanPeerJoinWall(WALL_NAME);
+    return;
+  }
+  if (WALL_NAME[0] && timeClient.isTimeSet()) {
+    lanPeerAnchorWallClock((int64_t)timeClient.getEpochTime() * 1000000LL);
   }
-  
-  // Polygon returns: results[0].c=close, h=high, l=low, o=open, v=volume, vw=vwap
-  JsonArray results = doc["results"];
-  if (results.size() == 0) {
-    dualLog("[POLYGON] No results returned\n");
-    return false;
+  lanPeerTick();
+  
+  // Re-announce as soon as the watchlist changes so pushes follow the screen
+  if (millis() - lastLanWatchCheck >= 1000) {
+    lastLanWatchCheck = millis();
+    const char *symbols[LAN_PEER_MAX_WATCH];
+    int count = lanWatchlist(symbols, LAN_PEER_MAX_WATCH);
+    uint32_t signature = 2166136261u;
+    for (int i = 0; i < count; i++) {
+      for (const char *c = symbols[i]; ; c++) {
+        signature = (signature ^ (uint8_t)*c) * 16777619u;
+        if (*c == '\0') break;
+      }
+    }
+    if (signature != lanWatchSignature) {
+      lanWatchSignature = signature;
+      lanPeerAnnounce();
+    }
   }
   
-  JsonObject result = results[0];
-  float closePrice = result["c"] | 0.0f;
-  float openPrice = result["o"] | 0.0f;
-  
-  if (closePrice == 0.0f) {
-    dualLog("[POLYGON] No price data in response\n");
-    return false;
+  lanOwnerTick();
+}
+
+// ============ Video Wall ============
+// Rotation on a wall follows the shared LAN clock instead of lastRotationTime:
+// slot = wall time / interval, and each display shows rotation entry
+// (slot + WALL_POSITION), so members flip together without any messages
+// beyond the clock samples. Prefetch is staggered: the symbol's owner fetches
+// it WALL_OWNER_LEAD_MS ahead and pushes it to the wall, and everyone else
+// loads it WALL_FOLLOWER_LEAD_MS ahead, by which time it is in their cache.
+#define WALL_OWNER_LEAD_MS 8000
+#define WALL_FOLLOWER_LEAD_MS 3000
+#define WALL_SPIN_MS 30          // Wait out the last stretch in place so the flip lands on time
+#define WALL_CATCHUP_RETRY_MS 10000
+
+static int64_t wallPreparedSlot = -1;
+static PrefetchedData wallPrepared = {false};
+static uint32_t lastWallCatchup = 0;
+
+static bool wallActive() {
+  return WALL_NAME[0] && lanPeerActive() && rotationEnabled && rotationCount > 1 && settingsPopup == nullptr;
+}
+
+static int wallIndexForSlot(int64_t slot) {
+  int64_t index = (slot + WALL_POSITION) % rotationCount;
+  return (int)(index < 0 ? index + rotationCount : index);
+}
+
+// Load the quote for `slot` ahead of its flip. The owner refreshes a stale
+// entry instead of painting it, since the rest of the wall waits on its push.
+static bool wallPrepare(int64_t slot) {
+  String symbol = rotationSymbols[wallIndexForSlot(slot)];
+  bool refresh = false;
+  CachedStockData* cached = findCachedSymbol(symbol);
+  if (cached != nullptr && lanPeerOwnerOf(symbol.c_str()) == nullptr) {
+    FreshnessReport report;
+    evaluateFreshness(*cached, report);
+    refresh = report.isStale(FIELD_QUOTE);
   }
   
-  // Calculate percent change from open
-  float pctChange = 0.0f;
-  if (openPrice > 0) {
-    pctChange = ((closePrice - openPrice) / openPrice) * 100.0f;
+  // prefetchedStock belongs to the symbol on screen until the flip
+  PrefetchedData saved = prefetchedStock;
+  bool ok = prefetchStockData(symbol, refresh);
+  wallPrepared = prefetchedStock;
+  wallPrepared.valid = ok;
+  prefetchedStock = saved;
+  wallPreparedSlot = slot;
+  return ok;
+}
+
+// Hard cut rather than the fade: LVGL's refresh timers aren't aligned across
+// devices, so a 100 ms fade would land on different frames per display
+static bool wallFlip(int64_t slot) {
+  if (wallPreparedSlot != slot || !wallPrepared.valid) {
+    if (!wallPrepare(slot)) {
+      Serial.printf("[WALL] No data for %s, holding\n", rotationSymbols[wallIndexForSlot(slot)].c_str());
+      return false;
+    }
+  }
+  prefetchedStock = wallPrepared;
+  rotationIndex = wallIndexForSlot(slot);
+  lastRotationTime = millis();
+  if (lvgl_port_lock(100)) {
+    applyPrefetchedData();
+    lv_refr_now(NULL);
+    lvgl_port_unlock();
+  }
+  return true;
+}
+
+// Drive rotation from the wall clock. Returns false when not on a wall, in
+// which case loop() uses the free-running rotation timer.
+bool wallRotationTick() {
+  if (!wallActive()) return false;
+  uint32_t intervalMs = (uint32_t)rotationIntervalMins * 60000;
+  int64_t nowMs = lanPeerWallClockUs() / 1000;
+  int64_t slot = nowMs / intervalMs;
+  
+  // Out of step (just joined, list edited, swiped, or a flip failed): catch up.
+  // The wall's schedule wins over local swipes.
+  if (currentSymbol != rotationSymbols[wallIndexForSlot(slot)]) {
+    if (millis() - lastWallCatchup >= WALL_CATCHUP_RETRY_MS || lastWallCatchup == 0) {
+      lastWallCatchup = millis();
+      if (wallFlip(slot)) dualLog("[WALL] Caught up to %s (slot %lld)\n", currentSymbol.c_str(), (long long)slot);
+    }
+    return true;
   }
   
-  prefetchedStock.symbol = symbol;
-  prefetchedStock.closePrice = closePrice;
-  prefetchedStock.prevClose = openPrice;  // Use open as prev close
-  prefetchedStock.pctChange = pctChange;
-  prefetchedStock.openPrice = openPrice;
-  prefetchedStock.highPrice = result["h"] | 0.0f;
-  prefetchedStock.lowPrice = result["l"] | 0.0f;
-  prefetchedStock.volume = result["v"] | 0.0;
-  prefetchedStock.companyName = "";
-  prefetchedStock.marketOpen = false;  // prev endpoint = market was closed
-  prefetchedStock.fiftyTwoLow = 0.0f;
-  prefetchedStock.fiftyTwoHigh = 0.0f;
-  prefetchedStock.oneMonthLow = 0.0f;
-  prefetchedStock.oneMonthHigh = 0.0f;
-  prefetchedStock.valid = true;
-  
-  dualLog("[POLYGON] OK: %s $%.2f (%.2f%%)\n", symbol.c_str(), closePrice, pctChange);
+  int64_t flipMs = (slot + 1) * intervalMs;
+  int64_t untilFlipMs = flipMs - nowMs;
+  const char *next = rotationSymbols[wallIndexForSlot(slot + 1)].c_str();
+  uint32_t leadMs = lanPeerOwnerOf(next) == nullptr ? WALL_OWNER_LEAD_MS : WALL_FOLLOWER_LEAD_MS;
+  if (wallPreparedSlot != slot + 1 && untilFlipMs <= leadMs) wallPrepare(slot + 1);
+  if (untilFlipMs > WALL_SPIN_MS) return true;
+  
+  while (lanPeerWallClockUs() < flipMs * 1000) delayMicroseconds(100);
+  if (wallFlip(slot + 1)) {
+    uint32_t errorUs = 0;
+    bool synced = lanPeerWallSynced(&errorUs);
+    Serial.printf("[WALL] Flipped to %s with %d display(s), clock %s (+/-%u us)\n", currentSymbol.c_str(),
+                  lanPeerWallSize(), synced ? "synced" : "unsynced", errorUs);
+  }
   return true;
 }
+#else
+inline void lanTick() {}
+inline bool wallRotationTick() { return false; }
+inline void publishFreshQuote(const PrefetchedData& data) {}
+inline bool lanTakePushRepaint() { return false; }
+inline bool lanDeferToOwner(const String& symbol) { return false; }
+inline bool lanFetchStock(const String& symbol, PrefetchedData& outData) { return false; }
+#endif
+
+// A refreshed quote only replaces what expired: fields the provider didn't return
+// (Finnhub/Polygon carry no 52W, 1M or name) keep their cached values while the
+// policy still considers them fresh.
+void carryForwardFreshFields(PrefetchedData& data) {
+  CachedStockData* cached = findCachedSymbol(data.symbol);
+  if (cached == nullptr || !cached->valid) return;
+  FreshnessReport report;
+  evaluateFreshness(*cached, report);
+
+  if (data.fiftyTwoHigh <= 0 && !report.isStale(FIELD_RANGE_52W)) {
+    data.fiftyTwoLow = cached->fiftyTwoLow;
+    data.fiftyTwoHigh = cached->fiftyTwoHigh;
+    data.rangeFetchTime = cached->rangeFetchTime;
+  }
+  if (data.oneMonthHigh <= 0 && !report.isStale(FIELD_RANGE_1M)) {
+    data.oneMonthLow = cached->oneMonthLow;
+    data.oneMonthHigh = cached->oneMonthHigh;
+  }
+  if (data.companyName.length() == 0 && !report.isStale(FIELD_NAME)) {
+    data.companyName = cached->companyName;
+  }
+}
+
+// Queue a background refresh for a symbol that was just painted from cache.
+void queueRevalidation(const String& symbol) {
+  swrRevalidateSymbol = symbol;
+  swrRevalidatePending = true;
+}
 
 // Prefetch stock data for a symbol (for smooth rotation)
-// Uses P2P network first, then cached data when market closed, then Finnhub API (primary), then TwelveData (fallback)
-bool prefetchStockData(const String& symbol) {
+// Stale-while-revalidate: a cached quote is returned immediately; if it is past its
+// freshness window a background refresh is queued and the screen updates in place.
+// Without a cache entry: LAN peers, then the P2P registry, then the symbol's LAN owner (sharded fetching),
+// then Finnhub API (primary), then TwelveData (fallback)
+// Pass bypassCache=true for the revalidation fetch itself.
+bool prefetchStockData(const String& symbol, bool bypassCache = false) {
   if (WiFi.status() != WL_CONNECTED) return false;
 
-  // If rotation is enabled, we may not be calling fetchPrice() periodically.
-  // That can leave isMarketOpen stale (e.g., stuck true after the close).
-  // Treat the market as "closed" for caching purposes when either:
-  // - The API last told us it's closed, OR
-  // - The local time is outside regular market hours.
-  bool treatAsClosedForCache = (!isMarketOpen) || (!isRegularMarketHoursByTime());
-
   // Step 1: Check local cache first (instant, no network)
-  if (treatAsClosedForCache) {
+  if (!bypassCache) {
     CachedStockData* cached = findCachedSymbol(symbol);
-    if (cached != nullptr && cached->valid) {
-      // Use cached data - no API call needed!
-      apiStats.localCacheHits++;
-      Serial.printf("[CACHE] Local cache hit for %s (total: %u cache, %u API)\n", 
-                    symbol.c_str(), apiStats.localCacheHits, apiStats.twelveDataQuoteCalls);
-      
-      // Convert cached display data back to prefetchedStock
-      // We need to parse the cached strings back to values
-      prefetchedStock.symbol = cached->symbol;
-      prefetchedStock.companyName = cached->companyName;
-      prefetchedStock.lowPrice = cached->low;
-      prefetchedStock.highPrice = cached->high;
-      prefetchedStock.fiftyTwoLow = cached->fiftyTwoLow;
-      prefetchedStock.fiftyTwoHigh = cached->fiftyTwoHigh;
-      prefetchedStock.marketOpen = cached->marketOpen;
-      
-      // Parse price from cached string (e.g., "$485.92")
-      String priceStr = cached->priceStr;
-      priceStr.replace("$", "");
-      priceStr.replace(",", "");
-      prefetchedStock.closePrice = priceStr.toFloat();
-      
-      // Parse percent change from cached string (e.g., "+0.40%" or "-1.23%")
-      String pctStr = cached->changeStr;
-      pctStr.replace("%", "");
-      pctStr.replace("+", "");
-      prefetchedStock.pctChange = pctStr.toFloat();
-      
-      // Parse dollar change (e.g., "+$1.94" or "-$2.50")
-      String dollarStr = cached->dollarChangeStr;
-      dollarStr.replace("$", "");
-      dollarStr.replace("+", "");
-      float dollarChange = dollarStr.toFloat();
-      prefetchedStock.prevClose = prefetchedStock.closePrice - dollarChange;
-      
-      // Parse volume from cached string (e.g., "Vol: 70.82M")
-      String volStr = cached->volumeStr;
-      volStr.replace("Vol: ", "");
-      float volMult = 1.0;
-      if (volStr.endsWith("B")) { volMult = 1000000000.0; volStr.replace("B", ""); }
-      else if (volStr.endsWith("M")) { volMult = 1000000.0; volStr.replace("M", ""); }
-      else if (volStr.endsWith("K")) { volMult = 1000.0; volStr.replace("K", ""); }
-      prefetchedStock.volume = volStr.toFloat() * volMult;
-      
-      // Parse open price from OHL string (e.g., "O: 487.36  H: 487.85  L: 482.49")
-      String ohlStr = cached->ohlStr;
-      int oIdx = ohlStr.indexOf("O: ");
-      int hIdx = ohlStr.indexOf("H: ");
-      if (oIdx >= 0 && hIdx > oIdx) {
-        prefetchedStock.openPrice = ohlStr.substring(oIdx + 3, hIdx).toFloat();
+    if (cached != nullptr && loadCachedQuote(symbol)) {
+      dataStatsHit(CACHE_QUOTE);
+      FreshnessReport report;
+      if (evaluateFreshness(*cached, report)) {
+        prefetchedStock.stale = true;
+        queueRevalidation(symbol);
       }
-      
-      // Restore 1-month data from cache
-      prefetchedStock.oneMonthLow = cached->oneMonthLow;
-      prefetchedStock.oneMonthHigh = cached->oneMonthHigh;
-      
-      prefetchedStock.valid = true;
+      Serial.printf("[CACHE] Local cache hit for %s: %s (total: %u cache, %u API)\n", 
+                    symbol.c_str(), describeStaleness(report).c_str(),
+                    cacheStats[CACHE_QUOTE].hits.load(), dataStatsCalls(PROVIDER_TWELVEDATA_QUOTE));
       return true;
     }
     // No cached data - will try P2P or fetch from API
-    Serial.printf("Market closed but no local cache for %s\n", symbol.c_str());
+    dataStatsMiss(CACHE_QUOTE);
+    Serial.printf("No local cache for %s\n", symbol.c_str());
+  }
+  
+  // Step 2: LAN peers (milliseconds, no cloud round trip)
+  {
+    PrefetchedData lanData = {false};
+    if (lanFetchStock(symbol, lanData)) {
+      prefetchedStock = lanData;
+      dataStatsHit(CACHE_LAN_PEER);
+      return true;
+    }
+    if (lanPeerCount() > 0) dataStatsMiss(CACHE_LAN_PEER);
   }
   
+  // Step 2b: Cloud registry, only when no LAN peer had fresh data
   #if defined(P2P_ENABLED) && P2P_ENABLED
   {
     PrefetchedData p2pData = {false};
     if (p2pFetchStock(symbol, p2pData)) {
       prefetchedStock = p2pData;
-      apiStats.p2pCacheHits++;
+      dataStatsHit(CACHE_P2P);
       dualLog("[P2P] Hit for %s\n", symbol.c_str());
       return true;
     }
+    dataStatsMiss(CACHE_P2P);
     dualLog("[P2P] Miss for %s - trying APIs\n", symbol.c_str());
   }
   #endif
   
+  // Step 2c: Another device on the LAN owns this symbol and fetches it for everyone
+  if (lanDeferToOwner(symbol)) {
+    return true;
+  }
+  
+  // Revalidation out of time: keep showing the cached quote
+  if (fetchBudgetSpent()) return false;
+  
   // Step 3: Try Finnhub API first (primary - 60 calls/min)
   if (finnhubApiKey.length() > 0) {
     if (fetchFromFinnhub(symbol)) {
+      publishFreshQuote(prefetchedStock);
       return true;
     }
     dualLog("[FINNHUB] Failed - trying TwelveData\n");
   }
   
   // Step 4: Fetch from TwelveData API (fallback)
-  apiStats.twelveDataQuoteCalls++;
-  dualLog("[12DATA] /quote %s (call #%u)\n", symbol.c_str(), apiStats.twelveDataQuoteCalls);
+  if (fetchBudgetSpent()) return false;
+  dualLog("[12DATA] /quote %s (call #%u)\n", symbol.c_str(), dataStatsCalls(PROVIDER_TWELVEDATA_QUOTE) + 1);
   HTTPClient http;
   String url = "https://api.twelvedata.com/quote?symbol=" + symbol + "&apikey=" + apiKey;
   
   http.begin(url);
-  http.setTimeout(5000);
+  applyFetchTimeouts(http, 5000);
+  uint32_t callStartMs = millis();
   int code = http.GET();
   
   if (code == 200) {
     String payload = http.getString();
+    dataStatsRecordCall(PROVIDER_TWELVEDATA_QUOTE, code, millis() - callStartMs, payload.length());
     JsonDocument doc;
     deserializeJson(doc, payload);
     
@@ -1395,6 +2986,11 @@ bool prefetchStockData(const String& symbol) {
     // Update global market status
     isMarketOpen = prefetchedStock.marketOpen;
     
+    prefetchedStock.fetchTime = millis();
+    prefetchedStock.rangeFetchTime = prefetchedStock.fiftyTwoHigh > 0 ? prefetchedStock.fetchTime : 0;
+    prefetchedStock.stale = false;
+    prefetchedStock.fromPeer = false;
+    prefetchedStock.fields = FIELDS_TWELVEDATA;
     prefetchedStock.valid = true;
     http.end();
     
@@ -1403,15 +2999,19 @@ bool prefetchStockData(const String& symbol) {
     prefetchedStock.oneMonthHigh = 0.0;
     fetchOneMonthRange(symbol, prefetchedStock.oneMonthLow, prefetchedStock.oneMonthHigh);
     
+    publishFreshQuote(prefetchedStock);
     return true;
   }
   
   http.end();
+  dataStatsRecordCall(PROVIDER_TWELVEDATA_QUOTE, code, millis() - callStartMs, 0);
   
   // Step 5: TwelveData also failed - try Polygon as last resort
   dualLog("[12DATA] Failed (HTTP %d) - trying Polygon\n", code);
+  if (fetchBudgetSpent()) return false;
   
   if (fetchFromPolygon(symbol)) {
+    publishFreshQuote(prefetchedStock);
     return true;
   }
   
@@ -1433,14 +3033,15 @@ OneMonthCache* findOneMonthCache(const String& symbol) {
 }
 
 // Add or update 1-month data in cache
-void cacheOneMonthData(const String& symbol, float low, float high, int day) {
+void cacheOneMonthData(const String& symbol, float low, float high) {
   // Check if symbol already exists
   for (int i = 0; i < oneMonthCacheCount; i++) {
     if (oneMonthCache[i].symbol == symbol) {
       oneMonthCache[i].low = low;
       oneMonthCache[i].high = high;
-      oneMonthCache[i].fetchDay = day;
+      oneMonthCache[i].fetchTime = millis();
       oneMonthCache[i].valid = true;
+      dataStatsInsert(CACHE_ONE_MONTH);
       return;
     }
   }
@@ -1449,9 +3050,13 @@ void cacheOneMonthData(const String& symbol, float low, float high, int day) {
     oneMonthCache[oneMonthCacheCount].symbol = symbol;
     oneMonthCache[oneMonthCacheCount].low = low;
     oneMonthCache[oneMonthCacheCount].high = high;
-    oneMonthCache[oneMonthCacheCount].fetchDay = day;
+    oneMonthCache[oneMonthCacheCount].fetchTime = millis();
     oneMonthCache[oneMonthCacheCount].valid = true;
     oneMonthCacheCount++;
+    dataStatsInsert(CACHE_ONE_MONTH);
+    dataStatsSetBytes(CACHE_ONE_MONTH, oneMonthCacheCount * sizeof(OneMonthCache));
+  } else {
+    dataStatsEvict(CACHE_ONE_MONTH);  // Full: the new entry is dropped
   }
 }
 
@@ -1459,36 +3064,37 @@ void cacheOneMonthData(const String& symbol, float low, float high, int day) {
 bool fetchOneMonthRange(const String& symbol, float& outLow, float& outHigh) {
   if (WiFi.status() != WL_CONNECTED) return false;
   
-  // Get current day of month
+  // Check if we already have cached data the freshness policy still accepts
   timeClient.update();
-  unsigned long epochTime = timeClient.getEpochTime();
-  struct tm* timeInfo = gmtime((time_t*)&epochTime);
-  int currentDay = timeInfo->tm_mday;
-  
-  // Check if we already have cached data for today
   OneMonthCache* cached = findOneMonthCache(symbol);
-  if (cached != nullptr && cached->fetchDay == currentDay) {
+  uint32_t ageMs;
+  if (cached != nullptr &&
+      checkFieldFreshness(FIELD_RANGE_1M, currentMarketPhase(), true, cached->fetchTime, ageMs) == STALE_NONE) {
+    dataStatsHit(CACHE_ONE_MONTH);
     outLow = cached->low;
     outHigh = cached->high;
     Serial.printf("1M range cached for %s: %.2f - %.2f\n", symbol.c_str(), outLow, outHigh);
     return true;
   }
+  dataStatsMiss(CACHE_ONE_MONTH);
+  if (fetchBudgetSpent()) return false;  // Revalidation out of time; the next full fetch gets it
   
   // Need to fetch - get 22 trading days of daily data
-  apiStats.twelveDataTimeSeriesCalls++;
   Serial.printf("[API] TwelveData /time_series for %s (call #%u today)\n", 
-                symbol.c_str(), apiStats.twelveDataTimeSeriesCalls);
+                symbol.c_str(), dataStatsCalls(PROVIDER_TWELVEDATA_SERIES) + 1);
   HTTPClient http;
   String url = "https://api.twelvedata.com/time_series?symbol=" + symbol + 
                "&interval=1day&outputsize=22&apikey=" + apiKey;
   
   Serial.printf("Fetching 1M range for %s...\n", symbol.c_str());
   http.begin(url);
-  http.setTimeout(8000);
+  applyFetchTimeouts(http, 8000);
+  uint32_t callStartMs = millis();
   int code = http.GET();
   
   if (code == 200) {
     String payload = http.getString();
+    dataStatsRecordCall(PROVIDER_TWELVEDATA_SERIES, code, millis() - callStartMs, payload.length());
     JsonDocument doc;
     DeserializationError err = deserializeJson(doc, payload);
     
@@ -1508,7 +3114,7 @@ bool fetchOneMonthRange(const String& symbol, float& outLow, float& outHigh) {
       if (monthHigh > 0 && monthLow < 999999.0) {
         outLow = monthLow;
         outHigh = monthHigh;
-        cacheOneMonthData(symbol, monthLow, monthHigh, currentDay);
+        cacheOneMonthData(symbol, monthLow, monthHigh);
         Serial.printf("1M range fetched for %s: %.2f - %.2f\n", symbol.c_str(), outLow, outHigh);
         http.end();
         return true;
@@ -1517,18 +3123,18 @@ bool fetchOneMonthRange(const String& symbol, float& outLow, float& outHigh) {
   }
   
   http.end();
+  if (code != 200) dataStatsRecordCall(PROVIDER_TWELVEDATA_SERIES, code, millis() - callStartMs, 0);
   Serial.printf("Failed to fetch 1M range for %s (code %d)\n", symbol.c_str(), code);
   return false;
 }
 
-// Apply prefetched data to UI (call with LVGL lock held)
-void applyPrefetchedData() {
-  if (!prefetchedStock.valid) return;
-  
-  currentSymbol = prefetchedStock.symbol;
-  float closePrice = prefetchedStock.closePrice;
-  float pctChange = prefetchedStock.pctChange;
-  float dollarChange = closePrice - prefetchedStock.prevClose;
+// Build a symbolCache entry (display strings and bar positions) from a quote.
+// Shared by the painted path and by bulk P2P warming, which fills the cache
+// without touching the UI.
+void prefetchedToCached(const PrefetchedData& data, CachedStockData& out) {
+  float closePrice = data.closePrice;
+  float pctChange = data.pctChange;
+  float dollarChange = closePrice - data.prevClose;
   
   // Format strings
   char priceBuf[16], pctBuf[16], dollarBuf[16];
@@ -1538,10 +3144,10 @@ void applyPrefetchedData() {
   
   char ohlBuf[48];
   snprintf(ohlBuf, sizeof(ohlBuf), "O: %.2f   H: %.2f   L: %.2f", 
-           prefetchedStock.openPrice, prefetchedStock.highPrice, prefetchedStock.lowPrice);
+           data.openPrice, data.highPrice, data.lowPrice);
   
   char volBuf[24];
-  float volume = prefetchedStock.volume;
+  float volume = data.volume;
   if (volume >= 1e9) snprintf(volBuf, sizeof(volBuf), "Vol: %.2fB", volume / 1e9);
   else if (volume >= 1e6) snprintf(volBuf, sizeof(volBuf), "Vol: %.2fM", volume / 1e6);
   else if (volume >= 1e3) snprintf(volBuf, sizeof(volBuf), "Vol: %.1fK", volume / 1e3);
@@ -1549,19 +3155,62 @@ void applyPrefetchedData() {
   
   // Range calculations
   int rangePos = 50;
-  if (prefetchedStock.highPrice > prefetchedStock.lowPrice) {
-    rangePos = (int)(((closePrice - prefetchedStock.lowPrice) / (prefetchedStock.highPrice - prefetchedStock.lowPrice)) * 100);
+  if (data.highPrice > data.lowPrice) {
+    rangePos = (int)(((closePrice - data.lowPrice) / (data.highPrice - data.lowPrice)) * 100);
     if (rangePos < 0) rangePos = 0;
     if (rangePos > 100) rangePos = 100;
   }
   
   int fiftyTwoPos = 50;
-  if (prefetchedStock.fiftyTwoHigh > prefetchedStock.fiftyTwoLow) {
-    fiftyTwoPos = (int)(((closePrice - prefetchedStock.fiftyTwoLow) / (prefetchedStock.fiftyTwoHigh - prefetchedStock.fiftyTwoLow)) * 100);
+  if (data.fiftyTwoHigh > data.fiftyTwoLow) {
+    fiftyTwoPos = (int)(((closePrice - data.fiftyTwoLow) / (data.fiftyTwoHigh - data.fiftyTwoLow)) * 100);
     if (fiftyTwoPos < 0) fiftyTwoPos = 0;
     if (fiftyTwoPos > 100) fiftyTwoPos = 100;
   }
   
+  // 1-Month range calculation
+  int oneMonthPos = 50;
+  if (data.oneMonthHigh > data.oneMonthLow) {
+    oneMonthPos = (int)(((closePrice - data.oneMonthLow) / (data.oneMonthHigh - data.oneMonthLow)) * 100);
+    if (oneMonthPos < 0) oneMonthPos = 0;
+    if (oneMonthPos > 100) oneMonthPos = 100;
+  }
+  
+  out.valid = true;
+  out.symbol = data.symbol;
+  out.priceStr = priceBuf;
+  out.changeStr = pctBuf;
+  out.dollarChangeStr = dollarBuf;
+  out.ohlStr = ohlBuf;
+  out.volumeStr = volBuf;
+  // The flash symbol table wins so names don't need a heap String per cache entry
+  out.companyName = symbolTableName(data.symbol.c_str(), false) ? String() : data.companyName;
+  out.low = data.lowPrice;
+  out.high = data.highPrice;
+  out.fiftyTwoLow = data.fiftyTwoLow;
+  out.fiftyTwoHigh = data.fiftyTwoHigh;
+  out.oneMonthLow = data.oneMonthLow;
+  out.oneMonthHigh = data.oneMonthHigh;
+  out.dayRangePos = rangePos;
+  out.fiftyTwoPos = fiftyTwoPos;
+  out.oneMonthPos = oneMonthPos;
+  out.marketOpen = data.marketOpen;
+  out.fetchTime = data.fetchTime != 0 ? data.fetchTime : millis();
+  out.rangeFetchTime = data.rangeFetchTime;
+  out.fields = data.fields;
+}
+
+// Apply prefetched data to UI (call with LVGL lock held)
+void applyPrefetchedData() {
+  if (!prefetchedStock.valid) return;
+  carryForwardFreshFields(prefetchedStock);
+  
+  currentSymbol = prefetchedStock.symbol;
+  float pctChange = prefetchedStock.pctChange;
+  
+  CachedStockData newCache;
+  prefetchedToCached(prefetchedStock, newCache);
+  
   char lowBuf[12], highBuf[12];
   snprintf(lowBuf, sizeof(lowBuf), "%.2f", prefetchedStock.lowPrice);
   snprintf(highBuf, sizeof(highBuf), "%.2f", prefetchedStock.highPrice);
@@ -1570,36 +3219,26 @@ void applyPrefetchedData() {
   snprintf(fiftyTwoLowBuf, sizeof(fiftyTwoLowBuf), "%.2f", prefetchedStock.fiftyTwoLow);
   snprintf(fiftyTwoHighBuf, sizeof(fiftyTwoHighBuf), "%.2f", prefetchedStock.fiftyTwoHigh);
   
-  // 1-Month range calculation
-  int oneMonthPos = 50;
-  if (prefetchedStock.oneMonthHigh > prefetchedStock.oneMonthLow) {
-    oneMonthPos = (int)(((closePrice - prefetchedStock.oneMonthLow) / (prefetchedStock.oneMonthHigh - prefetchedStock.oneMonthLow)) * 100);
-    if (oneMonthPos < 0) oneMonthPos = 0;
-    if (oneMonthPos > 100) oneMonthPos = 100;
-  }
-  
   char oneMonthLowBuf[12], oneMonthHighBuf[12];
   snprintf(oneMonthLowBuf, sizeof(oneMonthLowBuf), "%.2f", prefetchedStock.oneMonthLow);
   snprintf(oneMonthHighBuf, sizeof(oneMonthHighBuf), "%.2f", prefetchedStock.oneMonthHigh);
   
-  // Update company name and symbol separately
-  if (prefetchedStock.companyName.length() > 0) {
-    lv_label_set_text(companyNameLabel, prefetchedStock.companyName.c_str());
-  } else {
-    lv_label_set_text(companyNameLabel, "");
-  }
+  // Update company name and symbol separately.
+  // The flash symbol table wins so names don't need a heap String per cache entry.
+  const char *tableName = symbolTableName(currentSymbol.c_str());
+  lv_label_set_text(companyNameLabel, tableName ? tableName : prefetchedStock.companyName.c_str());
   char symbolBuf[16];
   snprintf(symbolBuf, sizeof(symbolBuf), "$%s", currentSymbol.c_str());
   lv_label_set_text(symbolLabel, symbolBuf);
   
-  lv_label_set_text(priceLabel, priceBuf);
-  lv_label_set_text(changeLabel, pctBuf);
-  lv_label_set_text(dollarChangeLabel, dollarBuf);
-  lv_label_set_text(ohlLabel, ohlBuf);
-  lv_label_set_text(volumeLabel, volBuf);
+  lv_label_set_text(priceLabel, newCache.priceStr.c_str());
+  lv_label_set_text(changeLabel, newCache.changeStr.c_str());
+  lv_label_set_text(dollarChangeLabel, newCache.dollarChangeStr.c_str());
+  lv_label_set_text(ohlLabel, newCache.ohlStr.c_str());
+  lv_label_set_text(volumeLabel, newCache.volumeStr.c_str());
   lv_label_set_text(rangeLowLabel, lowBuf);
   lv_label_set_text(rangeHighLabel, highBuf);
-  lv_bar_set_value(rangeBar, rangePos, LV_ANIM_OFF);
+  lv_bar_set_value(rangeBar, newCache.dayRangePos, LV_ANIM_OFF);
   
   lv_color_t changeColor = pctChange >= 0 ? lv_color_hex(0x00E676) : lv_color_hex(0xFF5252);
   
@@ -1609,14 +3248,14 @@ void applyPrefetchedData() {
   
   lv_label_set_text(fiftyTwoWeekLowLabel, fiftyTwoLowBuf);
   lv_label_set_text(fiftyTwoWeekHighLabel, fiftyTwoHighBuf);
-  lv_bar_set_value(fiftyTwoWeekBar, fiftyTwoPos, LV_ANIM_OFF);
+  lv_bar_set_value(fiftyTwoWeekBar, newCache.fiftyTwoPos, LV_ANIM_OFF);
   lv_obj_set_style_bg_color(fiftyTwoWeekBar, changeColor, LV_PART_INDICATOR);
   
   // Update 1-month range bar and labels
   if (oneMonthBar != nullptr) {
     lv_label_set_text(oneMonthLowLabel, oneMonthLowBuf);
     lv_label_set_text(oneMonthHighLabel, oneMonthHighBuf);
-    lv_bar_set_value(oneMonthBar, oneMonthPos, LV_ANIM_OFF);
+    lv_bar_set_value(oneMonthBar, newCache.oneMonthPos, LV_ANIM_OFF);
     lv_obj_set_style_bg_color(oneMonthBar, lv_color_hex(0x58A6FF), LV_PART_INDICATOR);  // Blue for 1M
   }
   
@@ -1630,37 +3269,31 @@ void applyPrefetchedData() {
   lv_obj_set_style_text_color(dollarChangeLabel, changeColor, 0);
   lv_obj_set_style_bg_color(rangeBar, changeColor, LV_PART_INDICATOR);
   
+  // Timestamp reflects when the quote was fetched, not when it was painted
+  uint32_t fetchTime = newCache.fetchTime;
+  uint32_t ageMs = millis() - fetchTime;
   timeClient.update();
-  int hour = timeClient.getHours();
-  int minute = timeClient.getMinutes();
+  time_t fetchedEpoch = (time_t)(timeClient.getEpochTime() - ageMs / 1000);
+  if (prefetchedStock.marketOpen) {
+    recordPriceHistory(currentSymbol, (uint32_t)fetchedEpoch, prefetchedStock.closePrice);
+  }
+  struct tm* fetchedTm = gmtime(&fetchedEpoch);
+  int hour = fetchedTm->tm_hour;
+  int minute = fetchedTm->tm_min;
   char timeBuf[64];
   int hour12 = hour % 12;
   if (hour12 == 0) hour12 = 12;
-  snprintf(timeBuf, sizeof(timeBuf), "Last Updated: %d:%02d %s  |  $MSFT Money Team", hour12, minute, hour >= 12 ? "PM" : "AM");
+  if (ageMs >= SWR_AGE_INDICATOR_MS) {
+    snprintf(timeBuf, sizeof(timeBuf), "Last Updated: %d:%02d %s (%lum ago)%s", hour12, minute,
+             hour >= 12 ? "PM" : "AM", (unsigned long)(ageMs / 60000),
+             prefetchedStock.stale ? "  |  Refreshing..." : "");
+  } else {
+    snprintf(timeBuf, sizeof(timeBuf), "Last Updated: %d:%02d %s  |  $MSFT Money Team", hour12, minute, hour >= 12 ? "PM" : "AM");
+  }
   lv_label_set_text(statusLabel, timeBuf);
   
   // Cache this data for rotation when market closed
-  CachedStockData newCache;
-  newCache.valid = true;
-  newCache.symbol = currentSymbol;
-  newCache.priceStr = priceBuf;
-  newCache.changeStr = pctBuf;
-  newCache.dollarChangeStr = dollarBuf;
-  newCache.ohlStr = ohlBuf;
-  newCache.volumeStr = volBuf;
-  newCache.companyName = prefetchedStock.companyName;
-  newCache.low = prefetchedStock.lowPrice;
-  newCache.high = prefetchedStock.highPrice;
-  newCache.fiftyTwoLow = prefetchedStock.fiftyTwoLow;
-  newCache.fiftyTwoHigh = prefetchedStock.fiftyTwoHigh;
-  newCache.oneMonthLow = prefetchedStock.oneMonthLow;
-  newCache.oneMonthHigh = prefetchedStock.oneMonthHigh;
-  newCache.dayRangePos = rangePos;
-  newCache.fiftyTwoPos = fiftyTwoPos;
-  newCache.oneMonthPos = oneMonthPos;
-  newCache.marketOpen = prefetchedStock.marketOpen;
-  newCache.fetchTime = millis();
-  cacheSymbolData(newCache);
+  cacheSymbolData(newCache, prefetchedStock.fromPeer);
   
   prefetchedStock.valid = false;  // Mark as consumed
 }
@@ -1682,11 +3315,13 @@ void fetchPrice() {
     String finnhubUrl = "https://finnhub.io/api/v1/quote?symbol=" + currentSymbol + "&token=" + finnhubApiKey;
     finnhubHttp.begin(finnhubUrl);
     finnhubHttp.setTimeout(5000);
+    uint32_t finnhubStartMs = millis();
     int finnhubCode = finnhubHttp.GET();
     
     if (finnhubCode == 200) {
       String payload = finnhubHttp.getString();
       finnhubHttp.end();
+      dataStatsRecordCall(PROVIDER_FINNHUB, finnhubCode, millis() - finnhubStartMs, payload.length());
       
       JsonDocument doc;
       deserializeJson(doc, payload);
@@ -1737,7 +3372,14 @@ void fetchPrice() {
         snprintf(lowBuf, sizeof(lowBuf), "%.2f", lowPrice);
         snprintf(highBuf2, sizeof(highBuf2), "%.2f", highPrice);
         
+        const char *tableName = symbolTableName(currentSymbol.c_str());
+        char symbolBuf[16];
+        snprintf(symbolBuf, sizeof(symbolBuf), "$%s", currentSymbol.c_str());
+        
         if (lvgl_port_lock(100)) {
+          // Finnhub quotes carry no company name; fall back to the flash symbol table
+          lv_label_set_text(companyNameLabel, tableName ? tableName : "");
+          lv_label_set_text(symbolLabel, symbolBuf);
           lv_label_set_text(priceLabel, priceBuf);
           lv_label_set_text(changeLabel, pctBuf);
           lv_label_set_text(dollarChangeLabel, dollarBuf);
@@ -1760,6 +3402,21 @@ void fetchPrice() {
         }
         
         Serial.printf("[FINNHUB] Success: %s = $%.2f (%.2f%%)\\n", currentSymbol.c_str(), closePrice, pctChange);
+        if (isRegularMarketHoursByTime()) {
+          recordPriceHistory(currentSymbol, timeClient.getEpochTime(), closePrice);
+        }
+        
+        PrefetchedData fresh = {false};
+        fresh.symbol = currentSymbol;
+        fresh.closePrice = closePrice;
+        fresh.prevClose = prevClose;
+        fresh.openPrice = openPrice;
+        fresh.highPrice = highPrice;
+        fresh.lowPrice = lowPrice;
+        fresh.marketOpen = isRegularMarketHoursByTime();
+        fresh.fetchTime = millis();
+        fresh.valid = true;
+        publishFreshQuote(fresh);
         
         prefs.begin("stock", false);
         prefs.putString("symbol", currentSymbol);
@@ -1769,22 +3426,24 @@ void fetchPrice() {
       }
     }
     finnhubHttp.end();
+    if (finnhubCode != 200) dataStatsRecordCall(PROVIDER_FINNHUB, finnhubCode, millis() - finnhubStartMs, 0);
     Serial.printf("[FINNHUB] Failed (HTTP %d) - trying TwelveData fallback\\n", finnhubCode);
   }
   
   // Fallback to TwelveData
-  apiStats.twelveDataQuoteCalls++;
   Serial.printf("[API] TwelveData /quote (fallback) for %s (call #%u today)\\n", 
-                currentSymbol.c_str(), apiStats.twelveDataQuoteCalls);
+                currentSymbol.c_str(), dataStatsCalls(PROVIDER_TWELVEDATA_QUOTE) + 1);
   HTTPClient http;
   String url = "https://api.twelvedata.com/quote?symbol=" + currentSymbol + "&apikey=" + apiKey;
   
   http.begin(url);
   http.setTimeout(5000);
+  uint32_t callStartMs = millis();
   int code = http.GET();
   
   if (code == 200) {
     String payload = http.getString();
+    dataStatsRecordCall(PROVIDER_TWELVEDATA_QUOTE, code, millis() - callStartMs, payload.length());
     JsonDocument doc;
     deserializeJson(doc, payload);
     
@@ -1870,13 +3529,12 @@ void fetchPrice() {
     snprintf(fiftyTwoLowBuf, sizeof(fiftyTwoLowBuf), "%.2f", fiftyTwoLow);
     snprintf(fiftyTwoHighBuf, sizeof(fiftyTwoHighBuf), "%.2f", fiftyTwoHigh);
     
+    // Prefer the flash symbol table for the name (no heap copy kept in the cache)
+    const char *tableName = symbolTableName(currentSymbol.c_str());
+    
     if (lvgl_port_lock(100)) {
       // Update company name and ticker separately
-      if (companyName.length() > 0) {
-        lv_label_set_text(companyNameLabel, companyName.c_str());
-      } else {
-        lv_label_set_text(companyNameLabel, "");
-      }
+      lv_label_set_text(companyNameLabel, tableName ? tableName : companyName.c_str());
       char symbolBuf[16];
       snprintf(symbolBuf, sizeof(symbolBuf), "$%s", currentSymbol.c_str());
       lv_label_set_text(symbolLabel, symbolBuf);
@@ -1942,7 +3600,7 @@ void fetchPrice() {
     cachedData.dollarChangeStr = dollarBuf;
     cachedData.ohlStr = ohlBuf;
     cachedData.volumeStr = volBuf;
-    cachedData.companyName = companyName;
+    cachedData.companyName = tableName ? String() : companyName;
     cachedData.low = lowPrice;
     cachedData.high = highPrice;
     cachedData.fiftyTwoLow = fiftyTwoLow;
@@ -1951,9 +3609,19 @@ void fetchPrice() {
     cachedData.fiftyTwoPos = fiftyTwoPos;
     cachedData.marketOpen = apiMarketOpen;
     cachedData.fetchTime = millis();
+    cachedData.rangeFetchTime = fiftyTwoHigh > 0 ? cachedData.fetchTime : 0;
+    cachedData.fields = FIELDS_TWELVEDATA;
+    if (apiMarketOpen) {
+      recordPriceHistory(currentSymbol, timeClient.getEpochTime(), closePrice);
+    }
     
     // Also add to multi-symbol cache for rotation
     cacheSymbolData(cachedData);
+    {
+      PrefetchedData fresh = {false};
+      cachedToPrefetched(cachedData, fresh);
+      publishFreshQuote(fresh);
+    }
     
     prefs.begin("stock", false);
     prefs.putString("symbol", currentSymbol);
@@ -1962,6 +3630,7 @@ void fetchPrice() {
   } else {
     // TwelveData fallback also failed - try Polygon as last resort
     http.end();
+    dataStatsRecordCall(PROVIDER_TWELVEDATA_QUOTE, code, millis() - callStartMs, 0);
     Serial.printf("[API] TwelveData fallback also failed (HTTP %d) - trying Polygon\\n", code);
     
     if (polygonApiKey.length() > 0) {
@@ -1969,11 +3638,13 @@ void fetchPrice() {
       String polygonUrl = "https://api.polygon.io/v2/aggs/ticker/" + currentSymbol + "/prev?adjusted=true&apiKey=" + polygonApiKey;
       polygonHttp.begin(polygonUrl);
       polygonHttp.setTimeout(5000);
+      uint32_t polygonStartMs = millis();
       int polygonCode = polygonHttp.GET();
       
       if (polygonCode == 200) {
         String payload = polygonHttp.getString();
         polygonHttp.end();
+        dataStatsRecordCall(PROVIDER_POLYGON, polygonCode, millis() - polygonStartMs, payload.length());
         
         JsonDocument doc;
         deserializeJson(doc, payload);
@@ -2031,7 +3702,14 @@ void fetchPrice() {
             snprintf(lowBuf, sizeof(lowBuf), "%.2f", lowPrice);
             snprintf(highBuf2, sizeof(highBuf2), "%.2f", highPrice);
             
+            const char *tableName = symbolTableName(currentSymbol.c_str());
+            char symbolBuf[16];
+            snprintf(symbolBuf, sizeof(symbolBuf), "$%s", currentSymbol.c_str());
+            
             if (lvgl_port_lock(100)) {
+              // Polygon /prev carries no company name; fall back to the flash symbol table
+              lv_label_set_text(companyNameLabel, tableName ? tableName : "");
+              lv_label_set_text(symbolLabel, symbolBuf);
               lv_label_set_text(priceLabel, priceBuf);
               lv_label_set_text(changeLabel, pctBuf);
               lv_label_set_text(dollarChangeLabel, dollarBuf);
@@ -2054,6 +3732,18 @@ void fetchPrice() {
             
             Serial.printf("[POLYGON] Success: %s = $%.2f (%.2f%%)\\n", currentSymbol.c_str(), closePrice, pctChange);
             
+            PrefetchedData fresh = {false};
+            fresh.symbol = currentSymbol;
+            fresh.closePrice = closePrice;
+            fresh.prevClose = openPrice;  // Matches the change shown above (prev bar's open)
+            fresh.openPrice = openPrice;
+            fresh.highPrice = highPrice;
+            fresh.lowPrice = lowPrice;
+            fresh.volume = volume;
+            fresh.fetchTime = millis();
+            fresh.valid = true;
+            publishFreshQuote(fresh);
+            
             prefs.begin("stock", false);
             prefs.putString("symbol", currentSymbol);
             prefs.putString("price", lastPrice);
@@ -2063,6 +3753,7 @@ void fetchPrice() {
         }
       }
       polygonHttp.end();
+      if (polygonCode != 200) dataStatsRecordCall(PROVIDER_POLYGON, polygonCode, millis() - polygonStartMs, 0);
       Serial.printf("[POLYGON] Also failed (HTTP %d)\\n", polygonCode);
     }
     
@@ -2608,13 +4299,7 @@ void createSettingsPopup() {
 // ============ GITHUB OTA UPDATE ============
 // Compare version strings like "1.8.0" > "1.7.0"
 bool isNewerVersion(const String& remote, const String& local) {
-  int rMajor = 0, rMinor = 0, rPatch = 0;
-  int lMajor = 0, lMinor = 0, lPatch = 0;
-  sscanf(remote.c_str(), "%d.%d.%d", &rMajor, &rMinor, &rPatch);
-  sscanf(local.c_str(), "%d.%d.%d", &lMajor, &lMinor, &lPatch);
-  if (rMajor != lMajor) return rMajor > lMajor;
-  if (rMinor != lMinor) return rMinor > lMinor;
-  return rPatch > lPatch;
+  return otaVersionIsNewer(remote.c_str(), local.c_str());
 }
 
 void updateOTAProgress(const char* msg) {
@@ -2744,31 +4429,43 @@ void checkGitHubOTA() {
 }
 
 // ============ OTA UPDATE WEB SERVER ============
+enum WebKeySlot : uint8_t { WEB_KEY_TWELVEDATA, WEB_KEY_FINNHUB, WEB_KEY_POLYGON, WEB_KEY_COUNT };
+
+// Masked copies of the API keys for the page. loop() rewrites them whenever it
+// assigns a key; the AsyncTCP task only copies them out, never touching the
+// key Strings themselves.
+#define WEB_KEY_MASKED_LEN 16
+static char webKeyMasked[WEB_KEY_COUNT][WEB_KEY_MASKED_LEN];
+static portMUX_TYPE webKeyMaskMux = portMUX_INITIALIZER_UNLOCKED;
+
+static void maskKey(const String& key, char out[WEB_KEY_MASKED_LEN]) {
+  if (key.length() > 4) {
+    snprintf(out, WEB_KEY_MASKED_LEN, "%.4s****%s", key.c_str(), key.c_str() + key.length() - 4);
+  } else {
+    strlcpy(out, key.length() > 0 ? "****" : "", WEB_KEY_MASKED_LEN);
+  }
+}
+
+// Call from loop() after changing apiKey, finnhubApiKey or polygonApiKey
+static void updateMaskedKeys() {
+  char masked[WEB_KEY_COUNT][WEB_KEY_MASKED_LEN];
+  maskKey(apiKey, masked[WEB_KEY_TWELVEDATA]);
+  maskKey(finnhubApiKey, masked[WEB_KEY_FINNHUB]);
+  maskKey(polygonApiKey, masked[WEB_KEY_POLYGON]);
+  portENTER_CRITICAL(&webKeyMaskMux);
+  memcpy(webKeyMasked, masked, sizeof(masked));
+  portEXIT_CRITICAL(&webKeyMaskMux);
+}
+
 // Dynamic page builder for API keys
 String buildOtaPage() {
-  // Mask TwelveData key
-  String maskedKey = "";
-  if (apiKey.length() > 4) {
-    maskedKey = apiKey.substring(0, 4) + "****" + apiKey.substring(apiKey.length() - 4);
-  } else if (apiKey.length() > 0) {
-    maskedKey = "****";
-  }
-  
-  // Mask Finnhub key
-  String maskedFinnhub = "";
-  if (finnhubApiKey.length() > 4) {
-    maskedFinnhub = finnhubApiKey.substring(0, 4) + "****" + finnhubApiKey.substring(finnhubApiKey.length() - 4);
-  } else if (finnhubApiKey.length() > 0) {
-    maskedFinnhub = "****";
-  }
-  
-  // Mask Polygon key
-  String maskedPolygon = "";
-  if (polygonApiKey.length() > 4) {
-    maskedPolygon = polygonApiKey.substring(0, 4) + "****" + polygonApiKey.substring(polygonApiKey.length() - 4);
-  } else if (polygonApiKey.length() > 0) {
-    maskedPolygon = "****";
-  }
+  char masked[WEB_KEY_COUNT][WEB_KEY_MASKED_LEN];
+  portENTER_CRITICAL(&webKeyMaskMux);
+  memcpy(masked, webKeyMasked, sizeof(masked));
+  portEXIT_CRITICAL(&webKeyMaskMux);
+  String maskedKey = masked[WEB_KEY_TWELVEDATA];
+  String maskedFinnhub = masked[WEB_KEY_FINNHUB];
+  String maskedPolygon = masked[WEB_KEY_POLYGON];
   
   String page = R"rawliteral(
 <!DOCTYPE html><html><head><title>Stock Ticker</title>
@@ -2812,44 +4509,192 @@ input[type=submit]:hover{background:#2EA043}
 <input type='submit' value='Save'></form>
 </div>
 <div class='section'><h2>Firmware Update</h2>
-<form method='POST' action='/update' enctype='multipart/form-data'>
-<input type='file' name='update' accept='.bin' required><br>
+<form method='POST' action=')rawliteral" OTA_UPLOAD_PATH R"rawliteral(' enctype='multipart/form-data'>
+<input type='file' name='update' accept='.bin,.z' required><br>
 <input type='submit' value='Upload Firmware'></form></div>
 <div class='section'><h2>Live Logs</h2>
 <div id='logs' style='background:#0D1117;border:1px solid #30363D;border-radius:6px;padding:10px;text-align:left;font-family:monospace;font-size:11px;height:300px;overflow-y:auto;white-space:pre-wrap;color:#8B949E'></div>
-<p class='label'>Auto-refreshes every 2 seconds</p>
+<p class='label' id='logstate'>Connecting...</p>
 </div>
 <script>
-function fetchLogs(){fetch('/logs').then(r=>r.json()).then(d=>{
-var el=document.getElementById('logs');
-el.innerHTML=d.logs.map(l=>'<div>'+l.replace(/</g,'&lt;')+'</div>').join('');
-el.scrollTop=el.scrollHeight;
-}).catch(e=>{});}
-fetchLogs();setInterval(fetchLogs,2000);
+var el=document.getElementById('logs'),st=document.getElementById('logstate');
+var es=new EventSource(')rawliteral" WEB_LOG_STREAM_PATH R"rawliteral(');
+es.onopen=function(){st.textContent='Live';};
+es.onerror=function(){st.textContent='Reconnecting...';};
+es.onmessage=function(e){
+var d=document.createElement('div');d.textContent=e.data;el.appendChild(d);
+while(el.childNodes.length>)rawliteral";
+  page += String(WEB_LOG_LINES);
+  page += R"rawliteral()el.removeChild(el.firstChild);
+el.scrollTop=el.scrollHeight;};
 </script>
 </body></html>
 )rawliteral";
   return page;
 }
 
-void handleOTAUpload() {
-  HTTPUpload& upload = otaServer.upload();
-  if (upload.status == UPLOAD_FILE_START) {
-    Serial.printf("OTA Start: %s\n", upload.filename.c_str());
-    if (!Update.begin(UPDATE_SIZE_UNKNOWN)) {
-      Update.printError(Serial);
-    }
-  } else if (upload.status == UPLOAD_FILE_WRITE) {
-    if (Update.write(upload.buf, upload.currentSize) != upload.currentSize) {
-      Update.printError(Serial);
+// ===== OTA throughput benchmark =====
+// GET /otabench?url=http://<pc>:8090/firmware.bin[&chunk=32768&depth=3&flash=1]
+// Downloads into the inactive OTA slot and aborts, so nothing is installed.
+// tools/ota_bench.py serves a throttled image and runs the comparison.
+// Unauthenticated and able to erase the OTA slot, so it only exists in bench
+// builds (-DOTA_BENCH in platformio.ini).
+#ifdef OTA_BENCH
+static size_t otaBenchDiscard(uint8_t *data, size_t len) {
+  return len;
+}
+
+static String runOtaBench(const String& url, size_t chunkSize, uint8_t depth, bool flash) {
+  JsonDocument doc;
+  doc["chunk"] = chunkSize;
+  doc["depth"] = depth;
+  doc["flash"] = flash;
+  if (otaInProgress) {
+    doc["error"] = "OTA in progress";
+    String out;
+    serializeJson(doc, out);
+    return out;
+  }
+  otaInProgress = true;  // Keeps the scheduled and LAN updates away until we're done
+  
+  HTTPClient http;
+  http.useHTTP10(true);
+  http.setTimeout(OTA_PIPE_DATA_TIMEOUT_MS);
+  http.begin(url);
+  int code = http.GET();
+  int length = http.getSize();
+  bool ready = code == 200 && (!flash || Update.begin(length > 0 ? length : UPDATE_SIZE_UNKNOWN));
+  if (!ready) {
+    doc["error"] = code == 200 ? "Update.begin failed" : "HTTP " + String(code);
+    http.end();
+    otaInProgress = false;
+    String out;
+    serializeJson(doc, out);
+    return out;
+  }
+  
+  OtaPipelineConfig pipe = otaPipelineDefaults();
+  pipe.chunkSize = chunkSize;
+  pipe.depth = depth;
+  if (!flash) pipe.sink = otaBenchDiscard;
+  OtaPipelineStats stats;
+  OtaPipelineResult result = otaPipelineRun(*http.getStreamPtr(), length > 0 ? length : 0, pipe, &stats);
+  http.end();
+  if (flash) Update.abort();
+  otaInProgress = false;
+  
+  doc["result"] = otaPipelineResultName(result);
+  doc["bytes"] = stats.bytes;
+  doc["ms"] = stats.elapsedMs;
+  doc["mbps"] = stats.elapsedMs ? stats.bytes / 1000.0 / stats.elapsedMs : 0;
+  doc["networkWaitMs"] = stats.networkWaitMs;
+  doc["bufferWaitMs"] = stats.bufferWaitMs;
+  doc["writeMs"] = stats.writeMs;
+  doc["writerIdleMs"] = stats.writerIdleMs;
+  doc["psram"] = stats.psram;
+  String out;
+  serializeJson(doc, out);
+  dualLog("[OTA bench] %s\n", out.c_str());
+  return out;
+}
+
+// The benchmark runs for as long as the download takes, so it gets its own
+// task; the response polls for the result (RESPONSE_TRY_AGAIN) instead of
+// holding up the AsyncTCP task.
+struct OtaBenchArgs {
+  String url;
+  size_t chunk;
+  uint8_t depth;
+  bool flash;
+};
+static volatile bool otaBenchRunning = false;
+static String otaBenchResult;
+
+static void otaBenchTask(void *pv) {
+  OtaBenchArgs *args = static_cast<OtaBenchArgs *>(pv);
+  otaBenchResult = runOtaBench(args->url, args->chunk, args->depth, args->flash);
+  delete args;
+  otaBenchRunning = false;
+  vTaskDelete(nullptr);
+}
+
+static void startOtaBench(AsyncWebServerRequest *request, const String& url, size_t chunk, uint8_t depth,
+                          bool flash) {
+  if (otaBenchRunning) {
+    request->send(409, "text/plain", "Benchmark already running");
+    return;
+  }
+  otaBenchRunning = true;
+  otaBenchResult = "";
+  OtaBenchArgs *args = new OtaBenchArgs{url, chunk, depth, flash};
+  if (xTaskCreatePinnedToCore(otaBenchTask, "ota_bench", 8192, args, 2, nullptr, ARDUINO_RUNNING_CORE) != pdPASS) {
+    delete args;
+    otaBenchRunning = false;
+    request->send(503, "text/plain", "Out of memory");
+    return;
+  }
+  AsyncWebServerResponse *response = request->beginChunkedResponse("application/json",
+    [](uint8_t *buf, size_t maxLen, size_t index) -> size_t {
+      if (otaBenchRunning) return RESPONSE_TRY_AGAIN;
+      if (index >= otaBenchResult.length()) return 0;
+      size_t n = min(maxLen, otaBenchResult.length() - index);
+      memcpy(buf, otaBenchResult.c_str() + index, n);
+      return n;
+    });
+  response->addHeader("Cache-Control", "no-store");
+  request->send(response);
+}
+#endif
+
+// API keys arrive on the AsyncTCP task but are read by the fetch code in
+// loop(); loop() picks them up from this queue between fetches so a key
+// String is never reassigned while a request is being built from it
+#define WEB_KEY_MAX 96
+struct WebKeyUpdate {
+  WebKeySlot slot;
+  char key[WEB_KEY_MAX];
+};
+static QueueHandle_t webKeyQueue = nullptr;
+
+static void applyWebKeyUpdates() {
+  WebKeyUpdate update;
+  bool changed = false;
+  while (webKeyQueue != nullptr && xQueueReceive(webKeyQueue, &update, 0) == pdTRUE) {
+    switch (update.slot) {
+      case WEB_KEY_TWELVEDATA: apiKey = update.key; break;
+      case WEB_KEY_FINNHUB: finnhubApiKey = update.key; break;
+      case WEB_KEY_POLYGON: polygonApiKey = update.key; break;
+      default: continue;
     }
-  } else if (upload.status == UPLOAD_FILE_END) {
-    if (Update.end(true)) {
-      Serial.printf("OTA Done: %u bytes\n", upload.totalSize);
-    } else {
-      Update.printError(Serial);
+    changed = true;
+  }
+  if (changed) updateMaskedKeys();
+}
+
+static void handleKeyPost(AsyncWebServerRequest *request, WebKeySlot slot, const char *prefKey, const char *label) {
+  if (request->hasArg("key")) {
+    String newKey = request->arg("key");
+    if (newKey.length() > 0 && newKey.length() < WEB_KEY_MAX && newKey.indexOf("****") == -1) {  // Don't save masked value
+      WebKeyUpdate update = {slot, {}};
+      strlcpy(update.key, newKey.c_str(), sizeof(update.key));
+      if (webKeyQueue != nullptr && xQueueSend(webKeyQueue, &update, 0) == pdTRUE) {
+        Preferences prefs;
+        prefs.begin("stock", false);
+        prefs.putString(prefKey, newKey);
+        prefs.end();
+        Serial.printf("%s API key updated via web\n", label);
+        request->send(200, "text/html", String("<html><body style='background:#0D1117;color:#00E676;text-align:center;padding:50px'><h1>") + label + " Key Saved!</h1><p><a href='/' style='color:#58A6FF'>Back</a></p></body></html>");
+        return;
+      }
     }
   }
+  request->send(200, "text/html", "<html><body style='background:#0D1117;color:#FF5252;text-align:center;padding:50px'><h1>Invalid Key</h1><p><a href='/' style='color:#58A6FF'>Back</a></p></body></html>");
+}
+
+static void sendNoStore(AsyncWebServerRequest *request, const char *type, const String& body) {
+  AsyncWebServerResponse *response = request->beginResponse(200, type, body);
+  response->addHeader("Cache-Control", "no-store");
+  request->send(response);
 }
 
 void setupOTA() {
@@ -2859,73 +4704,45 @@ void setupOTA() {
     Serial.println("mDNS failed");
   }
   
-  otaServer.on("/", HTTP_GET, []() {
-    otaServer.send(200, "text/html", buildOtaPage());
+  webKeyQueue = xQueueCreate(4, sizeof(WebKeyUpdate));
+  
+  otaServer.on("/", HTTP_GET, [](AsyncWebServerRequest *request) {
+    request->send(200, "text/html", buildOtaPage());
   });
   
-  otaServer.on("/apikey", HTTP_POST, []() {
-    if (otaServer.hasArg("key")) {
-      String newKey = otaServer.arg("key");
-      if (newKey.length() > 0 && newKey.indexOf("****") == -1) {  // Don't save masked value
-        apiKey = newKey;
-        Preferences prefs;
-        prefs.begin("stock", false);
-        prefs.putString("apikey", apiKey);
-        prefs.end();
-        Serial.println("TwelveData API key updated via web");
-        otaServer.send(200, "text/html", "<html><body style='background:#0D1117;color:#00E676;text-align:center;padding:50px'><h1>TwelveData Key Saved!</h1><p><a href='/' style='color:#58A6FF'>Back</a></p></body></html>");
-        return;
-      }
-    }
-    otaServer.send(200, "text/html", "<html><body style='background:#0D1117;color:#FF5252;text-align:center;padding:50px'><h1>Invalid Key</h1><p><a href='/' style='color:#58A6FF'>Back</a></p></body></html>");
+  otaServer.on("/apikey", HTTP_POST, [](AsyncWebServerRequest *request) {
+    handleKeyPost(request, WEB_KEY_TWELVEDATA, "apikey", "TwelveData");
   });
   
-  otaServer.on("/finnhubkey", HTTP_POST, []() {
-    if (otaServer.hasArg("key")) {
-      String newKey = otaServer.arg("key");
-      if (newKey.length() > 0 && newKey.indexOf("****") == -1) {  // Don't save masked value
-        finnhubApiKey = newKey;
-        Preferences prefs;
-        prefs.begin("stock", false);
-        prefs.putString("finnhubkey", finnhubApiKey);
-        prefs.end();
-        Serial.println("Finnhub API key updated via web");
-        otaServer.send(200, "text/html", "<html><body style='background:#0D1117;color:#00E676;text-align:center;padding:50px'><h1>Finnhub Key Saved!</h1><p><a href='/' style='color:#58A6FF'>Back</a></p></body></html>");
-        return;
-      }
-    }
-    otaServer.send(200, "text/html", "<html><body style='background:#0D1117;color:#FF5252;text-align:center;padding:50px'><h1>Invalid Key</h1><p><a href='/' style='color:#58A6FF'>Back</a></p></body></html>");
+  otaServer.on("/finnhubkey", HTTP_POST, [](AsyncWebServerRequest *request) {
+    handleKeyPost(request, WEB_KEY_FINNHUB, "finnhubkey", "Finnhub");
   });
   
-  otaServer.on("/polygonkey", HTTP_POST, []() {
-    if (otaServer.hasArg("key")) {
-      String newKey = otaServer.arg("key");
-      if (newKey.length() > 0 && newKey.indexOf("****") == -1) {  // Don't save masked value
-        polygonApiKey = newKey;
-        Preferences prefs;
-        prefs.begin("stock", false);
-        prefs.putString("polygonkey", polygonApiKey);
-        prefs.end();
-        Serial.println("Polygon API key updated via web");
-        otaServer.send(200, "text/html", "<html><body style='background:#0D1117;color:#00E676;text-align:center;padding:50px'><h1>Polygon Key Saved!</h1><p><a href='/' style='color:#58A6FF'>Back</a></p></body></html>");
-        return;
-      }
-    }
-    otaServer.send(200, "text/html", "<html><body style='background:#0D1117;color:#FF5252;text-align:center;padding:50px'><h1>Invalid Key</h1><p><a href='/' style='color:#58A6FF'>Back</a></p></body></html>");
+  otaServer.on("/polygonkey", HTTP_POST, [](AsyncWebServerRequest *request) {
+    handleKeyPost(request, WEB_KEY_POLYGON, "polygonkey", "Polygon");
+  });
+  
+  otaServer.on("/stats", HTTP_GET, [](AsyncWebServerRequest *request) {
+    sendNoStore(request, "application/json", dataStatsJson());
   });
+
+  // Live log viewer; /logs below still serves the whole ring as JSON
+  webLogStreamBegin();
   
-  // Serve logs as JSON for live log viewer
-  otaServer.on("/logs", HTTP_GET, []() {
+  // Serve logs as JSON
+  otaServer.on("/logs", HTTP_GET, [](AsyncWebServerRequest *request) {
+    // Snapshot the ring so writers on other tasks don't change it under us
+    static char lines[WEB_LOG_LINES][WEB_LOG_LINE_LEN];
+    int count = webLogSnapshot(lines);
     String json = "{\"logs\":[";
+    json.reserve(count * 64 + 16);
     // Output logs in chronological order (oldest first)
-    int start = (webLogCount < WEB_LOG_LINES) ? 0 : webLogHead;
-    for (int i = 0; i < webLogCount; i++) {
-      int idx = (start + i) % WEB_LOG_LINES;
+    for (int i = 0; i < count; i++) {
       if (i > 0) json += ",";
       json += "\"";
       // Escape quotes and backslashes in log messages
-      for (int j = 0; webLogBuffer[idx][j] != '\0' && j < WEB_LOG_LINE_LEN; j++) {
-        char c = webLogBuffer[idx][j];
+      for (int j = 0; lines[i][j] != '\0' && j < WEB_LOG_LINE_LEN; j++) {
+        char c = lines[i][j];
         if (c == '"') json += "\\\"";
         else if (c == '\\') json += "\\\\";
         else if (c == '\n') json += "\\n";
@@ -2935,20 +4752,44 @@ void setupOTA() {
       json += "\"";
     }
     json += "]}";
-    otaServer.send(200, "application/json", json);
+    request->send(200, "application/json", json);
   });
   
-  otaServer.on("/update", HTTP_POST, []() {
-    bool success = !Update.hasError();
-    otaServer.send(200, "text/html", success ? 
-      "<html><body style='background:#0D1117;color:#00E676;text-align:center;padding:50px'><h1>Success! Rebooting...</h1></body></html>" :
-      "<html><body style='background:#0D1117;color:#FF5252;text-align:center;padding:50px'><h1>Failed!</h1></body></html>");
-    if (success) {
-      delay(1000);
-      ESP.restart();
+#ifdef OTA_BENCH
+  otaServer.on("/otabench", HTTP_GET, [](AsyncWebServerRequest *request) {
+    if (otaInProgress) {
+      request->send(409, "text/plain", "OTA in progress");
+      return;
+    }
+    if (!request->hasArg("url")) {
+      request->send(400, "text/plain", "url= required");
+      return;
     }
-  }, handleOTAUpload);
+    size_t chunk = request->hasArg("chunk") ? request->arg("chunk").toInt() : OTA_PIPE_CHUNK;
+    uint8_t depth = request->hasArg("depth") ? request->arg("depth").toInt() : OTA_PIPE_DEPTH;
+    bool flash = !request->hasArg("flash") || request->arg("flash") != "0";
+    chunk = constrain(chunk, (size_t)1024, (size_t)65536);
+    depth = constrain(depth, 1, OTA_PIPE_MAX_DEPTH);
+    startOtaBench(request, request->arg("url"), chunk, depth, flash);
+  });
+#endif
+  
+#if LAN_OTA_ENABLED
+  // LAN peers pull new firmware from whichever ticker already runs it. Hash the
+  // running image and check its release signature now, not on the AsyncTCP
+  // task when the first peer asks.
+  lanOtaReady = lanOtaBegin(LAN_OTA_PUBLIC_KEY, P2P_NETWORK_KEY, FIRMWARE_VERSION);
+  if (lanOtaReady) {
+    size_t imageLength;
+    char imageSha[65];
+    lanOtaImageInfo(imageLength, imageSha);
+    otaServer.on(LAN_OTA_PATH, HTTP_GET, [](AsyncWebServerRequest *request) { lanOtaServe(request); });
+  }
+#endif
+  
+  otaUploadAttach(otaServer, otaInProgress);
   
+  // Requests are handled on the AsyncTCP task, independent of loop()
   otaServer.begin();
   Serial.println("OTA ready at http://stockticker.local");
 }
@@ -2957,6 +4798,13 @@ void setup() {
   Serial.begin(115200);
   delay(500);
   Serial.println("\n=== Stock Ticker Starting ===");
+
+  // TLS record buffers in PSRAM leave internal RAM to WiFi and LVGL (sys_health.h)
+  bool tlsPsram = sysHealthTlsUsePsram(SYS_HEALTH_TLS_PSRAM_THRESHOLD);
+  Serial.printf("mbedTLS buffers >= %u bytes in PSRAM: %s\n", SYS_HEALTH_TLS_PSRAM_THRESHOLD, tlsPsram ? "yes" : "no");
+  
+  // Map the read-only symbol metadata table (company names without heap/network)
+  symbolTableBegin();
   
   Board *board = new Board();
   board->init();
@@ -3315,6 +5163,7 @@ void setup() {
     #endif
   }
   prefs.end();
+  updateMaskedKeys();
   
   Serial.printf("TwelveData API Key: %s***\n", apiKey.substring(0, 4).c_str());
   if (finnhubApiKey.length() > 0) {
@@ -3465,6 +5314,9 @@ void loop() {
   // P2P network heartbeat (share stock data with other devices)
   p2pTick();
   
+  // LAN peers: answer queries, beacons
+  lanTick();
+  
   // Process pending actions with proper locking
   if (pendingOpenSettings || pendingClosePopup || pendingOpenWifi || 
       pendingCloseWifi || pendingShowKeyboard || pendingWifiConnect ||
@@ -3588,7 +5440,30 @@ void loop() {
   // Handle fetch outside of LVGL lock
   if (pendingFetch) {
     pendingFetch = false;
-    fetchPrice();
+    // Stale-while-revalidate: paint the cached quote immediately, then refresh in place.
+    CachedStockData* cached = findCachedSymbol(currentSymbol);
+    bool fresh = false;
+    if (cached != nullptr && loadCachedQuote(currentSymbol)) {
+      FreshnessReport report;
+      fresh = !evaluateFreshness(*cached, report);
+      prefetchedStock.stale = !fresh;
+      Serial.printf("[SWR] %s cache: %s\n", currentSymbol.c_str(), describeStaleness(report).c_str());
+      dataStatsHit(CACHE_QUOTE);
+      if (lvgl_port_lock(100)) {
+        applyPrefetchedData();
+        lvgl_port_unlock();
+      }
+    } else {
+      dataStatsMiss(CACHE_QUOTE);
+    }
+    if (fresh) {
+      Serial.printf("[SWR] %s served from cache (fresh)\n", currentSymbol.c_str());
+      prefs.begin("stock", false);
+      prefs.putString("symbol", currentSymbol);
+      prefs.end();
+    } else {
+      fetchPrice();
+    }
   }
   
   // Handle GitHub OTA check outside of LVGL lock
@@ -3604,7 +5479,7 @@ void loop() {
 
     // If we have no progress for 25s (and at least 25s since start), it’s wedged.
     if ((now - githubOtaTaskStartMs) > 25000 && (now - last) > 25000) {
-      Serial.println("OTA appears stuck; aborting and rebooting");
+      dualLog("OTA appears stuck in stage '%s'; aborting and rebooting\n", sysHealthStage());
       githubOtaSetStatus("Connection stalled");
       githubOtaSetWarn("Rebooting...");
 
@@ -3650,8 +5525,8 @@ void loop() {
     }
   }
   
-  // Stock rotation - based on user-selected interval
-  if (rotationEnabled && rotationCount > 1 && settingsPopup == nullptr) {
+  // Stock rotation - based on user-selected interval (or the shared wall clock)
+  if (rotationEnabled && rotationCount > 1 && settingsPopup == nullptr && !wallRotationTick()) {
     uint32_t intervalMs = (uint32_t)rotationIntervalMins * 60000;
     if (millis() - lastRotationTime > intervalMs) {
       lastRotationTime = millis();
@@ -3702,6 +5577,34 @@ void loop() {
     }
   }
   
+  // A LAN peer pushed a newer quote for the symbol on screen
+  if (lanTakePushRepaint() && loadCachedQuote(currentSymbol)) {
+    if (lvgl_port_lock(100)) {
+      applyPrefetchedData();  // Update in place, no fade
+      lvgl_port_unlock();
+    }
+  }
+  
+  // Background revalidation of a quote that was painted from a stale cache entry
+  if (swrRevalidatePending && !otaInProgress && WiFi.status() == WL_CONNECTED) {
+    swrRevalidatePending = false;
+    String symbol = swrRevalidateSymbol;
+    if (symbol == currentSymbol) {
+      fetchBudgetEndMs = millis() + SWR_REVALIDATE_BUDGET_MS;
+      bool refreshed = prefetchStockData(symbol, true);
+      fetchBudgetEndMs = 0;
+      if (lvgl_port_lock(100)) {
+        if (refreshed && prefetchedStock.symbol == currentSymbol) {
+          applyPrefetchedData();  // Update in place, no fade
+        } else if (!refreshed) {
+          lv_label_set_text(statusLabel, "Cached (API Error)");
+        }
+        lvgl_port_unlock();
+      }
+      Serial.printf("[SWR] Revalidated %s: %s\n", symbol.c_str(), refreshed ? "updated" : "failed");
+    }
+  }
+  
   // Nightly reboot at 4AM (market closed) - clears artifacts/memory leaks
   static uint32_t lastRebootCheckMs = 0;
   if ((millis() - lastRebootCheckMs) > 60000) {  // Check every minute
@@ -3748,23 +5651,36 @@ void loop() {
     }
   }
   
-  // Handle OTA web server requests
-  otaServer.handleClient();
+  // Keys saved from the web page (handlers run on the AsyncTCP task)
+  applyWebKeyUpdates();
   
   // Log API stats every 5 minutes
-  if (now - apiStats.lastLogTime > 300000) {
-    apiStats.lastLogTime = now;
-    uint32_t totalCalls = apiStats.twelveDataQuoteCalls + apiStats.twelveDataTimeSeriesCalls;
-    uint32_t totalHits = apiStats.localCacheHits + apiStats.p2pCacheHits;
+  // (Full counters, latency histograms included, are served as JSON at /stats)
+  if (now - lastApiStatsLogTime > 300000) {
+    lastApiStatsLogTime = now;
+    uint32_t totalCalls = dataStatsCalls(PROVIDER_TWELVEDATA_QUOTE) + dataStatsCalls(PROVIDER_TWELVEDATA_SERIES) +
+                          dataStatsCalls(PROVIDER_FINNHUB) + dataStatsCalls(PROVIDER_POLYGON);
+    uint32_t localHits = cacheStats[CACHE_QUOTE].hits.load();
+    uint32_t p2pHits = cacheStats[CACHE_P2P].hits.load();
+    uint32_t totalHits = localHits + p2pHits;
     float hitRate = (totalCalls + totalHits > 0) ? 
                     (float)totalHits / (totalCalls + totalHits) * 100.0f : 0.0f;
     Serial.println("========== API USAGE STATS ==========");
-    Serial.printf("TwelveData /quote calls:      %u\n", apiStats.twelveDataQuoteCalls);
-    Serial.printf("TwelveData /time_series calls: %u\n", apiStats.twelveDataTimeSeriesCalls);
+    Serial.printf("TwelveData /quote calls:      %u\n", dataStatsCalls(PROVIDER_TWELVEDATA_QUOTE));
+    Serial.printf("TwelveData /time_series calls: %u\n", dataStatsCalls(PROVIDER_TWELVEDATA_SERIES));
+    Serial.printf("Finnhub /quote calls:         %u\n", dataStatsCalls(PROVIDER_FINNHUB));
+    Serial.printf("Polygon /prev calls:          %u\n", dataStatsCalls(PROVIDER_POLYGON));
     Serial.printf("TOTAL API CALLS:              %u\n", totalCalls);
-    Serial.printf("Local cache hits:             %u\n", apiStats.localCacheHits);
-    Serial.printf("P2P network hits:             %u\n", apiStats.p2pCacheHits);
+    Serial.printf("Local cache hits:             %u\n", localHits);
+    Serial.printf("P2P network hits:             %u\n", p2pHits);
     Serial.printf("Cache hit rate:               %.1f%%\n", hitRate);
+    size_t historyPoints = 0, historyBytes = 0;
+    for (int i = 0; i < priceHistoryCount; i++) {
+      historyPoints += priceHistory[i].series.count();
+      historyBytes += priceHistory[i].series.bytesUsed();
+    }
+    Serial.printf("Price history:                %u pts / %u bytes (%d symbols)\n",
+                  (unsigned)historyPoints, (unsigned)historyBytes, priceHistoryCount);
     Serial.println("=====================================");
   }
   
@@ -0,0 +1,249 @@
+// ota_delta.cpp - Streaming delta patch application (see ota_delta.h)
+//
+// Patch bytes arrive in arbitrary pieces (whatever the inflater produced), so
+// the header and each op's fixed fields are collected in small buffers and
+// the payloads of ADD/INSERT are processed as they come. Only COPY and ADD
+// touch flash reads; both go through one OTA_DELTA_READ_CHUNK buffer.
+
+#include "ota_delta.h"
+#include "lan_ota.h"
+
+#include <Update.h>
+#include <esp_ota_ops.h>
+#include <esp_partition.h>
+#include <mbedtls/sha256.h>
+
+#define OP_COPY 1
+#define OP_ADD 2
+#define OP_INSERT 3
+#define OP_MAX_LEN 9  // u8 op + u32 src + u32 len
+
+struct OtaDeltaHeader {
+  char magic[4];
+  uint32_t baseSize;
+  uint8_t baseSha[32];
+  uint32_t targetSize;
+  uint8_t targetSha[32];
+} __attribute__((packed));
+static_assert(sizeof(OtaDeltaHeader) == OTA_DELTA_HEADER_LEN, "header layout must match tools/make_delta.py");
+
+struct OtaDeltaState {
+  bool active;
+  OtaDeltaResult result;
+  OtaSinkFn out;
+  const esp_partition_t *base;
+  uint8_t *buf;
+  uint8_t header[OTA_DELTA_HEADER_LEN];
+  size_t headerLen;
+  OtaDeltaHeader info;
+  uint8_t op[OP_MAX_LEN];
+  size_t opLen;
+  uint8_t opType;
+  uint32_t opSrc;
+  uint32_t opRemaining;  // Payload bytes still to come for ADD/INSERT
+  size_t output;
+  mbedtls_sha256_context sha;
+};
+
+static OtaDeltaState d = {};
+
+static size_t updateSink(uint8_t *data, size_t len) {
+  return Update.write(data, len);
+}
+
+static void toHex(const uint8_t *in, size_t len, char *out) {
+  static const char digits[] = "0123456789abcdef";
+  for (size_t i = 0; i < len; i++) {
+    out[i * 2] = digits[in[i] >> 4];
+    out[i * 2 + 1] = digits[in[i] & 0x0F];
+  }
+  out[len * 2] = '\0';
+}
+
+static uint32_t readU32(const uint8_t *p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void release() {
+  if (d.active) mbedtls_sha256_free(&d.sha);
+  free(d.buf);
+  d.buf = nullptr;
+  d.active = false;
+}
+
+static bool fail(OtaDeltaResult result) {
+  if (d.result == OTA_DELTA_OK) {
+    d.result = result;
+    Serial.printf("[OTA delta] %s at %u/%u bytes\n", otaDeltaResultName(result), (unsigned)d.output,
+                  (unsigned)d.info.targetSize);
+  }
+  return false;
+}
+
+static bool emit(uint8_t *data, size_t len) {
+  mbedtls_sha256_update(&d.sha, data, len);
+  if (d.out(data, len) != len) return fail(OTA_DELTA_WRITE_FAILED);
+  d.output += len;
+  return true;
+}
+
+static bool readBase(uint32_t src, size_t len) {
+  if (esp_partition_read(d.base, src, d.buf, len) != ESP_OK) return fail(OTA_DELTA_READ_FAILED);
+  return true;
+}
+
+static bool checkHeader() {
+  memcpy(&d.info, d.header, sizeof(d.info));
+  if (memcmp(d.info.magic, OTA_DELTA_MAGIC, 4) != 0 || d.info.targetSize == 0) return fail(OTA_DELTA_BAD_HEADER);
+
+  size_t length;
+  char runningSha[65];
+  char baseSha[65];
+  toHex(d.info.baseSha, sizeof(d.info.baseSha), baseSha);
+  if (!lanOtaImageInfo(length, runningSha)) return fail(OTA_DELTA_READ_FAILED);
+  if (length != d.info.baseSize || strcmp(runningSha, baseSha) != 0) {
+    Serial.printf("[OTA delta] Patch base %.12s... is not the running image %.12s...\n", baseSha, runningSha);
+    return fail(OTA_DELTA_WRONG_BASE);
+  }
+  Serial.printf("[OTA delta] Patching %u-byte running image into %u bytes\n", (unsigned)d.info.baseSize,
+                (unsigned)d.info.targetSize);
+  return true;
+}
+
+// Fixed fields of one op are complete: validate, and run COPY right away
+static bool startOp() {
+  d.opType = d.op[0];
+  uint32_t len;
+  if (d.opType == OP_INSERT) {
+    len = readU32(d.op + 1);
+  } else {
+    d.opSrc = readU32(d.op + 1);
+    len = readU32(d.op + 5);
+    if (d.opSrc > d.info.baseSize || len > d.info.baseSize - d.opSrc) return fail(OTA_DELTA_CORRUPT);
+  }
+  if (len > d.info.targetSize - d.output) return fail(OTA_DELTA_CORRUPT);
+  d.opLen = 0;
+  d.opRemaining = len;
+  if (d.opType != OP_COPY) return true;
+
+  while (d.opRemaining > 0) {
+    size_t n = min((size_t)OTA_DELTA_READ_CHUNK, (size_t)d.opRemaining);
+    if (!readBase(d.opSrc, n) || !emit(d.buf, n)) return false;
+    d.opSrc += n;
+    d.opRemaining -= n;
+  }
+  return true;
+}
+
+// Payload bytes of the current ADD/INSERT
+static bool payload(uint8_t *data, size_t len) {
+  if (d.opType == OP_INSERT) return emit(data, len);
+  while (len > 0) {
+    size_t n = min((size_t)OTA_DELTA_READ_CHUNK, len);
+    if (!readBase(d.opSrc, n)) return false;
+    for (size_t i = 0; i < n; i++) d.buf[i] += data[i];
+    if (!emit(d.buf, n)) return false;
+    d.opSrc += n;
+    data += n;
+    len -= n;
+  }
+  return true;
+}
+
+String otaDeltaAssetName() {
+  size_t length;
+  char sha[65];
+  if (!lanOtaImageInfo(length, sha)) return String();
+  sha[OTA_DELTA_ASSET_SHA_CHARS] = '\0';
+  return String(OTA_DELTA_ASSET_PREFIX) + sha + OTA_DELTA_ASSET_SUFFIX;
+}
+
+bool otaDeltaBegin(OtaSinkFn out) {
+  release();
+  d = {};
+  d.out = out ? out : updateSink;
+  d.base = esp_ota_get_running_partition();
+  d.buf = (uint8_t *)malloc(OTA_DELTA_READ_CHUNK);
+  if (d.base == nullptr || d.buf == nullptr) {
+    release();
+    d.result = OTA_DELTA_NO_MEMORY;
+    return false;
+  }
+  mbedtls_sha256_init(&d.sha);
+  mbedtls_sha256_starts(&d.sha, 0);
+  d.active = true;
+  return true;
+}
+
+size_t otaDeltaWrite(uint8_t *data, size_t len) {
+  if (!d.active || d.result != OTA_DELTA_OK) return 0;
+  size_t used = 0;
+
+  if (d.headerLen < OTA_DELTA_HEADER_LEN) {
+    size_t n = min(len, (size_t)(OTA_DELTA_HEADER_LEN - d.headerLen));
+    memcpy(d.header + d.headerLen, data, n);
+    d.headerLen += n;
+    used = n;
+    if (d.headerLen == OTA_DELTA_HEADER_LEN && !checkHeader()) return 0;
+  }
+
+  while (used < len) {
+    if (d.opRemaining > 0) {
+      size_t n = min(len - used, (size_t)d.opRemaining);
+      if (!payload(data + used, n)) return 0;
+      used += n;
+      d.opRemaining -= n;
+      continue;
+    }
+    if (d.output == d.info.targetSize) {
+      fail(OTA_DELTA_CORRUPT);  // Ops past the end of the target
+      return 0;
+    }
+    if (d.opLen == 0 && data[used] != OP_COPY && data[used] != OP_ADD && data[used] != OP_INSERT) {
+      fail(OTA_DELTA_CORRUPT);
+      return 0;
+    }
+    d.op[d.opLen++] = data[used++];
+    size_t need = d.op[0] == OP_INSERT ? 5 : OP_MAX_LEN;
+    if (d.opLen == need && !startOp()) return 0;
+  }
+  return len;
+}
+
+OtaDeltaResult otaDeltaEnd() {
+  if (!d.active) return d.result == OTA_DELTA_OK ? OTA_DELTA_TRUNCATED : d.result;
+  uint8_t digest[32];
+  mbedtls_sha256_finish(&d.sha, digest);
+  if (d.result == OTA_DELTA_OK) {
+    if (d.headerLen < OTA_DELTA_HEADER_LEN || d.output != d.info.targetSize || d.opRemaining > 0 || d.opLen > 0) {
+      fail(OTA_DELTA_TRUNCATED);
+    } else if (memcmp(digest, d.info.targetSha, sizeof(digest)) != 0) {
+      fail(OTA_DELTA_HASH_MISMATCH);
+    }
+  }
+  release();
+  return d.result;
+}
+
+void otaDeltaAbort() {
+  release();
+}
+
+size_t otaDeltaOutputBytes() {
+  return d.output;
+}
+
+const char *otaDeltaResultName(OtaDeltaResult result) {
+  switch (result) {
+    case OTA_DELTA_OK: return "ok";
+    case OTA_DELTA_NO_MEMORY: return "out of memory";
+    case OTA_DELTA_BAD_HEADER: return "bad header";
+    case OTA_DELTA_WRONG_BASE: return "wrong base image";
+    case OTA_DELTA_CORRUPT: return "corrupt patch";
+    case OTA_DELTA_READ_FAILED: return "base read failed";
+    case OTA_DELTA_WRITE_FAILED: return "write failed";
+    case OTA_DELTA_TRUNCATED: return "truncated";
+    case OTA_DELTA_HASH_MISMATCH: return "SHA-256 mismatch";
+  }
+  return "unknown";
+}
@@ -0,0 +1,60 @@
+// ota_delta.h - Apply binary delta patches against the running firmware
+//
+// tools/make_delta.py diffs the previous release's firmware.bin against the
+// new one and publishes the patch as firmware-<sha256(base)[:12]>.delta,
+// deflated in the ota_inflate.h container. A device looks for the asset named
+// after its own running image, so it only ever sees a patch made for it.
+//
+// The patch is a list of ops (see make_delta.py for the byte layout):
+//   COPY    base[src, len)                        - unchanged code and data
+//   ADD     base[src, len) + difference bytes     - moved code, shifted addresses
+//   INSERT  literal bytes                         - new code
+//
+// Applying it streams: network -> otaInflateWrite() -> otaDeltaWrite(), which
+// reads the base bytes from the running app partition and passes the rebuilt
+// image to Update.write() for the inactive slot. The header names the base's
+// SHA-256, checked against the running image before any op runs, and the
+// target's, checked in otaDeltaEnd() before the caller calls Update.end().
+
+#pragma once
+
+#include <Arduino.h>
+#include "ota_pipeline.h"
+
+#define OTA_DELTA_MAGIC "STD1"
+#define OTA_DELTA_HEADER_LEN 76
+#define OTA_DELTA_ASSET_PREFIX "firmware-"
+#define OTA_DELTA_ASSET_SUFFIX ".delta"
+#define OTA_DELTA_ASSET_SHA_CHARS 12
+#define OTA_DELTA_READ_CHUNK 4096   // Base bytes read from flash per step
+
+enum OtaDeltaResult {
+  OTA_DELTA_OK,
+  OTA_DELTA_NO_MEMORY,
+  OTA_DELTA_BAD_HEADER,
+  OTA_DELTA_WRONG_BASE,      // Patch was made for a different running image
+  OTA_DELTA_CORRUPT,         // Unknown op, or an op outside the base/target
+  OTA_DELTA_READ_FAILED,     // esp_partition_read() on the running slot failed
+  OTA_DELTA_WRITE_FAILED,    // Output sink refused data
+  OTA_DELTA_TRUNCATED,       // Patch ended before the whole target was built
+  OTA_DELTA_HASH_MISMATCH,   // Rebuilt image doesn't match the target SHA-256
+};
+
+// Release asset that patches the running image ("" if it can't be hashed).
+String otaDeltaAssetName();
+
+// Start applying a patch; output goes to `out` (nullptr = Update.write()).
+// Update.begin(UPDATE_SIZE_UNKNOWN) must already have succeeded.
+bool otaDeltaBegin(OtaSinkFn out);
+
+// OtaSinkFn: consume (inflated) patch bytes. Returns `len`, or 0 after an error.
+size_t otaDeltaWrite(uint8_t *data, size_t len);
+
+// Finish: the whole target must have been built and match its SHA-256.
+OtaDeltaResult otaDeltaEnd();
+
+void otaDeltaAbort();
+
+size_t otaDeltaOutputBytes();
+
+const char *otaDeltaResultName(OtaDeltaResult result);
@@ -0,0 +1,190 @@
+// ota_inflate.cpp - Streaming firmware decompression (see ota_inflate.h)
+//
+// Uses the tinfl inflater in the ESP32-S3 ROM, so decompression adds no code
+// to the image. tinfl writes into a power-of-two circular buffer that doubles
+// as the LZ77 history; every time it returns, the newly produced span is
+// hashed and handed to the output sink before the buffer wraps over it.
+
+#include "ota_inflate.h"
+
+#include <Update.h>
+#include <esp_heap_caps.h>
+#include <mbedtls/sha256.h>
+#if __has_include(<esp32s3/rom/miniz.h>)
+#include <esp32s3/rom/miniz.h>
+#else
+#include <rom/miniz.h>
+#endif
+
+struct OtaZHeader {
+  char magic[4];
+  uint8_t method;
+  uint8_t reserved[3];
+  uint32_t imageSize;   // Little-endian, same as the ESP32
+  uint32_t packedSize;
+  uint8_t sha256[32];
+};
+static_assert(sizeof(OtaZHeader) == OTA_Z_HEADER_LEN, "header layout must match tools/compress_firmware.py");
+
+struct OtaZState {
+  bool active;
+  OtaInflateResult result;
+  OtaSinkFn out;
+  uint8_t header[OTA_Z_HEADER_LEN];
+  size_t headerLen;
+  OtaZHeader info;
+  tinfl_decompressor *inflator;
+  uint8_t *dict;
+  size_t dictPos;
+  tinfl_status status;
+  size_t packedIn;
+  size_t output;
+  mbedtls_sha256_context sha;
+};
+
+static OtaZState z = {};
+
+static size_t updateSink(uint8_t *data, size_t len) {
+  return Update.write(data, len);
+}
+
+static void *psramAlloc(size_t size) {
+  void *p = heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+  return p ? p : malloc(size);
+}
+
+static void release() {
+  if (z.active) mbedtls_sha256_free(&z.sha);
+  free(z.inflator);
+  free(z.dict);
+  z.inflator = nullptr;
+  z.dict = nullptr;
+  z.active = false;
+}
+
+static bool fail(OtaInflateResult result) {
+  if (z.result == OTA_Z_OK) {
+    z.result = result;
+    Serial.printf("[OTA Z] %s after %u packed / %u image bytes\n", otaInflateResultName(result), (unsigned)z.packedIn,
+                  (unsigned)z.output);
+  }
+  return false;
+}
+
+static bool emit(uint8_t *data, size_t len) {
+  if (z.output + len > z.info.imageSize) return fail(OTA_Z_CORRUPT);
+  mbedtls_sha256_update(&z.sha, data, len);
+  if (z.out(data, len) != len) return fail(OTA_Z_WRITE_FAILED);
+  z.output += len;
+  return true;
+}
+
+bool otaInflateIsCompressed(const uint8_t *data, size_t len) {
+  return len >= 4 && memcmp(data, OTA_Z_MAGIC, 4) == 0;
+}
+
+bool otaInflateBegin(OtaSinkFn out) {
+  release();
+  z = {};
+  z.out = out ? out : updateSink;
+  z.inflator = (tinfl_decompressor *)psramAlloc(sizeof(tinfl_decompressor));
+  z.dict = (uint8_t *)psramAlloc(TINFL_LZ_DICT_SIZE);
+  if (z.inflator == nullptr || z.dict == nullptr) {
+    release();
+    z.result = OTA_Z_NO_MEMORY;
+    return false;
+  }
+  tinfl_init(z.inflator);
+  z.status = TINFL_STATUS_NEEDS_MORE_INPUT;
+  mbedtls_sha256_init(&z.sha);
+  mbedtls_sha256_starts(&z.sha, 0);
+  z.active = true;
+  return true;
+}
+
+size_t otaInflateWrite(uint8_t *data, size_t len) {
+  if (!z.active || z.result != OTA_Z_OK) return 0;
+  size_t used = 0;
+
+  // The header can straddle network reads
+  if (z.headerLen < OTA_Z_HEADER_LEN) {
+    size_t n = min(len, (size_t)(OTA_Z_HEADER_LEN - z.headerLen));
+    memcpy(z.header + z.headerLen, data, n);
+    z.headerLen += n;
+    used = n;
+    if (z.headerLen < OTA_Z_HEADER_LEN) return len;
+    memcpy(&z.info, z.header, sizeof(z.info));
+    if (!otaInflateIsCompressed(z.header, z.headerLen) || z.info.method != OTA_Z_METHOD_DEFLATE ||
+        z.info.imageSize == 0) {
+      fail(OTA_Z_BAD_HEADER);
+      return 0;
+    }
+    Serial.printf("[OTA Z] Compressed image: %u -> %u bytes\n", (unsigned)z.info.packedSize,
+                  (unsigned)z.info.imageSize);
+  }
+
+  while (used < len || z.status == TINFL_STATUS_HAS_MORE_OUTPUT) {
+    if (z.status == TINFL_STATUS_DONE) {
+      fail(OTA_Z_CORRUPT);  // Bytes after the end of the deflate stream
+      return 0;
+    }
+    size_t inBytes = len - used;
+    size_t outBytes = TINFL_LZ_DICT_SIZE - z.dictPos;
+    z.status = tinfl_decompress(z.inflator, data + used, &inBytes, z.dict, z.dict + z.dictPos, &outBytes,
+                                TINFL_FLAG_HAS_MORE_INPUT);
+    used += inBytes;
+    z.packedIn += inBytes;
+    if (outBytes > 0 && !emit(z.dict + z.dictPos, outBytes)) return 0;
+    z.dictPos = (z.dictPos + outBytes) & (TINFL_LZ_DICT_SIZE - 1);
+    if (z.status < 0) {
+      fail(OTA_Z_CORRUPT);
+      return 0;
+    }
+    if (z.status == TINFL_STATUS_DONE) break;
+  }
+  if (used < len) {
+    fail(OTA_Z_CORRUPT);
+    return 0;
+  }
+  return len;
+}
+
+OtaInflateResult otaInflateEnd() {
+  if (!z.active) return z.result == OTA_Z_OK ? OTA_Z_TRUNCATED : z.result;
+  uint8_t digest[32];
+  mbedtls_sha256_finish(&z.sha, digest);
+  if (z.result == OTA_Z_OK) {
+    if (z.status != TINFL_STATUS_DONE || z.output != z.info.imageSize || z.packedIn != z.info.packedSize) {
+      fail(OTA_Z_TRUNCATED);
+    } else if (memcmp(digest, z.info.sha256, sizeof(digest)) != 0) {
+      fail(OTA_Z_HASH_MISMATCH);
+    }
+  }
+  release();
+  return z.result;
+}
+
+void otaInflateAbort() {
+  release();
+}
+
+size_t otaInflateImageSize() {
+  return z.headerLen == OTA_Z_HEADER_LEN ? z.info.imageSize : 0;
+}
+
+size_t otaInflateOutputBytes() {
+  return z.output;
+}
+
+const char *otaInflateResultName(OtaInflateResult result) {
+  switch (result) {
+    case OTA_Z_OK: return "ok";
+    case OTA_Z_NO_MEMORY: return "out of memory";
+    case OTA_Z_BAD_HEADER: return "bad header";
+    case OTA_Z_CORRUPT: return "corrupt stream";
+    case OTA_Z_WRITE_FAILED: return "write failed";
+    case OTA_Z_TRUNCATED: return "truncated";
+    case OTA_Z_HASH_MISMATCH: return "SHA-256 mismatch";
+  }
+  return "unknown";
+}
@@ -0,0 +1,60 @@
+// ota_inflate.h - On-the-fly decompression of compressed firmware images
+//
+// tools/compress_firmware.py wraps firmware.bin in a small container:
+//
+//   header (48 bytes): "STZ1", u8 method, 3 reserved, u32 image size,
+//                      u32 packed size, sha256(image)
+//   packed stream:     raw deflate, 32 KB window
+//
+// otaInflateWrite() has the OtaSinkFn signature, so it drops into the OTA
+// pipeline (or any loop that used to call Update.write()) unchanged: it takes
+// compressed bytes in whatever pieces the network delivers, inflates them
+// with the ROM's tinfl into a 32 KB circular dictionary in PSRAM, and passes
+// the output on to Update.write(). The image hash is checked in
+// otaInflateEnd(), before the caller commits with Update.end().
+//
+// One decompression runs at a time (there is only one Update session).
+
+#pragma once
+
+#include <Arduino.h>
+#include "ota_pipeline.h"
+
+#define OTA_Z_MAGIC "STZ1"
+#define OTA_Z_HEADER_LEN 48
+#define OTA_Z_METHOD_DEFLATE 1
+#define OTA_Z_ASSET_SUFFIX ".z"   // Release asset / upload name: firmware.bin.z
+
+enum OtaInflateResult {
+  OTA_Z_OK,
+  OTA_Z_NO_MEMORY,
+  OTA_Z_BAD_HEADER,      // Wrong magic or unsupported method
+  OTA_Z_CORRUPT,         // Deflate stream error or trailing data
+  OTA_Z_WRITE_FAILED,    // Output sink refused data
+  OTA_Z_TRUNCATED,       // Stream ended early, or sizes disagree with the header
+  OTA_Z_HASH_MISMATCH,   // Inflated image doesn't match the header's SHA-256
+};
+
+// True if `data` starts with the container magic (needs at least 4 bytes).
+bool otaInflateIsCompressed(const uint8_t *data, size_t len);
+
+// Start a decompression whose output goes to `out` (nullptr = Update.write()).
+// Update.begin() must already have succeeded; the image size is only known
+// once the header arrives, so begin with UPDATE_SIZE_UNKNOWN.
+bool otaInflateBegin(OtaSinkFn out);
+
+// OtaSinkFn: consume compressed bytes. Returns `len`, or 0 after an error.
+size_t otaInflateWrite(uint8_t *data, size_t len);
+
+// Finish: verify the stream ended where the header says and the SHA-256
+// matches. Frees the buffers either way.
+OtaInflateResult otaInflateEnd();
+
+// Drop a decompression without verifying (frees the buffers).
+void otaInflateAbort();
+
+// Image size from the header (0 until it has arrived) and bytes inflated so far.
+size_t otaInflateImageSize();
+size_t otaInflateOutputBytes();
+
+const char *otaInflateResultName(OtaInflateResult result);
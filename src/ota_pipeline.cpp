@@ -0,0 +1,220 @@
+// ota_pipeline.cpp - Reader/writer OTA pipeline (see ota_pipeline.h)
+//
+// Flash erase/program suspends the caches on both cores, so the reader can't
+// run while a sector is being written. The overlap comes from the WiFi/lwIP
+// side: it keeps receiving into the TCP window during the write, and the
+// reader drains that backlog into the next free buffer as soon as the write
+// returns, instead of the socket sitting full while we wait for flash.
+
+#include "ota_pipeline.h"
+
+#include <Update.h>
+#include <esp_heap_caps.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+struct PipeSlot {
+  uint8_t index;
+  size_t len;  // 0 = end of stream
+};
+
+struct PipeShared {
+  uint8_t *buffers;
+  size_t chunkSize;
+  OtaSinkFn sink;
+  QueueHandle_t freeSlots;
+  QueueHandle_t fullSlots;
+  SemaphoreHandle_t done;
+  volatile bool writeFailed;
+  volatile size_t written;
+  uint32_t writeMs;
+  uint32_t idleMs;
+};
+
+static size_t updateSink(uint8_t *data, size_t len) {
+  return Update.write(data, len);
+}
+
+static void writeChunk(PipeShared &p, const PipeSlot &slot) {
+  if (p.writeFailed) return;  // Keep draining so the reader never blocks on us
+  uint32_t startMs = millis();
+  size_t n = p.sink(p.buffers + slot.index * p.chunkSize, slot.len);
+  p.writeMs += millis() - startMs;
+  if (n != slot.len) {
+    p.writeFailed = true;
+  } else {
+    p.written += n;
+  }
+}
+
+static void writerTask(void *pv) {
+  PipeShared &p = *static_cast<PipeShared *>(pv);
+  PipeSlot slot;
+  for (;;) {
+    uint32_t waitMs = millis();
+    xQueueReceive(p.fullSlots, &slot, portMAX_DELAY);
+    p.idleMs += millis() - waitMs;
+    if (slot.len == 0) break;
+    writeChunk(p, slot);
+    xQueueSend(p.freeSlots, &slot, portMAX_DELAY);
+  }
+  xSemaphoreGive(p.done);
+  vTaskDelete(nullptr);
+}
+
+// Read until `want` bytes are in `buf`, the connection closes or the server
+// stalls. Returns the byte count; `result` is only changed on close/stall.
+static size_t fillChunk(WiFiClient &stream, uint8_t *buf, size_t want, uint32_t timeoutMs, uint32_t &waitMs,
+                        OtaPipelineResult &result) {
+  size_t got = 0;
+  uint32_t lastDataMs = millis();
+  while (got < want) {
+    size_t available = stream.available();
+    if (available == 0) {
+      if (!stream.connected()) {
+        result = OTA_PIPE_DISCONNECTED;
+        break;
+      }
+      if (millis() - lastDataMs > timeoutMs) {
+        result = OTA_PIPE_STALLED;
+        break;
+      }
+      uint32_t startMs = millis();
+      vTaskDelay(1);
+      waitMs += millis() - startMs;
+      continue;
+    }
+    int n = stream.read(buf + got, min(available, want - got));
+    if (n <= 0) continue;
+    got += n;
+    lastDataMs = millis();
+  }
+  return got;
+}
+
+OtaPipelineConfig otaPipelineDefaults() {
+  OtaPipelineConfig config;
+  config.chunkSize = OTA_PIPE_CHUNK;
+  config.depth = OTA_PIPE_DEPTH;
+  config.dataTimeoutMs = OTA_PIPE_DATA_TIMEOUT_MS;
+  config.sink = nullptr;
+  config.progress = nullptr;
+  return config;
+}
+
+OtaPipelineResult otaPipelineRun(WiFiClient &stream, size_t contentLength, const OtaPipelineConfig &config,
+                                 OtaPipelineStats *stats) {
+  uint32_t startMs = millis();
+  uint8_t depth = constrain(config.depth, 1, OTA_PIPE_MAX_DEPTH);
+  bool pipelined = depth > 1;
+
+  PipeShared shared = {};
+  shared.chunkSize = config.chunkSize;
+  shared.sink = config.sink ? config.sink : updateSink;
+  shared.buffers = (uint8_t *)heap_caps_malloc(config.chunkSize * depth, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+  bool psram = shared.buffers != nullptr;
+  if (!psram) shared.buffers = (uint8_t *)malloc(config.chunkSize * depth);
+  if (shared.buffers == nullptr) return OTA_PIPE_NO_MEMORY;
+
+  if (pipelined) {
+    shared.freeSlots = xQueueCreate(depth, sizeof(PipeSlot));
+    shared.fullSlots = xQueueCreate(depth + 1, sizeof(PipeSlot));  // +1 for the end marker
+    shared.done = xSemaphoreCreateBinary();
+    bool ok = shared.freeSlots && shared.fullSlots && shared.done;
+    for (uint8_t i = 0; ok && i < depth; i++) {
+      PipeSlot slot = {i, 0};
+      xQueueSend(shared.freeSlots, &slot, 0);
+    }
+    // Writer on the other core at a higher priority, so full buffers drain promptly
+    TaskHandle_t writer = nullptr;
+    if (ok) {
+      ok = xTaskCreatePinnedToCore(writerTask, "ota_writer", 6144, &shared, 3, &writer,
+                                   xPortGetCoreID() == 0 ? 1 : 0) == pdPASS;
+    }
+    if (!ok) {
+      if (shared.freeSlots) vQueueDelete(shared.freeSlots);
+      if (shared.fullSlots) vQueueDelete(shared.fullSlots);
+      if (shared.done) vSemaphoreDelete(shared.done);
+      free(shared.buffers);
+      return OTA_PIPE_NO_MEMORY;
+    }
+  }
+
+  OtaPipelineResult result = OTA_PIPE_OK;
+  uint32_t networkWaitMs = 0;
+  uint32_t bufferWaitMs = 0;
+  size_t read = 0;
+  size_t lastProgress = 0;
+  size_t progressStep = contentLength ? max(contentLength / 100, config.chunkSize) : config.chunkSize;
+  while (!shared.writeFailed) {
+    PipeSlot slot = {0, 0};
+    if (pipelined) {
+      uint32_t waitMs = millis();
+      xQueueReceive(shared.freeSlots, &slot, portMAX_DELAY);
+      bufferWaitMs += millis() - waitMs;
+    }
+
+    size_t want = contentLength ? min(config.chunkSize, contentLength - read) : config.chunkSize;
+    OtaPipelineResult fillResult = OTA_PIPE_OK;
+    slot.len = fillChunk(stream, shared.buffers + slot.index * config.chunkSize, want, config.dataTimeoutMs,
+                         networkWaitMs, fillResult);
+    read += slot.len;
+
+    if (slot.len > 0) {
+      if (pipelined) {
+        xQueueSend(shared.fullSlots, &slot, portMAX_DELAY);
+      } else {
+        writeChunk(shared, slot);
+      }
+    } else if (pipelined) {
+      xQueueSend(shared.freeSlots, &slot, 0);
+    }
+
+    if (config.progress && read - lastProgress >= progressStep) {
+      lastProgress = read;
+      config.progress(shared.written, contentLength);
+    }
+
+    if (fillResult != OTA_PIPE_OK) {
+      // Without a Content-Length the server closing the connection is the end of the body
+      if (!(fillResult == OTA_PIPE_DISCONNECTED && contentLength == 0)) result = fillResult;
+      break;
+    }
+    if (contentLength && read >= contentLength) break;
+  }
+
+  if (pipelined) {
+    PipeSlot end = {0, 0};
+    xQueueSend(shared.fullSlots, &end, portMAX_DELAY);
+    xSemaphoreTake(shared.done, portMAX_DELAY);
+    vQueueDelete(shared.freeSlots);
+    vQueueDelete(shared.fullSlots);
+    vSemaphoreDelete(shared.done);
+  }
+  free(shared.buffers);
+  if (shared.writeFailed) result = OTA_PIPE_WRITE_FAILED;
+
+  if (stats) {
+    stats->bytes = shared.written;
+    stats->elapsedMs = millis() - startMs;
+    stats->networkWaitMs = networkWaitMs;
+    stats->bufferWaitMs = bufferWaitMs;
+    stats->writeMs = shared.writeMs;
+    stats->writerIdleMs = shared.idleMs;
+    stats->psram = psram;
+  }
+  return result;
+}
+
+const char *otaPipelineResultName(OtaPipelineResult result) {
+  switch (result) {
+    case OTA_PIPE_OK: return "ok";
+    case OTA_PIPE_NO_MEMORY: return "out of memory";
+    case OTA_PIPE_STALLED: return "stalled";
+    case OTA_PIPE_DISCONNECTED: return "disconnected";
+    case OTA_PIPE_WRITE_FAILED: return "write failed";
+  }
+  return "unknown";
+}
@@ -0,0 +1,62 @@
+// ota_pipeline.h - Overlapped network reads and flash writes for OTA downloads
+//
+// The calling task reads the HTTP body into a ring of large PSRAM buffers
+// while a writer task drains full buffers into Update.write() (or another
+// sink), so the radio keeps receiving while flash is erased and programmed:
+//
+//   reader (caller) --full--> [ buf 0 | buf 1 | buf 2 ] --full--> writer task
+//                   <--free--                          <--free--
+//
+// depth 1 runs the old synchronous loop (read a chunk, write it, repeat) in
+// the calling task; the benchmark uses it as the baseline.
+
+#pragma once
+
+#include <Arduino.h>
+#include <WiFiClient.h>
+#include "ota_session.h"
+
+#define OTA_PIPE_CHUNK 32768            // Bytes per buffer (8 flash sectors)
+#define OTA_PIPE_DEPTH 3                // Buffers in flight
+#define OTA_PIPE_MAX_DEPTH 4
+#define OTA_PIPE_DATA_TIMEOUT_MS 30000  // Give up when the server stops sending
+
+// Called from the reading task roughly every percent (or every chunk when
+// the length is unknown). Safe to do UI work here; the writer keeps going.
+typedef void (*OtaProgressFn)(size_t written, size_t total);
+
+struct OtaPipelineConfig {
+  size_t chunkSize;
+  uint8_t depth;
+  uint32_t dataTimeoutMs;
+  OtaSinkFn sink;  // nullptr = Update.write()
+  OtaProgressFn progress;
+};
+
+enum OtaPipelineResult {
+  OTA_PIPE_OK,
+  OTA_PIPE_NO_MEMORY,
+  OTA_PIPE_STALLED,       // No data for dataTimeoutMs
+  OTA_PIPE_DISCONNECTED,  // Connection closed before contentLength bytes
+  OTA_PIPE_WRITE_FAILED,  // Sink took fewer bytes than offered
+};
+
+struct OtaPipelineStats {
+  size_t bytes;            // Accepted by the sink
+  uint32_t elapsedMs;
+  uint32_t networkWaitMs;  // Reader waiting for data from the socket
+  uint32_t bufferWaitMs;   // Reader waiting for a free buffer (flash-bound)
+  uint32_t writeMs;        // Time inside the sink
+  uint32_t writerIdleMs;   // Writer waiting for a full buffer (network-bound)
+  bool psram;              // Buffers came from PSRAM
+};
+
+OtaPipelineConfig otaPipelineDefaults();
+
+// Stream `contentLength` bytes (0 = until the server closes) from `stream`
+// into the sink. Update.begin() must already have succeeded; the caller
+// still calls Update.end() (or abort()) afterwards. `stats` may be nullptr.
+OtaPipelineResult otaPipelineRun(WiFiClient &stream, size_t contentLength, const OtaPipelineConfig &config,
+                                 OtaPipelineStats *stats);
+
+const char *otaPipelineResultName(OtaPipelineResult result);
@@ -0,0 +1,248 @@
+// ota_session.cpp - OTA download state machine (see ota_session.h)
+
+#include "ota_session.h"
+
+#include <stdio.h>
+#include <string.h>
+
+bool otaVersionIsNewer(const char *remote, const char *local) {
+  int rMajor = 0, rMinor = 0, rPatch = 0;
+  int lMajor = 0, lMinor = 0, lPatch = 0;
+  sscanf(remote, "%d.%d.%d", &rMajor, &rMinor, &rPatch);
+  sscanf(local, "%d.%d.%d", &lMajor, &lMinor, &lPatch);
+  if (rMajor != lMajor) return rMajor > lMajor;
+  if (rMinor != lMinor) return rMinor > lMinor;
+  return rPatch > lPatch;
+}
+
+// ===== Chunked transfer decoding =====
+void OtaChunkDecoder::reset() {
+  *this = OtaChunkDecoder();
+}
+
+static int hexValue(uint8_t c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+size_t OtaChunkDecoder::write(uint8_t *data, size_t len, OtaSinkFn out) {
+  size_t i = 0;
+  while (i < len && state_ != FAILED) {
+    uint8_t c = data[i];
+    switch (state_) {
+      case SIZE: {
+        int v = hexValue(c);
+        if (v >= 0 && digits_ < 8) {
+          remaining_ = (remaining_ << 4) | (uint32_t)v;
+          digits_++;
+        } else if (digits_ > 0 && (c == ';' || c == ' ' || c == '\t')) {
+          state_ = EXTENSION;
+        } else if (digits_ > 0 && c == '\r') {
+          state_ = SIZE_LF;
+        } else {
+          state_ = FAILED;
+        }
+        i++;
+        break;
+      }
+      case EXTENSION:
+        if (c == '\r') state_ = SIZE_LF;
+        i++;
+        break;
+      case SIZE_LF:
+        if (c != '\n') {
+          state_ = FAILED;
+        } else if (remaining_ == 0) {
+          state_ = TRAILER;
+          lineEmpty_ = true;
+        } else {
+          state_ = DATA;
+        }
+        i++;
+        break;
+      case DATA: {
+        size_t n = len - i < remaining_ ? len - i : remaining_;
+        if (out(data + i, n) != n) {
+          state_ = FAILED;
+          break;
+        }
+        payload_ += n;
+        remaining_ -= n;
+        i += n;
+        if (remaining_ == 0) state_ = DATA_CR;
+        break;
+      }
+      case DATA_CR:
+        state_ = c == '\r' ? DATA_LF : FAILED;
+        i++;
+        break;
+      case DATA_LF:
+        state_ = c == '\n' ? SIZE : FAILED;
+        digits_ = 0;
+        i++;
+        break;
+      case TRAILER:
+        if (c == '\r') {
+          state_ = TRAILER_LF;
+        } else {
+          lineEmpty_ = false;
+        }
+        i++;
+        break;
+      case TRAILER_LF:
+        if (c != '\n') {
+          state_ = FAILED;
+        } else if (lineEmpty_) {
+          state_ = DONE;
+        } else {
+          state_ = TRAILER;
+          lineEmpty_ = true;
+        }
+        i++;
+        break;
+      case DONE:
+        i = len;  // Nothing belongs to the body after the last chunk
+        break;
+      case FAILED:
+        break;
+    }
+  }
+  return state_ == FAILED ? 0 : len;
+}
+
+// ===== Session =====
+static void copyUrl(char *dst, const char *src, size_t srcLen) {
+  if (srcLen >= OTA_SESSION_URL_MAX) srcLen = OTA_SESSION_URL_MAX - 1;
+  memcpy(dst, src, srcLen);
+  dst[srcLen] = '\0';
+}
+
+void OtaSession::begin(const char *url, const OtaSessionConfig &config) {
+  *this = OtaSession();
+  config_ = config;
+  copyUrl(origin_, url, strlen(url));
+  copyUrl(url_, url, strlen(url));
+}
+
+// Absolute, scheme-relative ("//host/path") and host-relative ("/path")
+// locations; GitHub and S3 only send absolute ones
+bool OtaSession::setLocation(const char *location) {
+  if (location == nullptr || location[0] == '\0') return false;
+  size_t len = strlen(location);
+  if (len >= OTA_SESSION_URL_MAX) return false;
+  if (strncmp(location, "http://", 7) == 0 || strncmp(location, "https://", 8) == 0) {
+    copyUrl(url_, location, len);
+    return true;
+  }
+  if (location[0] != '/') return false;
+
+  const char *scheme = strstr(url_, "://");
+  if (scheme == nullptr) return false;
+  const char *prefixEnd = scheme + 1;  // Keep "https:" for "//host/path"
+  if (location[1] != '/') {
+    prefixEnd = strchr(scheme + 3, '/');  // Keep "https://host" for "/path"
+    if (prefixEnd == nullptr) prefixEnd = url_ + strlen(url_);
+  }
+  size_t prefix = prefixEnd - url_;
+  if (prefix + len >= OTA_SESSION_URL_MAX) return false;
+  char joined[OTA_SESSION_URL_MAX];
+  memcpy(joined, url_, prefix);
+  memcpy(joined + prefix, location, len + 1);
+  copyUrl(url_, joined, prefix + len);
+  return true;
+}
+
+OtaSessionStep OtaSession::fail(OtaSessionError error) {
+  error_ = error;
+  return OTA_STEP_FAILED;
+}
+
+// Signed CDN redirects expire, so every retry starts again from the origin URL
+OtaSessionStep OtaSession::retry(OtaSessionError error) {
+  if (retries_ >= config_.maxRetries) return fail(error);
+  retries_++;
+  redirects_ = 0;
+  copyUrl(url_, origin_, strlen(origin_));
+  return OTA_STEP_RETRY;
+}
+
+uint32_t OtaSession::retryDelayMs() const {
+  if (retries_ == 0) return 0;
+  uint8_t shift = retries_ - 1 < 16 ? retries_ - 1 : 16;
+  uint64_t ms = (uint64_t)config_.backoffMs << shift;
+  return ms < config_.backoffMaxMs ? (uint32_t)ms : config_.backoffMaxMs;
+}
+
+OtaSessionStep OtaSession::response(int httpCode, long contentLength, const char *location,
+                                    const char *contentRange, bool chunked) {
+  requests_++;
+  httpCode_ = httpCode;
+
+  if (httpCode == 301 || httpCode == 302 || httpCode == 303 || httpCode == 307 || httpCode == 308) {
+    if (redirects_ >= OTA_SESSION_MAX_REDIRECTS || !setLocation(location)) return fail(OTA_SESSION_BAD_REDIRECT);
+    redirects_++;
+    return OTA_STEP_REQUEST;
+  }
+
+  // A resume must come back as 206 starting exactly where we stopped; a
+  // server that ignores Range (200) can't continue this Update session
+  bool resume = received_ > 0;
+  bool opened = httpCode == 200 && !resume;
+  if (resume && httpCode == 206 && contentRange != nullptr) {
+    char expect[24];
+    int n = snprintf(expect, sizeof(expect), "bytes %lu-", (unsigned long)received_);
+    opened = strncmp(contentRange, expect, n) == 0;
+  }
+  if (opened) {
+    if (!started_) {
+      started_ = true;
+      chunked_ = chunked;
+      total_ = chunked || contentLength < 0 ? -1 : contentLength;
+      chunks_.reset();
+    }
+    return OTA_STEP_STREAM;
+  }
+
+  if (httpCode < 0 || httpCode >= 500) return retry(OTA_SESSION_HTTP_ERROR);
+  return fail(resume && (httpCode == 200 || httpCode == 206) ? OTA_SESSION_RANGE_IGNORED : OTA_SESSION_HTTP_ERROR);
+}
+
+OtaSessionStep OtaSession::bodyEnd(OtaBodyEnd how, size_t bytes) {
+  if (!chunked_) received_ += bytes;
+  if (how == OTA_BODY_SINK_FAILED) {
+    return fail(chunked_ && chunks_.failed() ? OTA_SESSION_BAD_CHUNKING : OTA_SESSION_SINK_FAILED);
+  }
+
+  // Chunk framing offsets aren't image offsets, so a chunked body can't be
+  // resumed; the last-chunk marker is what says it's complete
+  if (chunked_) {
+    if (chunks_.done()) return OTA_STEP_DONE;
+    return fail(how == OTA_BODY_STALLED ? OTA_SESSION_STALLED : OTA_SESSION_TRUNCATED);
+  }
+
+  // Known length: anything short is resumed from received_ with a Range request
+  if (total_ >= 0) {
+    if (received_ == (size_t)total_) return OTA_STEP_DONE;
+    return retry(how == OTA_BODY_STALLED ? OTA_SESSION_STALLED : OTA_SESSION_TRUNCATED);
+  }
+
+  // No length: the server closing is the end. Truncation only shows up in
+  // the image checks (Update.end(), the inflater's SHA-256).
+  return how == OTA_BODY_STALLED ? fail(OTA_SESSION_STALLED) : OTA_STEP_DONE;
+}
+
+const char *otaSessionErrorName(OtaSessionError error) {
+  switch (error) {
+    case OTA_SESSION_OK: return "ok";
+    case OTA_SESSION_HTTP_ERROR: return "HTTP error";
+    case OTA_SESSION_BAD_REDIRECT: return "bad redirect";
+    case OTA_SESSION_RANGE_IGNORED: return "server ignored Range";
+    case OTA_SESSION_STALLED: return "stalled";
+    case OTA_SESSION_TRUNCATED: return "truncated";
+    case OTA_SESSION_BAD_CHUNKING: return "bad chunked framing";
+    case OTA_SESSION_SINK_FAILED: return "write failed";
+  }
+  return "unknown";
+}
@@ -0,0 +1,142 @@
+// ota_session.h - HTTP side of an OTA download: redirects, resume, chunked bodies
+//
+// The decisions githubOtaTask makes between network calls live here, apart
+// from HTTPClient and Update: whether a response can be streamed, where a
+// redirect goes, when a broken transfer is resumed with a Range request,
+// and whether the body that arrived is the whole image. The caller does the
+// I/O and reports back:
+//
+//   session.begin(url, config)
+//   loop:
+//     GET session.url()  (+ "Range: bytes=<rangeStart()>-" when non-zero)
+//     step = session.response(code, length, location, contentRange, chunked)
+//     STREAM  -> pump the body into the sink (through chunks() if chunked()),
+//                step = session.bodyEnd(how, bytes)
+//     REQUEST -> GET again right away (redirect)
+//     RETRY   -> wait retryDelayMs(), GET again
+//     DONE / FAILED -> stop; Update.end() or Update.abort()
+//
+// Plain C++ (no Arduino/ESP-IDF dependencies) so it also builds on the host;
+// see tools/ota_session_bench.cpp, driven by tools/ota_bench.py --host.
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define OTA_SESSION_URL_MAX 640        // GitHub's signed CDN redirects run ~550 chars
+#define OTA_SESSION_MAX_REDIRECTS 5
+
+// Consume `len` bytes; return how many were accepted (short = failure).
+typedef size_t (*OtaSinkFn)(uint8_t *data, size_t len);
+
+// "1.10.0" > "1.9.3". Missing fields count as 0; no "v" prefix.
+bool otaVersionIsNewer(const char *remote, const char *local);
+
+// Transfer-Encoding: chunked, decoded as the raw body streams past. Payload
+// spans are passed to the sink in place, without copying.
+class OtaChunkDecoder {
+ public:
+  void reset();
+  // Returns `len`, or 0 on bad framing or a short write by `out`.
+  size_t write(uint8_t *data, size_t len, OtaSinkFn out);
+
+  bool done() const { return state_ == DONE; }      // Zero-size last chunk and trailer seen
+  bool failed() const { return state_ == FAILED; }
+  size_t payloadBytes() const { return payload_; }
+
+ private:
+  enum State { SIZE, EXTENSION, SIZE_LF, DATA, DATA_CR, DATA_LF, TRAILER, TRAILER_LF, DONE, FAILED };
+  State state_ = SIZE;
+  uint32_t remaining_ = 0;  // Payload bytes left in the current chunk
+  uint8_t digits_ = 0;
+  bool lineEmpty_ = true;   // Trailer: current line has no characters yet
+  size_t payload_ = 0;
+};
+
+enum OtaSessionStep {
+  OTA_STEP_STREAM,   // Response accepted: stream its body, then call bodyEnd()
+  OTA_STEP_REQUEST,  // Request url() now (redirect)
+  OTA_STEP_RETRY,    // Request url() again after retryDelayMs()
+  OTA_STEP_DONE,     // The whole image has been passed to the sink
+  OTA_STEP_FAILED,
+};
+
+// How a response body ended, as seen by the code pumping it.
+enum OtaBodyEnd {
+  OTA_BODY_OK,            // Content-Length bytes read, or the server closed a body without one
+  OTA_BODY_STALLED,       // No data for the stall timeout
+  OTA_BODY_DISCONNECTED,  // Closed before Content-Length bytes
+  OTA_BODY_SINK_FAILED,   // Sink refused data (flash, inflate, chunk framing) or out of memory
+};
+
+enum OtaSessionError {
+  OTA_SESSION_OK,
+  OTA_SESSION_HTTP_ERROR,      // Unexpected status, or retries used up on 5xx / connect errors
+  OTA_SESSION_BAD_REDIRECT,    // Too many redirects, or no usable Location
+  OTA_SESSION_RANGE_IGNORED,   // Resume answered without the requested Content-Range
+  OTA_SESSION_STALLED,         // Retries used up on a stalled transfer
+  OTA_SESSION_TRUNCATED,       // Body ended early and couldn't be resumed
+  OTA_SESSION_BAD_CHUNKING,    // Malformed chunked framing
+  OTA_SESSION_SINK_FAILED,
+};
+
+struct OtaSessionConfig {
+  uint8_t maxRetries;     // Resumes / 5xx retries per download
+  uint32_t backoffMs;     // First retry delay; doubles per retry
+  uint32_t backoffMaxMs;
+};
+
+class OtaSession {
+ public:
+  void begin(const char *url, const OtaSessionConfig &config);
+
+  // Next request: URL and Range start (0 = whole file).
+  const char *url() const { return url_; }
+  size_t rangeStart() const { return received_; }
+
+  // Status line and headers of the response. contentLength < 0 = not sent;
+  // location / contentRange may be nullptr or "".
+  OtaSessionStep response(int httpCode, long contentLength, const char *location, const char *contentRange,
+                          bool chunked);
+
+  // The body of a STREAM response ended; `bytes` were accepted by the sink.
+  OtaSessionStep bodyEnd(OtaBodyEnd how, size_t bytes);
+
+  // True from the first STREAM response on; the caller opens Update then.
+  bool started() const { return started_; }
+  // Whole image length from the first response (-1 = unknown).
+  long totalLength() const { return total_; }
+  bool chunked() const { return chunked_; }
+  OtaChunkDecoder &chunks() { return chunks_; }
+
+  // Image bytes received so far (chunked: payload, not framing).
+  size_t received() const { return chunked_ ? chunks_.payloadBytes() : received_; }
+  uint8_t retries() const { return retries_; }
+  uint8_t redirects() const { return redirects_; }
+  uint8_t requests() const { return requests_; }
+  uint32_t retryDelayMs() const;
+  int httpCode() const { return httpCode_; }
+  OtaSessionError error() const { return error_; }
+
+ private:
+  OtaSessionStep fail(OtaSessionError error);
+  OtaSessionStep retry(OtaSessionError error);
+  bool setLocation(const char *location);
+
+  OtaSessionConfig config_ = {};
+  char origin_[OTA_SESSION_URL_MAX] = {};
+  char url_[OTA_SESSION_URL_MAX] = {};
+  OtaChunkDecoder chunks_;
+  bool started_ = false;
+  bool chunked_ = false;
+  long total_ = -1;
+  size_t received_ = 0;
+  uint8_t retries_ = 0;
+  uint8_t redirects_ = 0;
+  uint8_t requests_ = 0;
+  int httpCode_ = 0;
+  OtaSessionError error_ = OTA_SESSION_OK;
+};
+
+const char *otaSessionErrorName(OtaSessionError error);
@@ -0,0 +1,295 @@
+// ota_upload.cpp - Browser firmware upload on the async web server (see ota_upload.h)
+//
+// One upload at a time. The AsyncTCP task owns the request and only copies
+// body bytes into the stream buffer; the writer task owns Update and the
+// inflater from Update.begin() to Update.end(). The stream buffer has one
+// sender and one receiver, which is all FreeRTOS stream buffers allow.
+//
+// Nothing on the AsyncTCP task waits. Received bytes are acknowledged by hand
+// (AsyncClient::ackLater()): the parser acknowledges while the buffer has
+// OTA_UPLOAD_ACK_RESERVE free, otherwise the writer does once it has drained
+// that much. The client pointer is shared with the writer under clientLock,
+// and cleared by the disconnect handler before AsyncTCP frees it.
+
+#include "ota_upload.h"
+#include "ota_inflate.h"
+
+#include <AsyncTCP.h>
+#include <ESPAsyncWebServer.h>
+#include <Update.h>
+#include <esp_heap_caps.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/stream_buffer.h>
+
+#define POLL_MS 100  // Writer re-checks the flags this often while waiting
+
+struct OtaUploadState {
+  AsyncWebServerRequest *owner;  // Request whose file is being written
+  AsyncClient *client;           // Its connection, for acks from the writer (clientLock)
+  volatile bool writerRunning;   // Set before the writer is created, cleared as its last act
+  volatile bool ackPending;      // Bytes held back until the buffer has room again
+  volatile bool inputDone;       // Parser has sent the last byte
+  volatile bool abortRequested;  // Browser went away, or the parser gave up
+  volatile bool failed;          // Result is final; further data is dropped
+  OtaUploadResult result;
+  size_t received;
+  size_t written;
+  bool compressed;
+  uint32_t startMs;
+  uint32_t finishStartMs;        // Body complete; the response waits for the writer
+};
+
+static std::atomic<bool> *busy = nullptr;
+static OtaUploadState u = {};
+static portMUX_TYPE resultMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Allocated on the first upload and kept; a failed upload may still have a
+// writer draining into them when the next request arrives
+static StreamBufferHandle_t buffer = nullptr;
+static StaticStreamBuffer_t bufferStruct;
+static SemaphoreHandle_t clientLock = nullptr;
+static esp_timer_handle_t rebootTimer = nullptr;
+static String resultPage;  // Built once the writer is done, then streamed out
+
+static const char *PAGE_OK =
+  "<html><body style='background:#0D1117;color:#00E676;text-align:center;padding:50px'><h1>Success! Rebooting...</h1></body></html>";
+static const char *PAGE_FAIL_HEAD =
+  "<html><body style='background:#0D1117;color:#FF5252;text-align:center;padding:50px'><h1>Failed!</h1><p>";
+static const char *PAGE_FAIL_TAIL = "</p></body></html>";
+
+// First failure wins; later ones are consequences of it
+static void fail(OtaUploadResult result) {
+  portENTER_CRITICAL(&resultMux);
+  if (!u.failed) {
+    u.result = result;
+    u.failed = true;
+  }
+  portEXIT_CRITICAL(&resultMux);
+}
+
+static void rebootNow(void *arg) {
+  ESP.restart();
+}
+
+// Release every byte AsyncTCP is holding back, reopening the browser's window.
+// AsyncTCP counts a segment as held only after the upload callback returns,
+// so an ack from inside it releases the earlier ones; the next ack gets it.
+static void ackHeld() {
+  xSemaphoreTake(clientLock, portMAX_DELAY);
+  if (u.client != nullptr) u.client->ack(SIZE_MAX);
+  xSemaphoreGive(clientLock);
+  u.ackPending = false;
+}
+
+static bool bufferHasRoom() {
+  return xStreamBufferSpacesAvailable(buffer) >= OTA_UPLOAD_ACK_RESERVE;
+}
+
+static void writerTask(void *pv) {
+  uint8_t *chunk = (uint8_t *)malloc(OTA_UPLOAD_WRITE_CHUNK);
+  bool started = false;
+  if (chunk == nullptr) {
+    fail(OTA_UPLOAD_NO_MEMORY);
+  } else if (!Update.begin(UPDATE_SIZE_UNKNOWN)) {
+    Update.printError(Serial);
+    fail(OTA_UPLOAD_BEGIN_FAILED);
+  }
+
+  while (!u.failed) {
+    if (u.abortRequested) {
+      fail(OTA_UPLOAD_ABORTED);
+      break;
+    }
+    size_t n = xStreamBufferReceive(buffer, chunk, OTA_UPLOAD_WRITE_CHUNK, pdMS_TO_TICKS(POLL_MS));
+    if (u.ackPending && bufferHasRoom()) ackHeld();
+    if (n == 0) {
+      // inputDone is set after the parser's last send, so empty now means empty for good
+      if (u.inputDone && xStreamBufferIsEmpty(buffer)) break;
+      continue;
+    }
+    if (!started) {
+      started = true;
+      u.compressed = otaInflateIsCompressed(chunk, n);
+      if (u.compressed && !otaInflateBegin(nullptr)) {
+        fail(OTA_UPLOAD_NO_MEMORY);
+        break;
+      }
+    }
+    size_t accepted = u.compressed ? otaInflateWrite(chunk, n) : Update.write(chunk, n);
+    if (accepted != n) {
+      Update.printError(Serial);
+      fail(OTA_UPLOAD_WRITE_FAILED);
+      break;
+    }
+    u.written += n;
+  }
+
+  if (!u.failed && u.compressed) {
+    OtaInflateResult zResult = otaInflateEnd();
+    if (zResult != OTA_Z_OK) {
+      Serial.printf("[OTA upload] Inflate failed: %s\n", otaInflateResultName(zResult));
+      fail(OTA_UPLOAD_VERIFY_FAILED);
+    }
+  }
+  if (!u.failed) {
+    if (Update.end(true)) {
+      Serial.printf("[OTA upload] Done: %u bytes%s in %lu ms\n", (unsigned)u.written,
+                    u.compressed ? " (compressed)" : "", (unsigned long)(millis() - u.startMs));
+    } else {
+      Update.printError(Serial);
+      fail(OTA_UPLOAD_VERIFY_FAILED);
+    }
+  }
+  if (u.failed) {
+    if (u.compressed) otaInflateAbort();
+    Update.abort();
+    Serial.printf("[OTA upload] Failed at %u bytes: %s\n", (unsigned)u.written, otaUploadResultName(u.result));
+    if (u.ackPending) ackHeld();  // Let the browser finish sending so it sees the error page
+    *busy = false;
+  }
+  free(chunk);
+  u.writerRunning = false;
+  vTaskDelete(nullptr);
+}
+
+// Runs on the AsyncTCP task when the browser disconnects (also after a
+// normal response, when the request is already released)
+static void uploadDisconnected(AsyncWebServerRequest *request) {
+  if (request != u.owner) return;
+  xSemaphoreTake(clientLock, portMAX_DELAY);
+  u.client = nullptr;
+  xSemaphoreGive(clientLock);
+  u.owner = nullptr;
+  u.abortRequested = true;
+}
+
+static bool start(AsyncWebServerRequest *request, const String &filename) {
+  if (u.owner != nullptr || u.writerRunning) return false;
+  bool idle = false;
+  if (!busy->compare_exchange_strong(idle, true)) return false;  // Another update claimed it first
+  if (buffer == nullptr) {
+    uint8_t *storage = (uint8_t *)heap_caps_malloc(OTA_UPLOAD_BUFFER + 1, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (storage == nullptr) storage = (uint8_t *)malloc(OTA_UPLOAD_BUFFER + 1);
+    if (storage != nullptr) {
+      buffer = xStreamBufferCreateStatic(OTA_UPLOAD_BUFFER, OTA_UPLOAD_WRITE_CHUNK, storage, &bufferStruct);
+    }
+  }
+
+  u = {};
+  u.owner = request;
+  u.client = request->client();
+  u.startMs = millis();
+  request->onDisconnect([request]() { uploadDisconnected(request); });
+  Serial.printf("[OTA upload] Start: %s\n", filename.c_str());
+
+  if (buffer == nullptr) {
+    fail(OTA_UPLOAD_NO_MEMORY);
+    *busy = false;
+    return true;
+  }
+  xStreamBufferReset(buffer);
+  u.client->ackLater();  // From here on, feed() and the writer decide when to ack
+  u.writerRunning = true;
+  if (xTaskCreatePinnedToCore(writerTask, "ota_upload", 6144, nullptr, 3, nullptr, tskNO_AFFINITY) != pdPASS) {
+    u.writerRunning = false;
+    fail(OTA_UPLOAD_NO_MEMORY);
+    *busy = false;
+  }
+  return true;
+}
+
+// Copy into the stream buffer without waiting. Whatever the browser can
+// still send unacknowledged is bounded by the TCP window, which
+// OTA_UPLOAD_ACK_RESERVE covers; if it doesn't fit anyway, the writer has
+// stopped draining.
+static void feed(uint8_t *data, size_t len) {
+  size_t sent = xStreamBufferSend(buffer, data, len, 0);
+  if (sent < len) {
+    fail(OTA_UPLOAD_STALLED);
+    u.abortRequested = true;
+    return;
+  }
+  u.received += len;
+}
+
+static void onUpload(AsyncWebServerRequest *request, const String &filename, size_t index, uint8_t *data, size_t len,
+                     bool final) {
+  if (index == 0 && !start(request, filename)) return;  // onRequest answers 409
+  if (request != u.owner) return;
+  if (!u.failed && len > 0) feed(data, len);
+  if (final) u.inputDone = true;
+  // After a failure the rest of the body is read and dropped
+  if (u.failed || final || bufferHasRoom()) {
+    ackHeld();
+  } else {
+    u.ackPending = true;  // The writer acks once it has made room
+  }
+}
+
+// Response body filler: wait (RESPONSE_TRY_AGAIN) for the writer's last
+// sector writes and Update.end()'s image check, then stream the result page
+static size_t fillResult(uint8_t *buf, size_t maxLen, size_t index) {
+  if (index == 0 && resultPage.length() == 0) {
+    if (u.writerRunning && millis() - u.finishStartMs < OTA_UPLOAD_FINISH_MS) return RESPONSE_TRY_AGAIN;
+    if (u.writerRunning) {
+      fail(OTA_UPLOAD_STALLED);
+      u.abortRequested = true;
+    }
+    u.owner = nullptr;
+    if (u.failed) {
+      resultPage = String(PAGE_FAIL_HEAD) + otaUploadResultName(u.result) + PAGE_FAIL_TAIL;
+    } else {
+      resultPage = PAGE_OK;
+      if (rebootTimer == nullptr) {
+        esp_timer_create_args_t args = {};
+        args.callback = rebootNow;
+        args.name = "ota_reboot";
+        esp_timer_create(&args, &rebootTimer);
+      }
+      if (rebootTimer != nullptr) esp_timer_start_once(rebootTimer, OTA_UPLOAD_REBOOT_DELAY_MS * 1000ULL);
+    }
+  }
+  if (index >= resultPage.length()) return 0;
+  size_t n = min(maxLen, resultPage.length() - index);
+  memcpy(buf, resultPage.c_str() + index, n);
+  return n;
+}
+
+static void onRequest(AsyncWebServerRequest *request) {
+  if (request != u.owner) {
+    bool inUse = *busy || u.writerRunning;
+    request->send(inUse ? 409 : 400, "text/plain", inUse ? "Update already in progress" : "No firmware file");
+    return;
+  }
+  if (u.failed && !u.writerRunning) {
+    u.owner = nullptr;
+    request->send(500, "text/html", String(PAGE_FAIL_HEAD) + otaUploadResultName(u.result) + PAGE_FAIL_TAIL);
+    return;
+  }
+  // The writer may still be finishing; the page says how it went (the status
+  // line has to go out first, so it is 200 either way)
+  u.finishStartMs = millis();
+  resultPage = "";
+  request->send(request->beginChunkedResponse("text/html", fillResult));
+}
+
+void otaUploadAttach(AsyncWebServer &server, std::atomic<bool> &otaBusy) {
+  busy = &otaBusy;
+  clientLock = xSemaphoreCreateMutex();
+  server.on(OTA_UPLOAD_PATH, HTTP_POST, onRequest, onUpload);
+}
+
+const char *otaUploadResultName(OtaUploadResult result) {
+  switch (result) {
+    case OTA_UPLOAD_OK: return "ok";
+    case OTA_UPLOAD_NO_MEMORY: return "out of memory";
+    case OTA_UPLOAD_BEGIN_FAILED: return "Update.begin failed";
+    case OTA_UPLOAD_WRITE_FAILED: return "flash write failed";
+    case OTA_UPLOAD_STALLED: return "flash writes stalled";
+    case OTA_UPLOAD_ABORTED: return "upload aborted";
+    case OTA_UPLOAD_VERIFY_FAILED: return "image verification failed";
+  }
+  return "unknown";
+}
@@ -0,0 +1,51 @@
+// ota_upload.h - Browser firmware upload on the async web server
+//
+// The upload used to run inside the synchronous WebServer, serviced from
+// loop(): while a browser pushed the image, quotes and the clock stopped,
+// and a slow quote fetch starved the upload. Here the POST is handled by
+// ESPAsyncWebServer on the AsyncTCP task, and flash writes happen on a
+// writer task of their own:
+//
+//   async_tcp (multipart parser) --copy--> [ PSRAM stream buffer ] --> writer task --> Update / inflater
+//
+// The upload callback only copies, and never waits. When flash falls behind
+// and the buffer runs low, received segments are left unacknowledged
+// (AsyncClient::ackLater()) until the writer has drained enough, so the
+// browser's TCP window closes and the sender slows to the flash write rate
+// instead of data piling up in RAM. The response likewise polls for the
+// writer's result instead of waiting for it.
+//
+// Accepts plain firmware.bin or firmware.bin.z (ota_inflate.h), like before.
+
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+
+class AsyncWebServer;
+
+#define OTA_UPLOAD_PATH "/update"
+#define OTA_UPLOAD_BUFFER 65536          // Stream buffer between the parser and the writer (PSRAM)
+#define OTA_UPLOAD_WRITE_CHUNK 4096      // Bytes per Update.write() (one flash sector)
+#define OTA_UPLOAD_ACK_RESERVE 32768     // Ack only while this much buffer is free (well above the TCP window)
+#define OTA_UPLOAD_FINISH_MS 20000       // Wait for the last writes and Update.end() before giving up
+#define OTA_UPLOAD_REBOOT_DELAY_MS 1000  // Let the success page go out first
+
+enum OtaUploadResult {
+  OTA_UPLOAD_OK,
+  OTA_UPLOAD_NO_MEMORY,
+  OTA_UPLOAD_BEGIN_FAILED,  // Update.begin() refused
+  OTA_UPLOAD_WRITE_FAILED,  // Flash write or inflate error
+  OTA_UPLOAD_STALLED,       // Writer stopped draining the buffer, or didn't finish in time
+  OTA_UPLOAD_ABORTED,       // Browser disconnected mid-upload
+  OTA_UPLOAD_VERIFY_FAILED, // Inflate trailer or Update.end() rejected the image
+};
+
+// Register POST OTA_UPLOAD_PATH on `server` (before server.begin()). `otaBusy`
+// is the app-wide "an update is running" flag: uploads are refused while it's
+// set, and it stays set from the first byte until the upload fails or the
+// device reboots. An upload claims it with a compare-and-swap, so it can't
+// race another task starting an update.
+void otaUploadAttach(AsyncWebServer &server, std::atomic<bool> &otaBusy);
+
+const char *otaUploadResultName(OtaUploadResult result);
@@ -0,0 +1,46 @@
+// p2p_wire.cpp - v2 (MessagePack) quote encoding (see p2p_wire.h)
+
+#include "p2p_wire.h"
+
+#include <string.h>
+
+void p2pWireEncodeQuote(JsonArray out, const PeerQuote &quote, bool includeName) {
+  out.add(quote.symbol);
+  out.add(quote.timestamp);
+  out.add(quote.price);
+  out.add(quote.prevClose);
+  out.add(quote.open);
+  out.add(quote.high);
+  out.add(quote.low);
+  out.add(quote.volume);
+  out.add(quote.fiftyTwoLow);
+  out.add(quote.fiftyTwoHigh);
+  out.add(quote.oneMonthLow);
+  out.add(quote.oneMonthHigh);
+  out.add(quote.marketOpen ? PQ_FLAG_MARKET_OPEN : 0);
+  if (includeName && quote.name[0]) out.add(quote.name);
+}
+
+bool p2pWireDecodeQuote(JsonArrayConst in, PeerQuote &quote) {
+  memset(&quote, 0, sizeof(quote));
+  if (in.isNull() || in.size() <= PQ_FLAGS) return false;
+
+  const char *symbol = in[PQ_SYMBOL] | "";
+  if (symbol[0] == '\0') return false;
+  strncpy(quote.symbol, symbol, sizeof(quote.symbol) - 1);
+  quote.timestamp = in[PQ_TIMESTAMP] | 0u;
+  quote.price = in[PQ_PRICE] | 0.0f;
+  quote.prevClose = in[PQ_PREV_CLOSE] | 0.0f;
+  quote.open = in[PQ_OPEN] | 0.0f;
+  quote.high = in[PQ_HIGH] | 0.0f;
+  quote.low = in[PQ_LOW] | 0.0f;
+  quote.volume = in[PQ_VOLUME] | 0.0f;
+  quote.fiftyTwoLow = in[PQ_52W_LOW] | 0.0f;
+  quote.fiftyTwoHigh = in[PQ_52W_HIGH] | 0.0f;
+  quote.oneMonthLow = in[PQ_1M_LOW] | 0.0f;
+  quote.oneMonthHigh = in[PQ_1M_HIGH] | 0.0f;
+  quote.marketOpen = ((in[PQ_FLAGS] | 0) & PQ_FLAG_MARKET_OPEN) != 0;
+  const char *name = in[PQ_NAME] | "";
+  strncpy(quote.name, name, sizeof(quote.name) - 1);
+  return quote.price > 0;
+}
@@ -0,0 +1,62 @@
+// p2p_wire.h - Versioned P2P wire schema shared by the registry client and LAN peers
+//
+// Version 1 is the original JSON format: display strings such as "$485.92" and
+// "Vol: 70.82M" that receivers had to string-parse. Version 2 is MessagePack
+// with numeric fields and epoch timestamps. A quote is a positional array, so
+// decoding is a fixed sequence of reads with no key lookups and no text parsing.
+//
+// The registry advertises the versions it accepts in its /register response;
+// the client falls back to version 1 if it advertises none.
+//
+// Bulk lookups (GET /stocks?symbols=A,B,C, v2 only) answer with a header map
+// {"v":2,"n":count} followed by `count` quote arrays in the same stream, so a
+// receiver can decode and store one quote at a time.
+
+#pragma once
+
+#include <ArduinoJson.h>
+
+#define P2P_WIRE_V1_JSON 1
+#define P2P_WIRE_V2_MSGPACK 2
+#define P2P_WIRE_LATEST P2P_WIRE_V2_MSGPACK
+#define P2P_WIRE_MSGPACK_TYPE "application/msgpack"
+
+// A quote in numeric form, as exchanged between devices.
+struct PeerQuote {
+  char symbol[12];
+  char name[44];
+  float price;
+  float prevClose;
+  float open;
+  float high;
+  float low;
+  float volume;
+  float fiftyTwoLow;
+  float fiftyTwoHigh;
+  float oneMonthLow;
+  float oneMonthHigh;
+  bool marketOpen;
+  uint32_t timestamp;  // Epoch seconds when the quote was fetched from an API
+};
+
+// Positional layout of a v2 quote array. New fields are only ever appended;
+// decoders ignore trailing elements they don't know and default missing ones.
+static const size_t PQ_SYMBOL = 0;
+static const size_t PQ_TIMESTAMP = 1;
+static const size_t PQ_PRICE = 2;
+static const size_t PQ_PREV_CLOSE = 3;
+static const size_t PQ_OPEN = 4;
+static const size_t PQ_HIGH = 5;
+static const size_t PQ_LOW = 6;
+static const size_t PQ_VOLUME = 7;
+static const size_t PQ_52W_LOW = 8;
+static const size_t PQ_52W_HIGH = 9;
+static const size_t PQ_1M_LOW = 10;
+static const size_t PQ_1M_HIGH = 11;
+static const size_t PQ_FLAGS = 12;  // bit 0: market open
+static const size_t PQ_NAME = 13;   // Omitted only when the sender has no name
+
+#define PQ_FLAG_MARKET_OPEN 0x01
+
+void p2pWireEncodeQuote(JsonArray out, const PeerQuote &quote, bool includeName);
+bool p2pWireDecodeQuote(JsonArrayConst in, PeerQuote &quote);
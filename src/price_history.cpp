@@ -0,0 +1,284 @@
+// price_history.cpp - Gorilla-style time-series codec (see price_history.h)
+
+#include "price_history.h"
+
+#include <string.h>
+
+// Worst case per point: 4+32 timestamp bits + 2+5+5+32 value bits.
+static const size_t MAX_POINT_BITS = 80;
+static const uint8_t HEADER_BITS = 64;  // First point: raw 32-bit timestamp + raw float
+
+static inline uint32_t floatBits(float f) {
+  uint32_t u;
+  memcpy(&u, &f, sizeof(u));
+  return u;
+}
+
+static inline float bitsFloat(uint32_t u) {
+  float f;
+  memcpy(&f, &u, sizeof(f));
+  return f;
+}
+
+static inline uint32_t zigzag(int32_t v) {
+  return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static inline int32_t unzigzag(uint32_t v) {
+  return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+static inline uint8_t leadingZeros(uint32_t v) {
+  return v ? (uint8_t)__builtin_clz(v) : 32;
+}
+
+static inline uint8_t trailingZeros(uint32_t v) {
+  return v ? (uint8_t)__builtin_ctz(v) : 32;
+}
+
+// ---------------------------------------------------------------------------
+// Encoder
+// ---------------------------------------------------------------------------
+
+void PriceHistoryEncoder::begin(uint8_t *buf, size_t capacity) {
+  buf_ = buf;
+  capacityBits_ = capacity * 8;
+  bitPos_ = 0;
+  count_ = 0;
+  prevTs_ = 0;
+  prevDelta_ = 0;
+  prevBits_ = 0;
+  prevLeading_ = 0xFF;
+  prevTrailing_ = 0;
+  if (buf_) memset(buf_, 0, capacity);
+}
+
+void PriceHistoryEncoder::writeBits(uint32_t value, uint8_t nbits) {
+  // MSB-first bit packing; buffer was zeroed in begin() so only set bits need writing.
+  while (nbits > 0) {
+    size_t byteIdx = bitPos_ >> 3;
+    uint8_t bitOff = bitPos_ & 7;
+    uint8_t room = 8 - bitOff;
+    uint8_t take = nbits < room ? nbits : room;
+    uint8_t chunk = (uint8_t)((value >> (nbits - take)) & ((1u << take) - 1));
+    buf_[byteIdx] |= (uint8_t)(chunk << (room - take));
+    bitPos_ += take;
+    nbits -= take;
+  }
+}
+
+bool PriceHistoryEncoder::append(uint32_t timestamp, float price) {
+  if (buf_ == nullptr || count_ == UINT16_MAX) return false;
+  const uint32_t bits = floatBits(price);
+
+  if (count_ == 0) {
+    if (capacityBits_ < HEADER_BITS) return false;
+    writeBits(timestamp, 32);
+    writeBits(bits, 32);
+    prevTs_ = timestamp;
+    prevBits_ = bits;
+    count_ = 1;
+    return true;
+  }
+
+  if (timestamp < prevTs_) return false;  // Series must be monotonic
+  if (capacityBits_ - bitPos_ < MAX_POINT_BITS) return false;
+
+  // Timestamp: delta-of-delta, zig-zag, variable-width buckets.
+  const int32_t delta = (int32_t)(timestamp - prevTs_);
+  const uint32_t zz = zigzag(delta - prevDelta_);
+  if (zz == 0) {
+    writeBits(0x0, 1);
+  } else if (zz < (1u << 7)) {
+    writeBits(0x2, 2);
+    writeBits(zz, 7);
+  } else if (zz < (1u << 9)) {
+    writeBits(0x6, 3);
+    writeBits(zz, 9);
+  } else if (zz < (1u << 12)) {
+    writeBits(0xE, 4);
+    writeBits(zz, 12);
+  } else {
+    writeBits(0xF, 4);
+    writeBits(zz, 32);
+  }
+  prevDelta_ = delta;
+  prevTs_ = timestamp;
+
+  // Price: XOR with previous float; reuse the previous meaningful-bit window when it fits.
+  const uint32_t x = bits ^ prevBits_;
+  if (x == 0) {
+    writeBits(0x0, 1);
+  } else {
+    uint8_t lead = leadingZeros(x);
+    uint8_t trail = trailingZeros(x);
+    if (lead > 31) lead = 31;
+    if (prevLeading_ != 0xFF && lead >= prevLeading_ && trail >= prevTrailing_) {
+      writeBits(0x2, 2);
+      uint8_t len = 32 - prevLeading_ - prevTrailing_;
+      writeBits(x >> prevTrailing_, len);
+    } else {
+      uint8_t len = 32 - lead - trail;
+      writeBits(0x3, 2);
+      writeBits(lead, 5);
+      writeBits(len - 1, 5);
+      writeBits(x >> trail, len);
+      prevLeading_ = lead;
+      prevTrailing_ = trail;
+    }
+  }
+  prevBits_ = bits;
+  count_++;
+  return true;
+}
+
+// ---------------------------------------------------------------------------
+// Decoder
+// ---------------------------------------------------------------------------
+
+PriceHistoryDecoder::PriceHistoryDecoder(const uint8_t *buf, size_t bitLength, uint16_t count)
+  : buf_(buf), bitLength_(bitLength), remaining_(count) {}
+
+bool PriceHistoryDecoder::readBits(uint8_t nbits, uint32_t &out) {
+  if (bitPos_ + nbits > bitLength_) return false;
+  uint32_t v = 0;
+  while (nbits > 0) {
+    size_t byteIdx = bitPos_ >> 3;
+    uint8_t bitOff = bitPos_ & 7;
+    uint8_t room = 8 - bitOff;
+    uint8_t take = nbits < room ? nbits : room;
+    uint8_t chunk = (uint8_t)((buf_[byteIdx] >> (room - take)) & ((1u << take) - 1));
+    v = (v << take) | chunk;
+    bitPos_ += take;
+    nbits -= take;
+  }
+  out = v;
+  return true;
+}
+
+bool PriceHistoryDecoder::next(uint32_t &timestamp, float &price) {
+  if (remaining_ == 0) return false;
+  uint32_t v;
+
+  if (index_ == 0) {
+    uint32_t ts, bits;
+    if (!readBits(32, ts) || !readBits(32, bits)) return false;
+    prevTs_ = ts;
+    prevBits_ = bits;
+  } else {
+    // Timestamp bucket prefix: 0 / 10 / 110 / 1110 / 1111
+    uint8_t ones = 0;
+    while (ones < 4) {
+      if (!readBits(1, v)) return false;
+      if (v == 0) break;
+      ones++;
+    }
+    uint32_t zz = 0;
+    static const uint8_t widths[] = {0, 7, 9, 12, 32};
+    if (ones > 0 && !readBits(widths[ones], zz)) return false;
+    prevDelta_ += unzigzag(zz);
+    prevTs_ += (uint32_t)prevDelta_;
+
+    if (!readBits(1, v)) return false;
+    if (v == 1) {
+      uint32_t reuse;
+      if (!readBits(1, reuse)) return false;
+      if (reuse == 1) {
+        uint32_t lead, lenMinus1;
+        if (!readBits(5, lead) || !readBits(5, lenMinus1)) return false;
+        prevLeading_ = (uint8_t)lead;
+        prevTrailing_ = (uint8_t)(32 - lead - (lenMinus1 + 1));
+      }
+      uint8_t len = 32 - prevLeading_ - prevTrailing_;
+      uint32_t meaningful;
+      if (!readBits(len, meaningful)) return false;
+      prevBits_ ^= (meaningful << prevTrailing_);
+    }
+  }
+
+  timestamp = prevTs_;
+  price = bitsFloat(prevBits_);
+  index_++;
+  remaining_--;
+  return true;
+}
+
+// ---------------------------------------------------------------------------
+// Series (ring of blocks)
+// ---------------------------------------------------------------------------
+
+void PriceSeries::init(size_t blockBytes, size_t maxBlocks, AllocFn alloc, FreeFn release) {
+  clear();
+  blockBytes_ = blockBytes;
+  maxBlocks_ = maxBlocks < MAX_BLOCKS ? maxBlocks : MAX_BLOCKS;
+  alloc_ = alloc;
+  free_ = release;
+}
+
+void PriceSeries::clear() {
+  for (size_t i = 0; i < MAX_BLOCKS; i++) {
+    if (blocks_[i].data && free_) free_(blocks_[i].data);
+    blocks_[i] = Block();
+  }
+  firstBlock_ = 0;
+  numBlocks_ = 0;
+  encOpen_ = false;
+  lastTs_ = 0;
+}
+
+void PriceSeries::sealBlock() {
+  if (!encOpen_ || numBlocks_ == 0) return;
+  Block &b = blocks_[(firstBlock_ + numBlocks_ - 1) % MAX_BLOCKS];
+  b.bits = enc_.bitLength();
+  b.count = enc_.count();
+}
+
+bool PriceSeries::openBlock() {
+  if (alloc_ == nullptr || maxBlocks_ == 0) return false;
+  sealBlock();
+
+  uint8_t *data = nullptr;
+  if (numBlocks_ == maxBlocks_) {
+    // Recycle the oldest block's buffer for the newest data.
+    Block &oldest = blocks_[firstBlock_];
+    data = oldest.data;
+    oldest = Block();
+    firstBlock_ = (firstBlock_ + 1) % MAX_BLOCKS;
+    numBlocks_--;
+    evicted_++;
+  } else {
+    data = static_cast<uint8_t *>(alloc_(blockBytes_));
+    if (data == nullptr) return false;
+  }
+
+  Block &b = blocks_[(firstBlock_ + numBlocks_) % MAX_BLOCKS];
+  b.data = data;
+  b.bits = 0;
+  b.count = 0;
+  numBlocks_++;
+  enc_.begin(data, blockBytes_);
+  encOpen_ = true;
+  return true;
+}
+
+bool PriceSeries::append(uint32_t timestamp, float price) {
+  if (numBlocks_ > 0 && timestamp < lastTs_) return false;
+  if (!encOpen_ || !enc_.append(timestamp, price)) {
+    if (!openBlock() || !enc_.append(timestamp, price)) return false;
+  }
+  lastTs_ = timestamp;
+  sealBlock();  // Keep the open block's length/count visible to readers
+  return true;
+}
+
+size_t PriceSeries::count() const {
+  size_t n = 0;
+  for (size_t i = 0; i < numBlocks_; i++) n += blocks_[(firstBlock_ + i) % MAX_BLOCKS].count;
+  return n;
+}
+
+size_t PriceSeries::bytesUsed() const {
+  size_t n = 0;
+  for (size_t i = 0; i < numBlocks_; i++) n += (blocks_[(firstBlock_ + i) % MAX_BLOCKS].bits + 7) / 8;
+  return n;
+}
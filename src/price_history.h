@@ -0,0 +1,115 @@
+// price_history.h - Compressed on-device price history (Gorilla-style)
+//
+// Timestamps are stored as zig-zag encoded delta-of-deltas and prices as the
+// XOR of consecutive IEEE-754 floats with a leading/trailing-zero window, as in
+// Facebook's Gorilla TSDB. Regular one-minute ticks cost ~1 bit for the time
+// and a handful of bits for a slowly moving price, versus 8 bytes raw.
+//
+// Plain C++ (no Arduino/ESP-IDF dependencies) so it also builds on the host;
+// see tools/price_history_bench.cpp.
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Streaming encoder over one caller-owned block. append() returns false when the
+// block can't be guaranteed to fit another point; start a new block then.
+class PriceHistoryEncoder {
+ public:
+  void begin(uint8_t *buf, size_t capacity);
+  bool append(uint32_t timestamp, float price);
+
+  uint16_t count() const { return count_; }
+  size_t bitLength() const { return bitPos_; }
+  size_t bytesUsed() const { return (bitPos_ + 7) / 8; }
+  uint32_t lastTimestamp() const { return prevTs_; }
+
+ private:
+  void writeBits(uint32_t value, uint8_t nbits);
+
+  uint8_t *buf_ = nullptr;
+  size_t capacityBits_ = 0;
+  size_t bitPos_ = 0;
+  uint16_t count_ = 0;
+  uint32_t prevTs_ = 0;
+  int32_t prevDelta_ = 0;
+  uint32_t prevBits_ = 0;
+  uint8_t prevLeading_ = 0xFF;  // 0xFF = no XOR window yet
+  uint8_t prevTrailing_ = 0;
+};
+
+// Streaming decoder over one encoded block.
+class PriceHistoryDecoder {
+ public:
+  PriceHistoryDecoder(const uint8_t *buf, size_t bitLength, uint16_t count);
+  bool next(uint32_t &timestamp, float &price);
+
+ private:
+  bool readBits(uint8_t nbits, uint32_t &out);
+
+  const uint8_t *buf_;
+  size_t bitLength_;
+  size_t bitPos_ = 0;
+  uint16_t remaining_;
+  uint16_t index_ = 0;
+  uint32_t prevTs_ = 0;
+  int32_t prevDelta_ = 0;
+  uint32_t prevBits_ = 0;
+  uint8_t prevLeading_ = 0;
+  uint8_t prevTrailing_ = 0;
+};
+
+// A per-symbol series: a ring of fixed-size encoded blocks. When maxBlocks is
+// reached the oldest block is recycled, so memory is bounded and history rolls.
+class PriceSeries {
+ public:
+  typedef void *(*AllocFn)(size_t);
+  typedef void (*FreeFn)(void *);
+
+  static const size_t MAX_BLOCKS = 32;
+
+  void init(size_t blockBytes, size_t maxBlocks, AllocFn alloc, FreeFn release);
+  void clear();
+  bool append(uint32_t timestamp, float price);
+
+  size_t count() const;
+  size_t bytesUsed() const;
+  uint32_t lastTimestamp() const { return lastTs_; }
+  size_t evictedBlocks() const { return evicted_; }
+
+  // Decode points oldest-first. Stops early if fn returns false.
+  template <typename Fn>
+  void forEach(Fn fn) const {
+    for (size_t i = 0; i < numBlocks_; i++) {
+      const Block &b = blocks_[(firstBlock_ + i) % MAX_BLOCKS];
+      PriceHistoryDecoder dec(b.data, b.bits, b.count);
+      uint32_t ts;
+      float price;
+      while (dec.next(ts, price)) {
+        if (!fn(ts, price)) return;
+      }
+    }
+  }
+
+ private:
+  struct Block {
+    uint8_t *data;
+    size_t bits;
+    uint16_t count;
+  };
+  bool openBlock();
+  void sealBlock();
+
+  Block blocks_[MAX_BLOCKS] = {};
+  size_t firstBlock_ = 0;
+  size_t numBlocks_ = 0;
+  size_t blockBytes_ = 0;
+  size_t maxBlocks_ = 0;
+  AllocFn alloc_ = nullptr;
+  FreeFn free_ = nullptr;
+  PriceHistoryEncoder enc_;
+  bool encOpen_ = false;
+  uint32_t lastTs_ = 0;
+  size_t evicted_ = 0;
+};
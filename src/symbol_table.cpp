@@ -0,0 +1,102 @@
+// symbol_table.cpp - Flash-mapped ticker metadata lookup (see symbol_table.h)
+
+#include "symbol_table.h"
+#include "data_stats.h"
+
+#include <Arduino.h>
+#include <string.h>
+#include <esp_partition.h>
+#include <esp_crc.h>
+
+#define SYMBOL_TABLE_PARTITION_LABEL "symbols"
+#define SYMBOL_TABLE_PARTITION_SUBTYPE ((esp_partition_subtype_t)0x40)
+#define SYMBOL_TABLE_PARTITION_OFFSET 0xfd0000  // Must match partitions.csv
+#define SYMBOL_TABLE_PARTITION_SIZE 0x20000
+
+static const SymbolRecord *symbolRecords = nullptr;
+static size_t symbolRecordCount = 0;
+static esp_partition_mmap_handle_t symbolMapHandle = 0;
+
+// The partition table isn't part of an OTA image: a device that got this
+// firmware over the air keeps the table it was last flashed with over USB.
+static bool partitionLayoutMatches(const esp_partition_t *part) {
+  if (part->address == SYMBOL_TABLE_PARTITION_OFFSET && part->size == SYMBOL_TABLE_PARTITION_SIZE) return true;
+  const esp_partition_t *spiffs = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_SPIFFS,
+                                                           nullptr);
+  Serial.printf("[SYMTAB] Partition table doesn't match partitions.csv (symbols at 0x%lx, spiffs ends at 0x%lx); "
+                "OTA updates don't change it - reflash over USB with 'pio run -t upload'\n",
+                (unsigned long)part->address,
+                spiffs == nullptr ? 0UL : (unsigned long)(spiffs->address + spiffs->size));
+  return false;
+}
+
+bool symbolTableBegin() {
+  if (symbolRecords != nullptr) return true;
+
+  const esp_partition_t *part = esp_partition_find_first(
+    ESP_PARTITION_TYPE_DATA, SYMBOL_TABLE_PARTITION_SUBTYPE, SYMBOL_TABLE_PARTITION_LABEL);
+  if (part == nullptr) {
+    Serial.println("[SYMTAB] No symbols partition; OTA updates don't add it - reflash over USB with 'pio run -t upload'");
+    return false;
+  }
+  if (!partitionLayoutMatches(part)) return false;
+
+  const void *mapped = nullptr;
+  esp_err_t err = esp_partition_mmap(part, 0, part->size, ESP_PARTITION_MMAP_DATA, &mapped, &symbolMapHandle);
+  if (err != ESP_OK) {
+    Serial.printf("[SYMTAB] mmap failed: %d\n", (int)err);
+    return false;
+  }
+
+  const SymbolTableHeader *hdr = static_cast<const SymbolTableHeader *>(mapped);
+  const size_t recordBytes = (size_t)hdr->count * sizeof(SymbolRecord);
+  bool ok = hdr->magic == SYMBOL_TABLE_MAGIC &&
+            hdr->version == SYMBOL_TABLE_VERSION &&
+            hdr->recordSize == sizeof(SymbolRecord) &&
+            recordBytes <= part->size - sizeof(SymbolTableHeader);
+  const SymbolRecord *records = reinterpret_cast<const SymbolRecord *>(hdr + 1);
+  if (ok && esp_crc32_le(0, reinterpret_cast<const uint8_t *>(records), recordBytes) != hdr->crc32) {
+    Serial.println("[SYMTAB] CRC mismatch");
+    ok = false;
+  }
+  if (!ok) {
+    // Erased (0xFF) or stale partition - not flashed with upload_symbols yet.
+    Serial.println("[SYMTAB] Partition not initialized; run 'pio run -t upload_symbols'");
+    esp_partition_munmap(symbolMapHandle);
+    symbolMapHandle = 0;
+    return false;
+  }
+
+  symbolRecords = records;
+  symbolRecordCount = hdr->count;
+  dataStatsSetBytes(CACHE_SYMBOL_TABLE, recordBytes);  // Flash-mapped, not heap
+  Serial.printf("[SYMTAB] %u symbols mapped from flash\n", (unsigned)symbolRecordCount);
+  return true;
+}
+
+size_t symbolTableCount() {
+  return symbolRecordCount;
+}
+
+const SymbolRecord *symbolTableLookup(const char *symbol, bool countStats) {
+  if (symbolRecords == nullptr || symbol == nullptr) return nullptr;
+
+  size_t lo = 0, hi = symbolRecordCount;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    int cmp = strncmp(symbol, symbolRecords[mid].symbol, sizeof(symbolRecords[mid].symbol));
+    if (cmp == 0) {
+      if (countStats) dataStatsHit(CACHE_SYMBOL_TABLE);
+      return &symbolRecords[mid];
+    }
+    if (cmp < 0) hi = mid;
+    else lo = mid + 1;
+  }
+  if (countStats) dataStatsMiss(CACHE_SYMBOL_TABLE);
+  return nullptr;
+}
+
+const char *symbolTableName(const char *symbol, bool countStats) {
+  const SymbolRecord *rec = symbolTableLookup(symbol, countStats);
+  return rec ? rec->name : nullptr;
+}
@@ -0,0 +1,58 @@
+// symbol_table.h - Read-only ticker metadata (name, exchange, asset type)
+//
+// The table is generated at build time by tools/symbol_table.py from
+// tools/symbols.csv and flashed into the "symbols" data partition
+// (pio run -t upload_symbols). It is memory-mapped once at boot, so lookups
+// are a binary search over flash: no heap, no network.
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define SYMBOL_TABLE_MAGIC 0x544D5953u  // "SYMT" little-endian
+#define SYMBOL_TABLE_VERSION 1
+
+enum SymbolAssetType : uint8_t {
+  SYMBOL_ASSET_UNKNOWN = 0,
+  SYMBOL_ASSET_STOCK = 1,
+  SYMBOL_ASSET_ETF = 2,
+  SYMBOL_ASSET_ADR = 3,
+  SYMBOL_ASSET_INDEX = 4,
+};
+
+struct SymbolTableHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t recordSize;
+  uint32_t count;
+  uint32_t crc32;  // CRC-32 of the record area
+};
+
+// Fixed 64-byte records, sorted by symbol. All strings are NUL-terminated.
+struct SymbolRecord {
+  char symbol[8];
+  char exchange[10];
+  uint8_t assetType;
+  uint8_t reserved;
+  char name[44];
+};
+
+static_assert(sizeof(SymbolTableHeader) == 16, "SymbolTableHeader layout must match tools/symbol_table.py");
+static_assert(sizeof(SymbolRecord) == 64, "SymbolRecord layout must match tools/symbol_table.py");
+
+// Map the "symbols" partition and validate its header/CRC.
+// Returns false (and lookups return nullptr) if the partition is missing or not flashed.
+bool symbolTableBegin();
+
+// Number of records available (0 if the table isn't mapped).
+size_t symbolTableCount();
+
+// Binary search for an exact symbol match. The returned record points into flash.
+// Pass countStats=false for bookkeeping lookups (freshness checks, cache and
+// wire encoding) so the symbol_table hit rate only reflects names looked up
+// for display.
+const SymbolRecord *symbolTableLookup(const char *symbol, bool countStats = true);
+
+// Convenience: company name for a symbol, or nullptr if unknown.
+const char *symbolTableName(const char *symbol, bool countStats = true);
@@ -0,0 +1,276 @@
+// sys_health.cpp - Runtime instrumentation (see sys_health.h)
+
+#include "sys_health.h"
+#include "lvgl_v8_port.h"
+
+#include <esp_heap_caps.h>
+#include <esp_memory_utils.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <mbedtls/platform.h>
+
+#define MONITOR_TOP_TASKS 4
+#define MONITOR_POLL_MS 250   // How quickly a stage change is noticed (and Stop takes effect)
+
+static const char *volatile healthStage = "idle";
+
+static size_t tlsThreshold = 0;
+static SysTlsStats tlsStats = {};
+static portMUX_TYPE tlsMux = portMUX_INITIALIZER_UNLOCKED;
+
+static TaskHandle_t monitorTask = nullptr;
+static volatile bool monitorRun = false;
+static uint32_t monitorIntervalMs = 1000;
+static SysHealthLogFn monitorLog = nullptr;
+
+SysHeapSnapshot sysHealthHeap() {
+  SysHeapSnapshot s;
+  s.internalFree = heap_caps_get_free_size(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  s.internalLargest = heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  s.internalMinFree = heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  s.dmaLargest = heap_caps_get_largest_free_block(MALLOC_CAP_DMA);
+  s.psramFree = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+  s.psramLargest = heap_caps_get_largest_free_block(MALLOC_CAP_SPIRAM);
+  return s;
+}
+
+// ===== Per-task CPU =====
+#ifdef configRUN_TIME_COUNTER_TYPE
+typedef configRUN_TIME_COUNTER_TYPE RunTimeCounter;
+#else
+typedef uint32_t RunTimeCounter;
+#endif
+
+uint8_t sysHealthSampleTasks(SysCpuSampler &sampler, SysTaskCpu *out, uint8_t maxTasks) {
+#if configUSE_TRACE_FACILITY && configGENERATE_RUN_TIME_STATS
+  UBaseType_t capacity = min((UBaseType_t)SYS_HEALTH_MAX_TASKS, uxTaskGetNumberOfTasks() + 4);
+  TaskStatus_t *status = (TaskStatus_t *)malloc(sizeof(TaskStatus_t) * capacity);
+  SysTaskCpu *all = (SysTaskCpu *)malloc(sizeof(SysTaskCpu) * capacity);
+  if (status == nullptr || all == nullptr) {
+    free(status);
+    free(all);
+    return 0;
+  }
+  RunTimeCounter total = 0;
+  UBaseType_t n = uxTaskGetSystemState(status, capacity, &total);
+  uint32_t elapsed = (uint32_t)total - sampler.total;  // Deltas survive truncation and wraparound
+
+  for (UBaseType_t i = 0; i < n; i++) {
+    const TaskStatus_t &t = status[i];
+    uint32_t delta = 0;
+    for (uint8_t j = 0; j < sampler.count; j++) {
+      if (sampler.handle[j] == t.xHandle) {
+        delta = (uint32_t)t.ulRunTimeCounter - sampler.counter[j];
+        break;
+      }
+    }
+    SysTaskCpu &c = all[i];
+    strlcpy(c.name, t.pcTaskName, sizeof(c.name));
+#if configTASKLIST_INCLUDE_COREID
+    c.core = t.xCoreID == tskNO_AFFINITY ? 2 : (uint8_t)t.xCoreID;
+#else
+    c.core = 2;
+#endif
+    c.priority = (uint8_t)t.uxCurrentPriority;
+    c.cpuPct = (sampler.total != 0 && elapsed != 0) ? (uint8_t)min(100ULL, delta * 100ULL / elapsed) : 0;
+    c.stackFree = t.usStackHighWaterMark;
+  }
+
+  sampler.total = (uint32_t)total;
+  sampler.count = n;
+  for (UBaseType_t i = 0; i < n; i++) {
+    sampler.handle[i] = status[i].xHandle;
+    sampler.counter[i] = status[i].ulRunTimeCounter;
+  }
+  free(status);
+
+  // Busiest first; task counts are small, so a selection pass is plenty
+  uint8_t count = min((UBaseType_t)maxTasks, n);
+  for (uint8_t i = 0; i < count; i++) {
+    uint8_t best = i;
+    for (UBaseType_t j = i + 1; j < n; j++) {
+      if (all[j].cpuPct > all[best].cpuPct) best = j;
+    }
+    SysTaskCpu tmp = all[i];
+    all[i] = all[best];
+    all[best] = tmp;
+    out[i] = all[i];
+  }
+  free(all);
+  return count;
+#else
+  return 0;
+#endif
+}
+
+// ===== mbedTLS allocations =====
+#if defined(MBEDTLS_PLATFORM_MEMORY) && !defined(MBEDTLS_PLATFORM_CALLOC_MACRO)
+static void tlsAccount(void *p, bool add) {
+  uint32_t size = heap_caps_get_allocated_size(p);
+  bool psram = esp_ptr_external_ram(p);
+  portENTER_CRITICAL(&tlsMux);
+  uint32_t &bytes = psram ? tlsStats.psramBytes : tlsStats.internalBytes;
+  uint32_t &peak = psram ? tlsStats.psramPeak : tlsStats.internalPeak;
+  if (add) {
+    bytes += size;
+    if (bytes > peak) peak = bytes;
+  } else {
+    bytes = bytes > size ? bytes - size : 0;  // Blocks from before the hook weren't counted
+  }
+  portEXIT_CRITICAL(&tlsMux);
+}
+
+static void *tlsCalloc(size_t n, size_t size) {
+  if (size != 0 && n > SIZE_MAX / size) return nullptr;
+  bool large = n * size >= tlsThreshold;
+  void *p = nullptr;
+  if (large) p = heap_caps_calloc(n, size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+  if (p == nullptr) p = heap_caps_calloc(n, size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  if (p == nullptr && !large) p = heap_caps_calloc(n, size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+  if (p == nullptr) {
+    portENTER_CRITICAL(&tlsMux);
+    tlsStats.failures++;
+    portEXIT_CRITICAL(&tlsMux);
+    return nullptr;
+  }
+  tlsAccount(p, true);
+  return p;
+}
+
+static void tlsFree(void *p) {
+  if (p == nullptr) return;
+  tlsAccount(p, false);
+  heap_caps_free(p);
+}
+#endif
+
+bool sysHealthTlsUsePsram(size_t threshold) {
+#if defined(MBEDTLS_PLATFORM_MEMORY) && !defined(MBEDTLS_PLATFORM_CALLOC_MACRO)
+  if (heap_caps_get_free_size(MALLOC_CAP_SPIRAM) == 0) return false;
+  tlsThreshold = threshold;
+  return mbedtls_platform_set_calloc_free(tlsCalloc, tlsFree) == 0;
+#else
+  return false;
+#endif
+}
+
+SysTlsStats sysHealthTls() {
+  portENTER_CRITICAL(&tlsMux);
+  SysTlsStats s = tlsStats;
+  portEXIT_CRITICAL(&tlsMux);
+  return s;
+}
+
+// ===== Stage monitor =====
+void sysHealthSetStage(const char *stage) {
+  healthStage = stage;
+}
+
+const char *sysHealthStage() {
+  return healthStage;
+}
+
+static void monitorLoop(void *pv) {
+  SysCpuSampler sampler = {};
+  SysTaskCpu tasks[MONITOR_TOP_TASKS];
+  sysHealthSampleTasks(sampler, tasks, MONITOR_TOP_TASKS);
+  lvgl_port_lock_stats_t lock;
+  lvgl_port_get_lock_stats(&lock, true);
+
+  const char *loggedStage = nullptr;
+  uint32_t loggedMs = 0;
+  while (monitorRun) {
+    vTaskDelay(pdMS_TO_TICKS(MONITOR_POLL_MS));
+    // Lines go to a small ring buffer, so only log on a stage change or once
+    // per interval; the CPU and lock figures cover everything since the last line
+    const char *stage = healthStage;
+    if (stage == loggedStage && millis() - loggedMs < monitorIntervalMs) continue;
+    loggedStage = stage;
+    loggedMs = millis();
+    SysHeapSnapshot h = sysHealthHeap();
+    SysTlsStats tls = sysHealthTls();
+    lvgl_port_get_lock_stats(&lock, true);
+    uint8_t n = sysHealthSampleTasks(sampler, tasks, MONITOR_TOP_TASKS);
+
+    char line[256];
+    int len = snprintf(line, sizeof(line),
+                       "[Health] %s | int %luK big %luK min %luK dma %luK | psram %luK | tls %luK/%luK psram "
+                       "| lvgl wait %lu hold %lu ms (%s) |",
+                       stage, (unsigned long)h.internalFree / 1024, (unsigned long)h.internalLargest / 1024,
+                       (unsigned long)h.internalMinFree / 1024, (unsigned long)h.dmaLargest / 1024,
+                       (unsigned long)h.psramFree / 1024, (unsigned long)tls.internalBytes / 1024,
+                       (unsigned long)tls.psramBytes / 1024, (unsigned long)lock.wait_max_us / 1000,
+                       (unsigned long)lock.hold_max_us / 1000, lock.hold_max_task[0] ? lock.hold_max_task : "-");
+    for (uint8_t i = 0; i < n && len > 0 && len < (int)sizeof(line); i++) {
+      len += snprintf(line + len, sizeof(line) - len, " %s@%u %u%%", tasks[i].name, tasks[i].core, tasks[i].cpuPct);
+    }
+    if (monitorLog) monitorLog(line);
+  }
+  monitorTask = nullptr;
+  vTaskDelete(nullptr);
+}
+
+void sysHealthMonitorStart(uint32_t intervalMs, SysHealthLogFn log) {
+  if (monitorTask != nullptr && monitorRun) return;
+  // A stopped monitor exits within one poll; wait for it rather than skip
+  // this run's logging
+  while (monitorTask != nullptr) vTaskDelay(pdMS_TO_TICKS(10));
+  monitorIntervalMs = intervalMs;
+  monitorLog = log;
+  monitorRun = true;
+  // Core 0, above the app tasks: if core 1 is starved the log still comes out
+  if (xTaskCreatePinnedToCore(monitorLoop, "health", 4096, nullptr, 5, &monitorTask, 0) != pdPASS) {
+    monitorTask = nullptr;
+    monitorRun = false;
+  }
+}
+
+void sysHealthMonitorStop() {
+  monitorRun = false;  // The task exits within MONITOR_POLL_MS
+}
+
+void sysHealthJson(JsonObject out) {
+  out["stage"] = healthStage;
+
+  SysHeapSnapshot h = sysHealthHeap();
+  JsonObject heap = out["heap"].to<JsonObject>();
+  heap["internalFree"] = h.internalFree;
+  heap["internalLargest"] = h.internalLargest;
+  heap["internalMinFree"] = h.internalMinFree;
+  heap["dmaLargest"] = h.dmaLargest;
+  heap["psramFree"] = h.psramFree;
+  heap["psramLargest"] = h.psramLargest;
+
+  SysTlsStats t = sysHealthTls();
+  JsonObject tls = out["tls"].to<JsonObject>();
+  tls["internalBytes"] = t.internalBytes;
+  tls["internalPeak"] = t.internalPeak;
+  tls["psramBytes"] = t.psramBytes;
+  tls["psramPeak"] = t.psramPeak;
+  tls["failures"] = t.failures;
+
+  lvgl_port_lock_stats_t l;
+  lvgl_port_get_lock_stats(&l, false);
+  JsonObject lock = out["lvglLock"].to<JsonObject>();
+  lock["locks"] = l.locks;
+  lock["timeouts"] = l.timeouts;
+  lock["waitAvgUs"] = l.locks ? (uint32_t)(l.wait_total_us / l.locks) : 0;
+  lock["waitMaxUs"] = l.wait_max_us;
+  lock["holdAvgUs"] = l.locks ? (uint32_t)(l.hold_total_us / l.locks) : 0;
+  lock["holdMaxUs"] = l.hold_max_us;
+  lock["holdMaxTask"] = l.hold_max_task;
+
+  // CPU share since the previous /stats request
+  static SysCpuSampler statsSampler = {};
+  SysTaskCpu tasks[8];
+  uint8_t n = sysHealthSampleTasks(statsSampler, tasks, 8);
+  JsonArray arr = out["tasks"].to<JsonArray>();
+  for (uint8_t i = 0; i < n; i++) {
+    JsonObject o = arr.add<JsonObject>();
+    o["name"] = tasks[i].name;
+    o["core"] = tasks[i].core;
+    o["prio"] = tasks[i].priority;
+    o["cpuPct"] = tasks[i].cpuPct;
+    o["stackFree"] = tasks[i].stackFree;
+  }
+}
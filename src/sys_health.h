@@ -0,0 +1,88 @@
+// sys_health.h - Heap, CPU and LVGL-lock instrumentation, and TLS buffer placement
+//
+// The GitHub OTA path suspends LVGL because "TLS/HTTP can wedge when
+// LVGL is running". This module gives the numbers needed to see why:
+//
+//   - heap-caps snapshots: internal RAM free / largest block / low-water mark,
+//     DMA-capable largest block, PSRAM free / largest block
+//   - per-task CPU share between two samples (FreeRTOS run-time counters)
+//   - LVGL mutex wait/hold maxima (lvgl_port_get_lock_stats())
+//   - where mbedTLS allocations live, current and peak
+//
+// sysHealthMonitorStart() logs a line tagged with the current stage
+// (sysHealthSetStage()) whenever the stage changes, and once per interval
+// within a stage, so when a transfer stalls the last lines show which step
+// it was in and what memory and CPU looked like.
+//
+// The suspected cause is internal RAM: a TLS session wants two ~16 KB record
+// buffers plus handshake state from internal RAM, alongside WiFi/lwIP and the
+// LVGL task, and fails or stalls when the largest internal block is too small.
+// sysHealthTlsUsePsram() moves mbedTLS allocations of at least `threshold`
+// bytes (the record buffers) to PSRAM; smaller ones stay internal.
+
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+#define SYS_HEALTH_MAX_TASKS 32
+#define SYS_HEALTH_TLS_PSRAM_THRESHOLD 4096   // mbedTLS allocations this big go to PSRAM
+
+struct SysHeapSnapshot {
+  uint32_t internalFree;
+  uint32_t internalLargest;
+  uint32_t internalMinFree;  // Low-water mark since boot
+  uint32_t dmaLargest;
+  uint32_t psramFree;
+  uint32_t psramLargest;
+};
+
+struct SysTaskCpu {
+  char name[16];
+  uint8_t core;        // 0, 1, or 2 = not pinned
+  uint8_t priority;
+  uint8_t cpuPct;      // Share of one core since the previous sample
+  uint32_t stackFree;  // High-water mark, bytes
+};
+
+struct SysTlsStats {
+  uint32_t internalBytes;
+  uint32_t internalPeak;
+  uint32_t psramBytes;
+  uint32_t psramPeak;
+  uint32_t failures;     // Allocations that failed in both regions
+};
+
+// Run-time counters from the previous sample. Each caller keeps its own, so
+// the monitor and /stats don't shorten each other's intervals.
+struct SysCpuSampler {
+  uint32_t total;
+  uint8_t count;
+  void *handle[SYS_HEALTH_MAX_TASKS];
+  uint32_t counter[SYS_HEALTH_MAX_TASKS];
+};
+
+typedef void (*SysHealthLogFn)(const char *line);
+
+SysHeapSnapshot sysHealthHeap();
+
+// Per-task CPU since the sampler's previous call, busiest first. Returns the
+// task count (0 if the core was built without run-time stats).
+uint8_t sysHealthSampleTasks(SysCpuSampler &sampler, SysTaskCpu *out, uint8_t maxTasks);
+
+// Route mbedTLS allocations >= threshold bytes to PSRAM. Call once at boot,
+// before the first TLS connection.
+bool sysHealthTlsUsePsram(size_t threshold);
+SysTlsStats sysHealthTls();
+
+// Label for the monitor's log lines, e.g. "tls connect" (string literal).
+void sysHealthSetStage(const char *stage);
+const char *sysHealthStage();
+
+// Log a line on every stage change, and every intervalMs within one, until
+// stopped. Starting while a stopped monitor is still exiting waits for it.
+void sysHealthMonitorStart(uint32_t intervalMs, SysHealthLogFn log);
+void sysHealthMonitorStop();
+
+// Heap, TLS and lock counters for /stats.
+void sysHealthJson(JsonObject out);
@@ -0,0 +1,84 @@
+"""Compressed firmware image builder.
+
+Wraps firmware.bin in the container the OTA paths inflate on the fly (see
+src/ota_inflate.h), so GitHub downloads and browser uploads move ~40% fewer
+bytes:
+
+  header (48 bytes): magic "STZ1", u8 method (1 = raw deflate, 32 KB window),
+                     3 reserved, u32 image size, u32 packed size, sha256(image)
+  packed stream (raw deflate, no zlib/gzip wrapper)
+
+Publish firmware.bin.z next to firmware.bin in each GitHub release; the
+device prefers the .z asset when it is present.
+
+Standalone:   python tools/compress_firmware.py [firmware.bin] [out.bin.z]
+              python tools/compress_firmware.py --check firmware.bin.z
+PlatformIO:   listed in extra_scripts; writes $BUILD_DIR/firmware.bin.z after
+              every firmware.bin build.
+"""
+import hashlib
+import os
+import struct
+import zlib
+
+MAGIC = b"STZ1"
+METHOD_DEFLATE = 1
+HEADER = struct.Struct("<4sB3xII32s")
+WINDOW_BITS = 15  # Must match TINFL_LZ_DICT_SIZE (32 KB) on the device
+
+
+def compress_image(image):
+    c = zlib.compressobj(9, zlib.DEFLATED, -WINDOW_BITS, 9)
+    packed = c.compress(image) + c.flush()
+    return HEADER.pack(MAGIC, METHOD_DEFLATE, len(image), len(packed), hashlib.sha256(image).digest()) + packed
+
+
+def expand_image(blob):
+    magic, method, size, packed_size, digest = HEADER.unpack_from(blob)
+    if magic != MAGIC or method != METHOD_DEFLATE:
+        raise ValueError("not a compressed firmware image")
+    packed = blob[HEADER.size:]
+    if len(packed) != packed_size:
+        raise ValueError("packed stream is %d bytes, header says %d" % (len(packed), packed_size))
+    image = zlib.decompress(packed, -WINDOW_BITS)
+    if len(image) != size or hashlib.sha256(image).digest() != digest:
+        raise ValueError("image size or SHA-256 mismatch")
+    return image
+
+
+def write_compressed(src_path, dst_path):
+    with open(src_path, "rb") as f:
+        image = f.read()
+    blob = compress_image(image)
+    with open(dst_path, "wb") as f:
+        f.write(blob)
+    return len(image), len(blob)
+
+
+def _report(src, dst, size, packed):
+    print("%s: %d -> %d bytes (%.1f%%) -> %s" % (os.path.basename(src), size, packed, 100.0 * packed / size, dst))
+
+
+try:
+    Import("env")  # noqa: F821 - provided by PlatformIO/SCons
+except NameError:
+    env = None
+
+if env is not None:
+    def _compress_action(target, source, env):
+        src = str(target[0])
+        size, packed = write_compressed(src, src + ".z")
+        _report(src, src + ".z", size, packed)
+
+    env.AddPostAction("$BUILD_DIR/${PROGNAME}.bin", _compress_action)
+elif __name__ == "__main__":
+    import sys
+    if len(sys.argv) > 2 and sys.argv[1] == "--check":
+        with open(sys.argv[2], "rb") as f:
+            image = expand_image(f.read())
+        print("%s: OK, %d bytes, sha256 %s" % (sys.argv[2], len(image), hashlib.sha256(image).hexdigest()))
+    else:
+        src = sys.argv[1] if len(sys.argv) > 1 else "firmware.bin"
+        dst = sys.argv[2] if len(sys.argv) > 2 else src + ".z"
+        size, packed = write_compressed(src, dst)
+        _report(src, dst, size, packed)
@@ -0,0 +1,195 @@
+"""Binary delta builder for OTA updates.
+
+Produces a patch that turns the previous release's firmware.bin (the image
+running on the device) into the new one, so an update that touches a few
+functions doesn't download all of LVGL and ArduinoJson again. The device
+applies it by reading its running partition (see src/ota_delta.h).
+
+Delta stream (little-endian):
+  header (76 bytes): magic "STD1", u32 base size, sha256(base),
+                     u32 target size, sha256(target)
+  ops until target size bytes have been produced:
+    0x01 COPY    u32 src, u32 len              target += base[src:src+len]
+    0x02 ADD     u32 src, u32 len, len bytes   target += base[src+i] + byte[i] (mod 256)
+    0x03 INSERT  u32 len, len bytes            target += bytes
+
+ADD is the bsdiff idea: when code moves, most bytes are unchanged and the
+rest are shifted addresses, so the differences are mostly zeros. The stream
+is then deflated into the same container as compress_firmware.py.
+
+The patch is published as firmware-<first 12 hex of sha256(base)>.delta so
+a device only ever picks the patch made for the exact image it runs.
+
+Standalone:   python tools/make_delta.py old/firmware.bin new/firmware.bin [out_dir]
+              python tools/make_delta.py --check old/firmware.bin patch.delta
+PlatformIO:   set custom_ota_delta_base = <previous firmware.bin> in
+              platformio.ini; each build then writes the .delta to $BUILD_DIR.
+"""
+import hashlib
+import os
+import struct
+import sys
+
+try:
+    sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+except NameError:  # SCons runs extra_scripts without __file__, from the project dir
+    sys.path.insert(0, os.path.join(os.getcwd(), "tools"))
+import compress_firmware  # noqa: E402
+
+MAGIC = b"STD1"
+HEADER = struct.Struct("<4sI32sI32s")
+OP_COPY, OP_ADD, OP_INSERT = 1, 2, 3
+ASSET_PREFIX = "firmware-"
+ASSET_SUFFIX = ".delta"
+ASSET_SHA_CHARS = 12
+
+MATCH_LEN = 32     # Shortest exact match worth a COPY
+INDEX_STEP = 4     # Index every 4th base offset (code and data are word aligned)
+ADD_MAX_MISS = 0.5  # Gap bytes differing from the shifted base before INSERT wins
+
+
+def asset_name(base):
+    return ASSET_PREFIX + hashlib.sha256(base).hexdigest()[:ASSET_SHA_CHARS] + ASSET_SUFFIX
+
+
+def _index(base):
+    index = {}
+    for pos in range(0, len(base) - MATCH_LEN + 1, INDEX_STEP):
+        index.setdefault(base[pos:pos + MATCH_LEN], pos)
+    return index
+
+
+def _extend(base, target, src, dst):
+    """Length of the exact match base[src:] == target[dst:]."""
+    n = 0
+    limit = min(len(base) - src, len(target) - dst)
+    step = 4096  # Whole blocks while they match, then binary search the mismatch
+    while step:
+        if n + step <= limit and base[src + n:src + n + step] == target[dst + n:dst + n + step]:
+            n += step
+        else:
+            step //= 2
+    return n
+
+
+def _matches(base, target):
+    """Greedy exact matches (dst, src, len), trying the current shift first."""
+    index = _index(base)
+    shift = 0
+    dst = 0
+    end = len(target) - MATCH_LEN
+    while dst <= end:
+        key = target[dst:dst + MATCH_LEN]
+        src = dst + shift
+        if not (0 <= src <= len(base) - MATCH_LEN and base[src:src + MATCH_LEN] == key):
+            src = index.get(key)
+        if src is None:
+            dst += 1
+            continue
+        n = _extend(base, target, src, dst)
+        yield dst, src, n
+        shift = src - dst
+        dst += n
+
+
+def _gap_ops(base, target, dst, end, shift):
+    """Cover target[dst:end] with ADD against the shifted base, or INSERT."""
+    length = end - dst
+    src = dst + shift
+    if length and 0 <= src and src + length <= len(base):
+        diff = bytes((t - b) & 0xFF for t, b in zip(target[dst:end], base[src:src + length]))
+        if diff.count(0) >= length * (1 - ADD_MAX_MISS):
+            return struct.pack("<BII", OP_ADD, src, length) + diff
+    return struct.pack("<BI", OP_INSERT, length) + target[dst:end]
+
+
+def make_delta(base, target):
+    out = [HEADER.pack(MAGIC, len(base), hashlib.sha256(base).digest(), len(target),
+                       hashlib.sha256(target).digest())]
+    dst = 0
+    shift = 0
+    for mdst, msrc, n in _matches(base, target):
+        if mdst > dst:
+            out.append(_gap_ops(base, target, dst, mdst, shift))
+        out.append(struct.pack("<BII", OP_COPY, msrc, n))
+        shift = msrc - mdst
+        dst = mdst + n
+    if dst < len(target):
+        out.append(_gap_ops(base, target, dst, len(target), shift))
+    return b"".join(out)
+
+
+def apply_delta(base, delta):
+    """Reference applier; the firmware's ota_delta.cpp does the same in a stream."""
+    magic, base_size, base_sha, target_size, target_sha = HEADER.unpack_from(delta)
+    if magic != MAGIC:
+        raise ValueError("not a delta")
+    if base_size != len(base) or base_sha != hashlib.sha256(base).digest():
+        raise ValueError("delta was made for a different base image")
+    out = bytearray()
+    pos = HEADER.size
+    while len(out) < target_size:
+        op = delta[pos]
+        if op in (OP_COPY, OP_ADD):
+            src, n = struct.unpack_from("<II", delta, pos + 1)
+            pos += 9
+            if op == OP_COPY:
+                out += base[src:src + n]
+            else:
+                out += bytes((b + d) & 0xFF for b, d in zip(base[src:src + n], delta[pos:pos + n]))
+                pos += n
+        elif op == OP_INSERT:
+            (n,) = struct.unpack_from("<I", delta, pos + 1)
+            pos += 5
+            out += delta[pos:pos + n]
+            pos += n
+        else:
+            raise ValueError("bad op %d at %d" % (op, pos))
+    if pos != len(delta) or hashlib.sha256(out).digest() != target_sha:
+        raise ValueError("target size or SHA-256 mismatch")
+    return bytes(out)
+
+
+def write_delta(base_path, target_path, out_dir):
+    with open(base_path, "rb") as f:
+        base = f.read()
+    with open(target_path, "rb") as f:
+        target = f.read()
+    packed = compress_firmware.compress_image(make_delta(base, target))
+    os.makedirs(out_dir, exist_ok=True)
+    out_path = os.path.join(out_dir, asset_name(base))
+    with open(out_path, "wb") as f:
+        f.write(packed)
+    return len(target), len(packed), out_path
+
+
+def _report(size, packed, out_path):
+    print("delta: %d byte image -> %d byte patch (%.1f%%) -> %s" % (size, packed, 100.0 * packed / size, out_path))
+
+
+try:
+    Import("env")  # noqa: F821 - provided by PlatformIO/SCons
+except NameError:
+    env = None
+
+if env is not None:
+    _base = env.GetProjectOption("custom_ota_delta_base", "")
+    if _base:
+        _base = os.path.join(env.subst("$PROJECT_DIR"), _base)
+
+        def _delta_action(target, source, env):
+            _report(*write_delta(_base, str(target[0]), env.subst("$BUILD_DIR")))
+
+        env.AddPostAction("$BUILD_DIR/${PROGNAME}.bin", _delta_action)
+elif __name__ == "__main__":
+    if len(sys.argv) == 4 and sys.argv[1] == "--check":
+        with open(sys.argv[2], "rb") as f:
+            base = f.read()
+        with open(sys.argv[3], "rb") as f:
+            image = apply_delta(base, compress_firmware.expand_image(f.read()))
+        print("%s: OK, %d bytes, sha256 %s" % (sys.argv[3], len(image), hashlib.sha256(image).hexdigest()))
+    elif len(sys.argv) in (3, 4):
+        _report(*write_delta(sys.argv[1], sys.argv[2], sys.argv[3] if len(sys.argv) == 4 else "."))
+    else:
+        print(__doc__)
+        sys.exit(1)
@@ -0,0 +1,350 @@
+"""Throttled firmware server and OTA throughput benchmark.
+
+Serves a firmware image at /firmware.bin with a bandwidth cap and added
+latency, so OTA download code can be measured against a repeatable link
+instead of GitHub's CDN. With --device, it also drives the ticker's
+/otabench endpoint over a matrix of pipeline settings and prints MB/s for
+each:
+
+  python tools/ota_bench.py --image .pio/build/esp32s3/firmware.bin --rate 1500 --device stockticker.local
+  python tools/ota_bench.py --size 1800000 --rate 400 --latency 40       # serve only
+  python tools/ota_bench.py --size 4000000 --rate 2000 --self-test       # check the throttle locally
+  python tools/ota_bench.py --host --rate 2000                            # host test bench, no device
+
+/otabench only exists in firmware built with -DOTA_BENCH (see platformio.ini).
+It downloads into the inactive OTA slot and aborts, so nothing is
+installed. "depth 1" is the synchronous read-then-write loop the OTA path used
+before the pipeline; "flash off" discards the data to isolate the network.
+
+--host builds tools/ota_session_bench.cpp with the firmware's OTA state
+machine (src/ota_session.cpp) and runs it against server misbehaviour:
+chunked bodies, no Content-Length, redirects, stalls, truncation and 5xx.
+Each scenario reports its outcome, MB/s and time to complete, and whether
+the mock flash slot ended up identical to the served image.
+"""
+import argparse
+import json
+import os
+import random
+import shutil
+import socket
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+import urllib.parse
+import urllib.request
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+SEND_QUANTUM = 1460  # One TCP segment per write, so pacing is smooth at low rates
+
+# (chunk, depth, flash) combinations run against the device
+MATRIX = [
+    (1024, 1, True),     # The original 1 KB synchronous loop
+    (32768, 1, True),    # Bigger reads only
+    (32768, 2, True),    # Double buffered
+    (32768, 3, True),    # Triple buffered (default)
+    (65536, 3, True),
+    (32768, 3, False),   # Network only
+]
+
+
+class Throttle:
+    """Token bucket shared by all connections (one link to the device)."""
+
+    def __init__(self, rate_kbps):
+        self.rate = rate_kbps * 1000.0
+        self.lock = threading.Lock()
+        self.allowance = 0.0
+        self.last = time.monotonic()
+
+    def take(self, nbytes):
+        if self.rate <= 0:
+            return
+        while True:
+            with self.lock:
+                now = time.monotonic()
+                self.allowance = min(self.allowance + (now - self.last) * self.rate, self.rate * 0.05)
+                self.last = now
+                if self.allowance >= nbytes:
+                    self.allowance -= nbytes
+                    return
+                wait = (nbytes - self.allowance) / self.rate
+            time.sleep(wait)
+
+
+class Handler(BaseHTTPRequestHandler):
+    image = b""
+    throttle = None
+    latency = 0.0
+    quiet = False
+
+    def log_message(self, fmt, *args):
+        if not self.quiet:
+            super().log_message(fmt, *args)
+
+    def do_GET(self):
+        if urllib.parse.urlparse(self.path).path != "/firmware.bin":
+            self.send_error(404)
+            return
+        time.sleep(self.latency)  # Time to first byte
+        self.send_response(200)
+        self.send_header("Content-Type", "application/octet-stream")
+        self.send_header("Content-Length", str(len(self.image)))
+        self.end_headers()
+        start = time.monotonic()
+        view = memoryview(self.image)
+        try:
+            for offset in range(0, len(view), SEND_QUANTUM):
+                piece = view[offset:offset + SEND_QUANTUM]
+                self.throttle.take(len(piece))
+                self.wfile.write(piece)
+        except (BrokenPipeError, ConnectionResetError):
+            return
+        elapsed = time.monotonic() - start
+        if not self.quiet:
+            print(f"  served {len(self.image)} bytes in {elapsed:.2f} s ({len(self.image) / elapsed / 1e6:.2f} MB/s)")
+
+
+# --host scenarios: (name, expected step, expected error, what the server does)
+SCENARIOS = [
+    ("plain", "done", "ok", "200 with Content-Length"),
+    ("chunked", "done", "ok", "Transfer-Encoding: chunked, random chunk sizes, extension and trailer"),
+    ("no-length", "done", "ok", "no Content-Length, close marks the end"),
+    ("redirect", "done", "ok", "302 to a relative path, then 301 to an absolute URL"),
+    ("redirect-loop", "failed", "bad redirect", "302 to itself forever"),
+    ("stall", "done", "ok", "stops sending at 40% once; Range resume"),
+    ("truncate", "done", "ok", "closes at 60% once; Range resume"),
+    ("no-range", "failed", "server ignored Range", "closes at 60%, then ignores Range"),
+    ("error-503", "done", "ok", "503 on the first request"),
+    ("chunked-truncated", "failed", "truncated", "chunked, closes before the last chunk"),
+    ("bad-chunk", "failed", "bad chunked framing", "chunked with a broken size line"),
+]
+STALL_MS = 1500  # Bench client's stall timeout; the "stall" scenario goes quiet for longer
+
+
+class ScenarioHandler(BaseHTTPRequestHandler):
+    """Serves /<scenario>/firmware.bin, misbehaving as the scenario says."""
+    protocol_version = "HTTP/1.1"  # Needed for chunked responses
+    image = b""
+    throttle = None
+    hits = {}
+    lock = threading.Lock()
+
+    def log_message(self, fmt, *args):
+        pass
+
+    def _send(self, data):
+        view = memoryview(data)
+        for offset in range(0, len(view), SEND_QUANTUM):
+            piece = view[offset:offset + SEND_QUANTUM]
+            self.throttle.take(len(piece))
+            self.wfile.write(piece)
+
+    def _headers(self, code, extra=()):
+        self.send_response(code)
+        self.send_header("Content-Type", "application/octet-stream")
+        self.send_header("Connection", "close")
+        for key, value in extra:
+            self.send_header(key, value)
+        self.end_headers()
+
+    def _range_start(self):
+        value = self.headers.get("Range", "")
+        if value.startswith("bytes=") and value.endswith("-"):
+            return int(value[6:-1])
+        return 0
+
+    def _full(self, length=True):
+        self._headers(200, [("Content-Length", str(len(self.image)))] if length else [])
+        self._send(self.image)
+
+    def _ranged(self, start):
+        size = len(self.image)
+        self._headers(206, [("Content-Length", str(size - start)),
+                            ("Content-Range", f"bytes {start}-{size - 1}/{size}")])
+        self._send(self.image[start:])
+
+    def _chunked(self, cut=None, corrupt=False):
+        self._headers(200, [("Transfer-Encoding", "chunked")])
+        body = self.image if cut is None else self.image[:cut]
+        pos = 0
+        rng = random.Random(len(self.image))
+        while pos < len(body):
+            n = min(rng.randint(1, 16384), len(body) - pos)
+            ext = ";x=1" if pos == 0 else ""
+            size = "zz" if corrupt and pos > len(body) // 2 else "%x" % n
+            self._send(f"{size}{ext}\r\n".encode() + body[pos:pos + n] + b"\r\n")
+            pos += n
+        if cut is None:
+            self._send(b"0\r\nX-Checksum: none\r\n\r\n")
+
+    def do_GET(self):
+        parts = urllib.parse.urlparse(self.path).path.strip("/").split("/")
+        name, step = parts[0], "/".join(parts[1:])
+        with self.lock:
+            hit = self.hits.get(name, 0)
+            self.hits[name] = hit + 1
+        start = self._range_start()
+        size = len(self.image)
+        self.close_connection = True
+        try:
+            if name == "plain":
+                self._full()
+            elif name == "chunked":
+                self._chunked()
+            elif name == "no-length":
+                self._full(length=False)
+            elif name == "redirect":
+                if step == "firmware.bin":
+                    self._headers(302, [("Location", "/redirect/hop"), ("Content-Length", "0")])
+                else:
+                    host = self.headers.get("Host")
+                    self._headers(301, [("Location", f"http://{host}/plain/firmware.bin"), ("Content-Length", "0")])
+            elif name == "redirect-loop":
+                self._headers(302, [("Location", self.path), ("Content-Length", "0")])
+            elif name in ("stall", "truncate", "no-range"):
+                if hit == 0:
+                    cut = size * (4 if name == "stall" else 6) // 10
+                    self._headers(200, [("Content-Length", str(size))])
+                    self._send(self.image[:cut])
+                    if name == "stall":
+                        time.sleep(STALL_MS / 1000.0 + 1.0)
+                elif name == "no-range":
+                    self._full()
+                else:
+                    self._ranged(start)
+            elif name == "error-503":
+                if hit == 0:
+                    self._headers(503, [("Content-Length", "0")])
+                else:
+                    self._full()
+            elif name == "chunked-truncated":
+                self._chunked(cut=size // 2)
+            elif name == "bad-chunk":
+                self._chunked(corrupt=True)
+            else:
+                self.send_error(404)
+        except (BrokenPipeError, ConnectionResetError):
+            pass
+
+
+def build_host_bench(out_dir):
+    root = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+    exe = os.path.join(out_dir, "ota_session_bench")
+    cmd = [os.environ.get("CXX", "g++"), "-O2", "-std=c++17", "-I" + os.path.join(root, "src"),
+           os.path.join(root, "tools", "ota_session_bench.cpp"), os.path.join(root, "src", "ota_session.cpp"),
+           "-o", exe]
+    subprocess.run(cmd, check=True)
+    subprocess.run([exe, "--self-check"], check=True)
+    return exe
+
+
+def run_host(args, image):
+    if shutil.which(os.environ.get("CXX", "g++")) is None:
+        sys.exit("--host needs a C++ compiler (g++ or $CXX)")
+    handler = type("HostScenarios", (ScenarioHandler,), {"image": image, "throttle": Throttle(args.rate),
+                                                         "hits": {}})
+    server = ThreadingHTTPServer(("127.0.0.1", args.port), handler)
+    threading.Thread(target=server.serve_forever, daemon=True).start()
+    print(f"host bench: {len(image)} byte image at {args.rate:g} KB/s, flash {args.flash_kbps:g} KB/s "
+          f"(0 = instant), stall timeout {STALL_MS} ms")
+
+    failures = 0
+    with tempfile.TemporaryDirectory() as tmp:
+        exe = build_host_bench(tmp)
+        image_path = os.path.join(tmp, "image.bin")
+        with open(image_path, "wb") as f:
+            f.write(image)
+        print(f"{'scenario':<19}{'result':<9}{'error':<22}{'req':>4}{'redir':>6}{'retry':>6}{'MB/s':>7}"
+              f"{'time s':>8}  image")
+        for name, want_step, want_error, _ in SCENARIOS:
+            handler.hits.clear()
+            out = subprocess.run([exe, "--url", f"http://127.0.0.1:{args.port}/{name}/firmware.bin",
+                                  "--expect", image_path, "--stall-ms", str(STALL_MS),
+                                  "--flash-kbps", str(args.flash_kbps)],
+                                 capture_output=True, text=True, timeout=300)
+            r = json.loads(out.stdout.strip().splitlines()[-1])
+            ok = r["step"] == want_step and r["error"] == want_error and r["image"] != "mismatch"
+            failures += not ok
+            print(f"{name:<19}{r['step']:<9}{r['error']:<22}{r['requests']:>4}{r['redirects']:>6}{r['retries']:>6}"
+                  f"{r['mbps']:>7.2f}{r['ms'] / 1000.0:>8.2f}  {r['image']:<9}{'PASS' if ok else 'FAIL'}")
+    server.shutdown()
+    print(f"{len(SCENARIOS) - failures}/{len(SCENARIOS)} scenarios as expected")
+    return failures == 0
+
+
+def local_ip():
+    with socket.socket(socket.AF_INET, socket.SOCK_DGRAM) as s:
+        s.connect(("10.255.255.255", 1))
+        return s.getsockname()[0]
+
+
+def run_device(device, url):
+    print(f"{'chunk':>7}{'depth':>7}{'flash':>7}{'result':>10}{'MB/s':>8}{'net wait':>10}{'flash ms':>10}"
+          f"{'buf wait':>10}{'idle':>8}")
+    for chunk, depth, flash in MATRIX:
+        query = urllib.parse.urlencode({"url": url, "chunk": chunk, "depth": depth, "flash": int(flash)})
+        with urllib.request.urlopen(f"http://{device}/otabench?{query}", timeout=600) as resp:
+            r = json.load(resp)
+        if "error" in r:
+            print(f"{chunk:>7}{depth:>7}{'on' if flash else 'off':>7}  error: {r['error']}")
+            continue
+        print(f"{chunk:>7}{depth:>7}{'on' if flash else 'off':>7}{r['result']:>10}{r['mbps']:>8.2f}"
+              f"{r['networkWaitMs']:>10}{r['writeMs']:>10}{r['bufferWaitMs']:>10}{r['writerIdleMs']:>8}")
+
+
+def self_test(url, size):
+    start = time.monotonic()
+    with urllib.request.urlopen(url) as resp:
+        got = len(resp.read())
+    elapsed = time.monotonic() - start
+    print(f"self-test: {got}/{size} bytes in {elapsed:.2f} s = {got / elapsed / 1e6:.2f} MB/s")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Throttled firmware server / OTA throughput benchmark")
+    parser.add_argument("--image", help="firmware.bin to serve (default: --size random bytes)")
+    parser.add_argument("--size", type=int, default=1_800_000)
+    parser.add_argument("--rate", type=float, default=1500, help="link rate in KB/s (0 = unthrottled)")
+    parser.add_argument("--latency", type=float, default=30, help="time to first byte in ms")
+    parser.add_argument("--port", type=int, default=8090)
+    parser.add_argument("--device", help="ticker address; runs the /otabench matrix")
+    parser.add_argument("--self-test", action="store_true", help="download once from this host and exit")
+    parser.add_argument("--host", action="store_true", help="run the host test bench scenarios and exit")
+    parser.add_argument("--flash-kbps", type=float, default=0, help="--host: simulated flash write rate in KB/s")
+    args = parser.parse_args()
+
+    if args.image:
+        with open(args.image, "rb") as f:
+            image = f.read()
+    else:
+        image = os.urandom(args.size)
+
+    if args.host:
+        sys.exit(0 if run_host(args, image) else 1)
+
+    handler = type("BenchHandler", (Handler,), {"image": image, "throttle": Throttle(args.rate),
+                                                "latency": args.latency / 1000.0,
+                                                "quiet": args.self_test})
+    server = ThreadingHTTPServer(("0.0.0.0", args.port), handler)
+    threading.Thread(target=server.serve_forever, daemon=True).start()
+    print(f"serving {len(image)} bytes at {args.rate:g} KB/s, {args.latency:g} ms latency on port {args.port}")
+
+    try:
+        if args.self_test:
+            self_test(f"http://127.0.0.1:{args.port}/firmware.bin", len(image))
+        elif args.device:
+            run_device(args.device, f"http://{local_ip()}:{args.port}/firmware.bin")
+        else:
+            while True:
+                time.sleep(3600)
+    except KeyboardInterrupt:
+        pass
+    finally:
+        server.shutdown()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,313 @@
+// ota_session_bench.cpp - Host test bench for the OTA download state machine
+//
+// Build and run from the repo root (tools/ota_bench.py --host does both and
+// serves the scenarios):
+//   g++ -O2 -std=c++17 -Isrc tools/ota_session_bench.cpp src/ota_session.cpp -o /tmp/ota_session_bench
+//   /tmp/ota_session_bench --self-check
+//   /tmp/ota_session_bench --url http://127.0.0.1:8090/plain/firmware.bin --expect image.bin
+//
+// Drives OtaSession the way githubOtaTask does, with a POSIX-socket HTTP/1.1
+// client in place of HTTPClient and a mock flash slot in place of Update.
+// The body is read straight off the socket and handed to the sink (through
+// the chunk decoder when chunked), stalls are detected with poll(), and the
+// slot contents are compared to the expected image at the end. Prints one
+// JSON line per download.
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ota_session.h"
+
+#define SLOT_BYTES 0x640000  // app0/app1 in partitions.csv
+#define READ_CHUNK 32768     // OTA_PIPE_CHUNK
+
+static uint32_t stallMs = 1500;
+static double flashKBps = 0;  // 0 = instant writes
+
+static uint64_t nowMs() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch())
+    .count();
+}
+
+// ===== Mock Update =====
+static std::vector<uint8_t> slot;
+static bool slotOverflow = false;
+
+static size_t flashWrite(uint8_t *data, size_t len) {
+  if (slot.size() + len > SLOT_BYTES) {
+    slotOverflow = true;
+    return 0;
+  }
+  slot.insert(slot.end(), data, data + len);
+  if (flashKBps > 0) std::this_thread::sleep_for(std::chrono::microseconds((uint64_t)(len * 1000.0 / flashKBps)));
+  return len;
+}
+
+// ===== HTTP client =====
+struct HttpResponse {
+  int code = 0;
+  long length = -1;
+  bool chunked = false;
+  std::string location;
+  std::string contentRange;
+};
+
+static bool headerIs(const std::string &line, const char *name, std::string &value) {
+  size_t n = strlen(name);
+  if (line.size() <= n || strncasecmp(line.c_str(), name, n) != 0 || line[n] != ':') return false;
+  size_t start = line.find_first_not_of(" \t", n + 1);
+  value = start == std::string::npos ? "" : line.substr(start);
+  return true;
+}
+
+class HttpConn {
+ public:
+  ~HttpConn() { close(); }
+
+  // Returns false on connect/parse errors (code is then -1, like HTTPClient)
+  bool get(const char *url, size_t rangeStart, HttpResponse &resp) {
+    resp = HttpResponse();
+    resp.code = -1;
+    std::string u = url;
+    if (u.compare(0, 7, "http://") != 0) return false;  // The bench serves plain HTTP
+    size_t pathStart = u.find('/', 7);
+    std::string hostPort = u.substr(7, pathStart == std::string::npos ? std::string::npos : pathStart - 7);
+    std::string path = pathStart == std::string::npos ? "/" : u.substr(pathStart);
+    std::string host = hostPort, port = "80";
+    size_t colon = hostPort.find(':');
+    if (colon != std::string::npos) {
+      host = hostPort.substr(0, colon);
+      port = hostPort.substr(colon + 1);
+    }
+
+    addrinfo hints = {}, *addr = nullptr;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host.c_str(), port.c_str(), &hints, &addr) != 0) return false;
+    fd_ = socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol);
+    bool connected = fd_ >= 0 && connect(fd_, addr->ai_addr, addr->ai_addrlen) == 0;
+    freeaddrinfo(addr);
+    if (!connected) return false;
+
+    std::string req = "GET " + path + " HTTP/1.1\r\nHost: " + hostPort +
+                      "\r\nUser-Agent: ESP32-Stock-Ticker\r\nAccept: application/octet-stream\r\nConnection: close\r\n";
+    if (rangeStart > 0) req += "Range: bytes=" + std::to_string(rangeStart) + "-\r\n";
+    req += "\r\n";
+    if (send(fd_, req.data(), req.size(), MSG_NOSIGNAL) != (ssize_t)req.size()) return false;
+
+    // Headers, up to the blank line; body bytes read past it stay in pending_
+    std::string head;
+    size_t end;
+    while ((end = head.find("\r\n\r\n")) == std::string::npos) {
+      char buf[2048];
+      long n = readSome((uint8_t *)buf, sizeof(buf));
+      if (n <= 0 || head.size() > 16384) return false;
+      head.append(buf, n);
+    }
+    pending_ = head.substr(end + 4);
+    head.resize(end);
+
+    size_t lineEnd = head.find("\r\n");
+    std::string status = head.substr(0, lineEnd);
+    if (sscanf(status.c_str(), "HTTP/%*d.%*d %d", &resp.code) != 1) return false;
+    while (lineEnd != std::string::npos) {
+      size_t start = lineEnd + 2;
+      lineEnd = head.find("\r\n", start);
+      std::string line = head.substr(start, lineEnd == std::string::npos ? std::string::npos : lineEnd - start);
+      std::string value;
+      if (headerIs(line, "Content-Length", value)) resp.length = atol(value.c_str());
+      else if (headerIs(line, "Location", value)) resp.location = value;
+      else if (headerIs(line, "Content-Range", value)) resp.contentRange = value;
+      else if (headerIs(line, "Transfer-Encoding", value)) resp.chunked = strcasecmp(value.c_str(), "chunked") == 0;
+    }
+    return true;
+  }
+
+  // Body bytes: >0 read, 0 = closed, -1 = nothing for stallMs
+  long read(uint8_t *buf, size_t len) {
+    if (!pending_.empty()) {
+      size_t n = std::min(len, pending_.size());
+      memcpy(buf, pending_.data(), n);
+      pending_.erase(0, n);
+      return n;
+    }
+    return readSome(buf, len);
+  }
+
+  void close() {
+    if (fd_ >= 0) ::close(fd_);
+    fd_ = -1;
+    pending_.clear();
+  }
+
+ private:
+  long readSome(uint8_t *buf, size_t len) {
+    pollfd p = {fd_, POLLIN, 0};
+    if (poll(&p, 1, stallMs) <= 0) return -1;
+    long n = recv(fd_, buf, len, 0);
+    return n < 0 ? 0 : n;
+  }
+
+  int fd_ = -1;
+  std::string pending_;
+};
+
+// Host stand-in for otaPipelineRun(): read, sink, repeat
+static OtaBodyEnd pumpBody(HttpConn &conn, long length, OtaSinkFn sink, size_t &bytes) {
+  static uint8_t buf[READ_CHUNK];
+  bytes = 0;
+  while (length < 0 || bytes < (size_t)length) {
+    size_t want = length < 0 ? sizeof(buf) : std::min(sizeof(buf), (size_t)length - bytes);
+    long n = conn.read(buf, want);
+    if (n < 0) return OTA_BODY_STALLED;
+    if (n == 0) return length < 0 ? OTA_BODY_OK : OTA_BODY_DISCONNECTED;
+    if (sink(buf, n) != (size_t)n) return OTA_BODY_SINK_FAILED;
+    bytes += n;
+  }
+  return OTA_BODY_OK;
+}
+
+static OtaSession session;
+
+static size_t dechunk(uint8_t *data, size_t len) {
+  return session.chunks().write(data, len, flashWrite);
+}
+
+// ===== Download, as githubOtaTask runs it =====
+static int download(const char *url, const std::vector<uint8_t> *expect, const OtaSessionConfig &config) {
+  slot.clear();
+  slotOverflow = false;
+  session.begin(url, config);
+  uint64_t startMs = nowMs();
+  uint64_t retryWaitMs = 0;
+
+  OtaSessionStep step = OTA_STEP_REQUEST;
+  while (step == OTA_STEP_REQUEST || step == OTA_STEP_RETRY) {
+    if (step == OTA_STEP_RETRY) {
+      retryWaitMs += session.retryDelayMs();
+      std::this_thread::sleep_for(std::chrono::milliseconds(session.retryDelayMs()));
+    }
+    HttpConn conn;
+    HttpResponse resp;
+    conn.get(session.url(), session.rangeStart(), resp);
+    step = session.response(resp.code, resp.length, resp.location.c_str(), resp.contentRange.c_str(), resp.chunked);
+    if (step != OTA_STEP_STREAM) continue;
+    size_t bytes = 0;
+    OtaBodyEnd how = pumpBody(conn, resp.chunked ? -1 : resp.length, session.chunked() ? dechunk : flashWrite, bytes);
+    step = session.bodyEnd(how, bytes);
+  }
+
+  uint64_t elapsedMs = nowMs() - startMs;
+  const char *image = "none";
+  if (step == OTA_STEP_DONE && expect) image = slot == *expect ? "match" : "mismatch";
+  if (slotOverflow) image = "overflow";
+  double mbps = elapsedMs ? session.received() / 1000.0 / elapsedMs : 0;
+  printf("{\"step\":\"%s\",\"error\":\"%s\",\"http\":%d,\"requests\":%u,\"redirects\":%u,\"retries\":%u,"
+         "\"bytes\":%zu,\"ms\":%llu,\"retryWaitMs\":%llu,\"mbps\":%.2f,\"image\":\"%s\"}\n",
+         step == OTA_STEP_DONE ? "done" : "failed", otaSessionErrorName(session.error()), session.httpCode(),
+         session.requests(), session.redirects(), session.retries(), session.received(),
+         (unsigned long long)elapsedMs, (unsigned long long)retryWaitMs, mbps, image);
+  return step == OTA_STEP_DONE && strcmp(image, "mismatch") != 0 ? 0 : 1;
+}
+
+// ===== Self-check: versions and chunk framing, no server =====
+static std::string decoded;
+
+static size_t collect(uint8_t *data, size_t len) {
+  decoded.append((const char *)data, len);
+  return len;
+}
+
+static int selfCheck() {
+  struct VersionCase {
+    const char *remote, *local;
+    bool newer;
+  } versions[] = {
+    {"1.10.0", "1.9.9", true}, {"1.9.9", "1.10.0", false}, {"2.0.0", "1.99.99", true},
+    {"1.2.3", "1.2.3", false}, {"1.2", "1.2.0", false},    {"1.2.1", "1.2", true},
+    {"", "1.0.0", false},
+  };
+  int failures = 0;
+  for (const VersionCase &v : versions) {
+    if (otaVersionIsNewer(v.remote, v.local) != v.newer) {
+      printf("version: \"%s\" > \"%s\" should be %s\n", v.remote, v.local, v.newer ? "true" : "false");
+      failures++;
+    }
+  }
+
+  struct ChunkCase {
+    const char *raw, *payload;
+    bool done, failed;
+  } chunks[] = {
+    {"5\r\nhello\r\n6\r\n world\r\n0\r\n\r\n", "hello world", true, false},
+    {"A;name=x\r\n0123456789\r\n0\r\nX-Sum: 1\r\n\r\n", "0123456789", true, false},
+    {"5\r\nhello\r\n6\r\n wor", "hello wor", false, false},  // Truncated
+    {"5\r\nhelloX\r\n", "hello", false, true},              // Missing CRLF after data
+    {"zz\r\n", "", false, true},                              // Not hex
+  };
+  for (const ChunkCase &c : chunks) {
+    // Every split point, so state carries across writes
+    size_t len = strlen(c.raw);
+    for (size_t split = 0; split <= len; split++) {
+      OtaChunkDecoder d;
+      decoded.clear();
+      std::string raw = c.raw;
+      d.write((uint8_t *)&raw[0], split, collect);
+      if (!d.failed()) d.write((uint8_t *)&raw[split], len - split, collect);
+      if (decoded != c.payload || d.done() != c.done || d.failed() != c.failed) {
+        printf("chunks: \"%s\" split at %zu gave \"%s\" done=%d failed=%d\n", c.payload, split, decoded.c_str(),
+               d.done(), d.failed());
+        failures++;
+        break;
+      }
+    }
+  }
+  printf("self-check: %s\n", failures ? "FAILED" : "ok");
+  return failures ? 1 : 0;
+}
+
+int main(int argc, char **argv) {
+  const char *url = nullptr;
+  const char *expectPath = nullptr;
+  OtaSessionConfig config = {5, 100, 1000};  // Device: 5, 2000, 10000; shorter waits keep the bench quick
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    const char *next = i + 1 < argc ? argv[i + 1] : "";
+    if (!strcmp(arg, "--self-check")) return selfCheck();
+    if (!strcmp(arg, "--url")) url = next, i++;
+    else if (!strcmp(arg, "--expect")) expectPath = next, i++;
+    else if (!strcmp(arg, "--stall-ms")) stallMs = atoi(next), i++;
+    else if (!strcmp(arg, "--retries")) config.maxRetries = atoi(next), i++;
+    else if (!strcmp(arg, "--backoff-ms")) config.backoffMs = atoi(next), i++;
+    else if (!strcmp(arg, "--flash-kbps")) flashKBps = atof(next), i++;
+  }
+  if (url == nullptr) {
+    fprintf(stderr, "usage: %s --self-check | --url URL [--expect FILE] [--stall-ms N] [--retries N] "
+                    "[--backoff-ms N] [--flash-kbps KB/s]\n", argv[0]);
+    return 2;
+  }
+
+  std::vector<uint8_t> expect;
+  if (expectPath) {
+    FILE *f = fopen(expectPath, "rb");
+    if (!f) {
+      perror(expectPath);
+      return 2;
+    }
+    uint8_t buf[65536];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) expect.insert(expect.end(), buf, buf + n);
+    fclose(f);
+  }
+  return download(url, expectPath ? &expect : nullptr, config);
+}
@@ -0,0 +1,434 @@
+"""Local stand-in for the P2P registry.
+
+Speaks the same HTTP API the firmware uses (see src/main.cpp, "P2P NETWORK
+CLIENT", and src/p2p_wire.h), so devices or the load simulator can run against
+a LAN machine instead of the hosted registry:
+
+  POST /register         JSON {nodeId, address, firmwareVersion, wire:[1,2], symbols}
+                         -> {success, nodesOnline, wire}
+  POST /heartbeat        v1 JSON {nodeId, stockData:{SYM:{price,...}}}
+                         v2 MessagePack {nodeId, v:2, quotes:[[...], ...]}
+                         -> {nodesOnline, stocksCached}, 404 if the node expired
+  GET  /stock/{symbol}   v1 JSON {found, ageSeconds, data}
+                         v2 (Accept: application/msgpack) {found, q:[...]}
+  GET  /stocks?symbols=A,B&age=N
+                         v2 only: {v:2, n:count} followed by `count` quote arrays
+
+Quotes are stored numerically and rendered into whichever wire version the
+caller speaks. Stdlib only; MessagePack is handled by the small codec below.
+Per-endpoint request/byte counters and the number of stored heartbeat entries
+are kept on the Registry object; tools/p2p_sim.py drives it on simulated time.
+
+Usage:  python tools/p2p_registry.py [--port 8787] [--key your-network-secret] [--wire 2]
+Point P2P_REGISTRY_URL at http://<this-host>:8787 and use the same key.
+"""
+import argparse
+import json
+import struct
+import threading
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from urllib.parse import parse_qs, urlparse
+
+WIRE_V1_JSON = 1
+WIRE_V2_MSGPACK = 2
+MSGPACK_TYPE = "application/msgpack"
+NODE_EXPIRY_SEC = 1800          # Three missed 10-minute heartbeats
+MAX_AGE_SEC = 900               # Matches the firmware's peer quote TTL
+BULK_MAX_SYMBOLS = 20
+
+# v2 quote array layout (p2p_wire.h)
+PQ_FIELDS = ("symbol", "timestamp", "price", "prevClose", "open", "high", "low", "volume",
+             "fiftyTwoLow", "fiftyTwoHigh", "oneMonthLow", "oneMonthHigh", "flags", "name")
+PQ_FLAG_MARKET_OPEN = 0x01
+
+
+# ---------------------------------------------------------------- MessagePack
+
+def mp_pack(obj, out=None):
+    out = bytearray() if out is None else out
+    if obj is None:
+        out.append(0xC0)
+    elif obj is True:
+        out.append(0xC3)
+    elif obj is False:
+        out.append(0xC2)
+    elif isinstance(obj, int):
+        if 0 <= obj < 0x80:
+            out.append(obj)
+        elif -32 <= obj < 0:
+            out.append(obj & 0xFF)
+        elif 0 <= obj <= 0xFF:
+            out += b"\xcc" + struct.pack(">B", obj)
+        elif 0 <= obj <= 0xFFFF:
+            out += b"\xcd" + struct.pack(">H", obj)
+        elif 0 <= obj <= 0xFFFFFFFF:
+            out += b"\xce" + struct.pack(">I", obj)
+        elif obj > 0:
+            out += b"\xcf" + struct.pack(">Q", obj)
+        else:
+            out += b"\xd3" + struct.pack(">q", obj)
+    elif isinstance(obj, float):
+        # Devices hold floats; float32 keeps payloads the size the firmware sends
+        out += b"\xca" + struct.pack(">f", obj)
+    elif isinstance(obj, str):
+        data = obj.encode("utf-8")
+        n = len(data)
+        if n < 32:
+            out.append(0xA0 | n)
+        elif n <= 0xFF:
+            out += b"\xd9" + struct.pack(">B", n)
+        elif n <= 0xFFFF:
+            out += b"\xda" + struct.pack(">H", n)
+        else:
+            out += b"\xdb" + struct.pack(">I", n)
+        out += data
+    elif isinstance(obj, (list, tuple)):
+        n = len(obj)
+        if n < 16:
+            out.append(0x90 | n)
+        elif n <= 0xFFFF:
+            out += b"\xdc" + struct.pack(">H", n)
+        else:
+            out += b"\xdd" + struct.pack(">I", n)
+        for item in obj:
+            mp_pack(item, out)
+    elif isinstance(obj, dict):
+        n = len(obj)
+        if n < 16:
+            out.append(0x80 | n)
+        elif n <= 0xFFFF:
+            out += b"\xde" + struct.pack(">H", n)
+        else:
+            out += b"\xdf" + struct.pack(">I", n)
+        for key, value in obj.items():
+            mp_pack(key, out)
+            mp_pack(value, out)
+    else:
+        raise TypeError(f"cannot pack {type(obj).__name__}")
+    return out
+
+
+_FIXED = {
+    0xCC: ">B", 0xCD: ">H", 0xCE: ">I", 0xCF: ">Q",
+    0xD0: ">b", 0xD1: ">h", 0xD2: ">i", 0xD3: ">q",
+    0xCA: ">f", 0xCB: ">d",
+}
+
+
+def mp_unpack(data, pos=0):
+    """Decode one value at data[pos:]; returns (value, next_pos)."""
+    b = data[pos]
+    pos += 1
+    if b < 0x80:
+        return b, pos
+    if b >= 0xE0:
+        return b - 0x100, pos
+    if 0xA0 <= b <= 0xBF:
+        n = b & 0x1F
+        return data[pos:pos + n].decode("utf-8", "replace"), pos + n
+    if 0x90 <= b <= 0x9F:
+        return _unpack_array(data, pos, b & 0x0F)
+    if 0x80 <= b <= 0x8F:
+        return _unpack_map(data, pos, b & 0x0F)
+    if b == 0xC0:
+        return None, pos
+    if b in (0xC2, 0xC3):
+        return b == 0xC3, pos
+    if b in _FIXED:
+        fmt = _FIXED[b]
+        size = struct.calcsize(fmt)
+        return struct.unpack_from(fmt, data, pos)[0], pos + size
+    if b in (0xD9, 0xDA, 0xDB):
+        fmt = {0xD9: ">B", 0xDA: ">H", 0xDB: ">I"}[b]
+        n = struct.unpack_from(fmt, data, pos)[0]
+        pos += struct.calcsize(fmt)
+        return data[pos:pos + n].decode("utf-8", "replace"), pos + n
+    if b in (0xDC, 0xDD):
+        fmt = ">H" if b == 0xDC else ">I"
+        n = struct.unpack_from(fmt, data, pos)[0]
+        return _unpack_array(data, pos + struct.calcsize(fmt), n)
+    if b in (0xDE, 0xDF):
+        fmt = ">H" if b == 0xDE else ">I"
+        n = struct.unpack_from(fmt, data, pos)[0]
+        return _unpack_map(data, pos + struct.calcsize(fmt), n)
+    raise ValueError(f"unsupported msgpack type 0x{b:02x}")
+
+
+def _unpack_array(data, pos, n):
+    items = []
+    for _ in range(n):
+        item, pos = mp_unpack(data, pos)
+        items.append(item)
+    return items, pos
+
+
+def _unpack_map(data, pos, n):
+    result = {}
+    for _ in range(n):
+        key, pos = mp_unpack(data, pos)
+        value, pos = mp_unpack(data, pos)
+        result[key] = value
+    return result, pos
+
+
+# ---------------------------------------------------------------- Quotes
+
+def _num(text, strip=("$", ",", "+", "%")):
+    text = str(text or "")
+    for ch in strip:
+        text = text.replace(ch, "")
+    try:
+        return float(text)
+    except ValueError:
+        return 0.0
+
+
+def quote_from_v1(symbol, stock, now):
+    """Numeric quote from a v1 heartbeat entry (display strings)."""
+    price = _num(stock.get("price"))
+    dollar = _num(stock.get("dollarChange"))
+    ohl = str(stock.get("ohl", ""))
+    open_price = 0.0
+    if "O: " in ohl and "H: " in ohl:
+        open_price = _num(ohl[ohl.index("O: ") + 3:ohl.index("H: ")])
+    vol = str(stock.get("volume", "")).replace("Vol: ", "")
+    mult = {"B": 1e9, "M": 1e6, "K": 1e3}.get(vol[-1:], 1.0)
+    volume = _num(vol.rstrip("BMK")) * mult
+    return {
+        "symbol": symbol,
+        "timestamp": int(stock.get("timestamp") or now),
+        "price": price,
+        "prevClose": price - dollar,
+        "open": open_price,
+        "high": float(stock.get("high") or 0),
+        "low": float(stock.get("low") or 0),
+        "volume": volume,
+        "fiftyTwoLow": float(stock.get("fiftyTwoLow") or 0),
+        "fiftyTwoHigh": float(stock.get("fiftyTwoHigh") or 0),
+        "oneMonthLow": float(stock.get("oneMonthLow") or 0),
+        "oneMonthHigh": float(stock.get("oneMonthHigh") or 0),
+        "flags": PQ_FLAG_MARKET_OPEN if stock.get("marketOpen") else 0,
+        "name": str(stock.get("name") or ""),
+    }
+
+
+def quote_from_v2(array):
+    if not isinstance(array, list) or len(array) <= PQ_FIELDS.index("flags"):
+        return None
+    quote = dict(zip(PQ_FIELDS, array))
+    quote.setdefault("name", "")
+    if not quote["symbol"] or not quote["price"]:
+        return None
+    return quote
+
+
+def quote_to_v2(quote):
+    array = [quote[f] for f in PQ_FIELDS[:-1]]
+    if quote.get("name"):
+        array.append(quote["name"])
+    return array
+
+
+def quote_to_v1(quote):
+    price = quote["price"]
+    volume = quote["volume"]
+    if volume >= 1e9:
+        vol = f"Vol: {volume / 1e9:.2f}B"
+    elif volume >= 1e6:
+        vol = f"Vol: {volume / 1e6:.2f}M"
+    elif volume >= 1e3:
+        vol = f"Vol: {volume / 1e3:.1f}K"
+    else:
+        vol = f"Vol: {volume:.0f}"
+    prev = quote["prevClose"]
+    return {
+        "price": f"${price:.2f}",
+        "change": f"{(price - prev) / prev * 100 if prev else 0:+.2f}%",
+        "dollarChange": f"{price - prev:+.2f}",
+        "volume": vol,
+        "ohl": f"O: {quote['open']:.2f}   H: {quote['high']:.2f}   L: {quote['low']:.2f}",
+        "name": quote.get("name", ""),
+        "low": quote["low"],
+        "high": quote["high"],
+        "fiftyTwoLow": quote["fiftyTwoLow"],
+        "fiftyTwoHigh": quote["fiftyTwoHigh"],
+        "oneMonthLow": quote["oneMonthLow"],
+        "oneMonthHigh": quote["oneMonthHigh"],
+        "marketOpen": bool(quote["flags"] & PQ_FLAG_MARKET_OPEN),
+        "timestamp": quote["timestamp"],
+    }
+
+
+# ---------------------------------------------------------------- Registry
+
+class Registry:
+    def __init__(self, wire, clock=time.time):
+        self.wire = wire
+        self.clock = clock  # Injectable so the load simulator can run on simulated time
+        self.lock = threading.Lock()
+        self.nodes = {}    # nodeId -> {"address", "firmware", "wire", "lastSeen"}
+        self.quotes = {}   # symbol -> numeric quote (newest wins)
+        self.stats = {}    # endpoint -> {"requests", "bytesIn", "bytesOut"}
+        self.stats_lock = threading.Lock()  # Counted from _send(), which may run under `lock`
+        self.quote_writes = 0  # Heartbeat entries stored (what the hosted registry pays KV writes for)
+
+    def count(self, endpoint, bytes_in, bytes_out):
+        with self.stats_lock:
+            entry = self.stats.setdefault(endpoint, {"requests": 0, "bytesIn": 0, "bytesOut": 0})
+            entry["requests"] += 1
+            entry["bytesIn"] += bytes_in
+            entry["bytesOut"] += bytes_out
+
+    def expire(self):
+        cutoff = self.clock() - NODE_EXPIRY_SEC
+        for node_id in [n for n, info in self.nodes.items() if info["lastSeen"] < cutoff]:
+            del self.nodes[node_id]
+
+    def store(self, quote):
+        self.quote_writes += 1
+        held = self.quotes.get(quote["symbol"])
+        if held is None or held["timestamp"] <= quote["timestamp"]:
+            self.quotes[quote["symbol"]] = quote
+
+    def fresh(self, symbol, max_age):
+        quote = self.quotes.get(symbol)
+        if quote is None or self.clock() - quote["timestamp"] > max_age:
+            return None
+        return quote
+
+
+class Handler(BaseHTTPRequestHandler):
+    registry = None
+    network_key = ""
+    quiet = False
+    protocol_version = "HTTP/1.1"
+
+    def log_message(self, fmt, *args):
+        if not self.quiet:
+            print(f'[{time.strftime("%H:%M:%S")}] [{self.client_address[0]}] {fmt % args}')
+
+    def _send(self, code, body, content_type="application/json"):
+        if not isinstance(body, (bytes, bytearray)):
+            body = json.dumps(body).encode("utf-8")
+        endpoint = urlparse(self.path).path
+        if endpoint.startswith("/stock/"):
+            endpoint = "/stock"
+        self.registry.count(endpoint, int(self.headers.get("Content-Length") or 0), len(body))
+        self.send_response(code)
+        self.send_header("Content-Type", content_type)
+        self.send_header("Content-Length", str(len(body)))
+        self.end_headers()
+        self.wfile.write(body)
+
+    def _authorized(self):
+        if self.headers.get("X-Network-Key", "") != self.network_key:
+            self._send(401, {"error": "bad network key"})
+            return False
+        return True
+
+    def _body(self):
+        length = int(self.headers.get("Content-Length") or 0)
+        data = self.rfile.read(length) if length else b""
+        if self.headers.get("Content-Type", "").startswith(MSGPACK_TYPE):
+            return mp_unpack(data)[0] if data else {}
+        return json.loads(data or b"{}")
+
+    def _wants_msgpack(self):
+        return MSGPACK_TYPE in self.headers.get("Accept", "") and self.registry.wire >= WIRE_V2_MSGPACK
+
+    def do_POST(self):
+        if not self._authorized():
+            return
+        path = urlparse(self.path).path
+        try:
+            body = self._body()
+        except (ValueError, IndexError, struct.error) as e:
+            self._send(400, {"error": f"bad body: {e}"})
+            return
+        reg = self.registry
+        with reg.lock:
+            reg.expire()
+            if path == "/register":
+                offered = body.get("wire") or [WIRE_V1_JSON]
+                wire = max([v for v in offered if v <= reg.wire] or [WIRE_V1_JSON])
+                reg.nodes[body.get("nodeId", "")] = {
+                    "address": body.get("address", self.client_address[0]),
+                    "firmware": body.get("firmwareVersion", ""),
+                    "wire": wire,
+                    "lastSeen": reg.clock(),
+                }
+                resp = {"success": True, "nodesOnline": len(reg.nodes)}
+                if reg.wire >= WIRE_V2_MSGPACK:
+                    resp["wire"] = wire  # Old registries don't send this; clients stay on v1
+                self._send(200, resp)
+            elif path == "/heartbeat":
+                node = reg.nodes.get(body.get("nodeId", ""))
+                if node is None:
+                    self._send(404, {"error": "unknown node"})
+                    return
+                node["lastSeen"] = reg.clock()
+                for array in body.get("quotes", []):
+                    quote = quote_from_v2(array)
+                    if quote:
+                        reg.store(quote)
+                for symbol, stock in (body.get("stockData") or {}).items():
+                    reg.store(quote_from_v1(symbol, stock, reg.clock()))
+                self._send(200, {"success": True, "nodesOnline": len(reg.nodes),
+                                 "stocksCached": len(reg.quotes)})
+            else:
+                self._send(404, {"error": "not found"})
+
+    def do_GET(self):
+        if not self._authorized():
+            return
+        url = urlparse(self.path)
+        reg = self.registry
+        if url.path.startswith("/stock/"):
+            symbol = url.path[len("/stock/"):].upper()
+            with reg.lock:
+                quote = reg.fresh(symbol, MAX_AGE_SEC)
+            if self._wants_msgpack():
+                resp = {"found": quote is not None}
+                if quote:
+                    resp["q"] = quote_to_v2(quote)
+                self._send(200, mp_pack(resp), MSGPACK_TYPE)
+            elif quote is None:
+                self._send(200, {"found": False})
+            else:
+                self._send(200, {"found": True, "ageSeconds": int(reg.clock() - quote["timestamp"]),
+                                 "data": quote_to_v1(quote)})
+        elif url.path == "/stocks":
+            if reg.wire < WIRE_V2_MSGPACK:
+                self._send(404, {"error": "bulk lookups need wire v2"})
+                return
+            query = parse_qs(url.query)
+            symbols = [s.strip().upper() for s in ",".join(query.get("symbols", [])).split(",") if s.strip()]
+            max_age = min(int((query.get("age") or [MAX_AGE_SEC])[0]), MAX_AGE_SEC)
+            with reg.lock:
+                found = [q for q in (reg.fresh(s, max_age) for s in symbols[:BULK_MAX_SYMBOLS]) if q]
+            body = mp_pack({"v": WIRE_V2_MSGPACK, "n": len(found)})
+            for quote in found:
+                mp_pack(quote_to_v2(quote), body)
+            self._send(200, body, MSGPACK_TYPE)
+        else:
+            self._send(404, {"error": "not found"})
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Local P2P registry stand-in")
+    parser.add_argument("--port", type=int, default=8787)
+    parser.add_argument("--key", default="your-network-secret", help="P2P_NETWORK_KEY devices send")
+    parser.add_argument("--wire", type=int, choices=(1, 2), default=WIRE_V2_MSGPACK,
+                        help="highest wire version to offer (1 emulates the original registry)")
+    args = parser.parse_args()
+
+    Handler.registry = Registry(args.wire)
+    Handler.network_key = args.key
+    server = ThreadingHTTPServer(("", args.port), Handler)
+    print(f"P2P registry stand-in on port {args.port} (wire v{args.wire})...")
+    server.serve_forever()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,381 @@
+"""Multi-node load simulator for the P2P registry.
+
+Runs the device-side P2P client logic from src/main.cpp for hundreds of
+simulated tickers against tools/p2p_registry.py over real HTTP on localhost,
+on a simulated clock, so a full trading session takes seconds to minutes:
+
+  - /register at boot (staggered), wire negotiation
+  - rotation through a Zipf-popular watchlist; a stale or missing quote is
+    looked up with /stock/{symbol}, and an API call is made only on a miss
+  - bulk warm-up with /stocks once per quote TTL
+  - delta or full heartbeats, sent shortly after local fetches with a
+    10-minute keep-alive (or on the original fixed 10-minute timer)
+
+Freshness windows mirror FRESHNESS_POLICY during market hours. The LAN
+transport is out of scope: every node behaves as if it were alone on its
+network.
+
+Reports request rates, payload sizes, registry quote writes and hit ratios:
+
+  python tools/p2p_sim.py --nodes 200 --hours 6.5
+  python tools/p2p_sim.py --nodes 200 --wire 1 --no-bulk --no-delta --fixed-heartbeat   # original client
+"""
+import argparse
+import heapq
+import http.client
+import json
+import random
+import threading
+import zlib
+from http.server import ThreadingHTTPServer
+from urllib.parse import quote as urlquote
+
+import p2p_registry as reg
+
+QUOTE_TTL_SEC = 120          # FIELD_QUOTE, market open
+PEER_TTL_SEC = 900           # FIELD_PEER_QUOTE
+HEARTBEAT_SETTLE_SEC = 10    # P2P_HEARTBEAT_SETTLE_MS
+HEARTBEAT_MIN_GAP_SEC = 60   # P2P_HEARTBEAT_MIN_GAP_MS
+HEARTBEAT_KEEPALIVE_SEC = 600  # P2P_HEARTBEAT_KEEPALIVE_MS (also the old fixed interval)
+HEARTBEAT_POLL_SEC = 5       # How often the simulated loop() checks whether one is due
+FULL_SYNC_EVERY = 6          # P2P_FULL_SYNC_EVERY
+BULK_MAX_SYMBOLS = 20
+EPOCH_START = 1_790_000_000  # Simulated session start (market open)
+NETWORK_KEY = "sim-network"
+
+
+class Clock:
+    def __init__(self):
+        self.now = float(EPOCH_START)
+
+    def __call__(self):
+        return self.now
+
+
+class Metrics:
+    def __init__(self):
+        self.endpoints = {}   # name -> [requests, bytes_out, bytes_in]
+        self.per_minute = {}  # minute -> requests
+        self.rotations = 0
+        self.local_hits = 0
+        self.lookups = 0
+        self.lookup_hits = 0
+        self.bulk_covered = 0
+        self.bulk_requested = 0
+        self.bulk_returned = 0
+        self.api_calls = 0
+        self.served = 0
+        self.served_age = 0.0
+
+    def request(self, name, minute, sent, received):
+        entry = self.endpoints.setdefault(name, [0, 0, 0])
+        entry[0] += 1
+        entry[1] += sent
+        entry[2] += received
+        self.per_minute[minute] = self.per_minute.get(minute, 0) + 1
+
+
+class Node:
+    def __init__(self, index, sim, symbols, rotation_sec):
+        self.node_id = f"SIM{index:09X}"
+        self.sim = sim
+        self.symbols = symbols
+        self.rotation_sec = rotation_sec
+        self.rotation_index = 0
+        self.wire = reg.WIRE_V1_JSON
+        self.registered = False
+        self.bulk_supported = True
+        self.cache = {}        # symbol -> {"quote", "fetched", "version"}
+        self.version = 0
+        self.acked_version = 0
+        self.since_full = 0
+        self.bulk_symbols = ()
+        self.bulk_at = None
+        self.last_heartbeat = None
+        self.pending_since = None
+
+    # ------------------------------------------------------------ transport
+
+    def http(self, method, path, body=None, content_type="application/json", accept=None):
+        headers = {"X-Network-Key": NETWORK_KEY}
+        if body is not None:
+            headers["Content-Type"] = content_type
+        if accept:
+            headers["Accept"] = accept
+        conn = http.client.HTTPConnection("127.0.0.1", self.sim.port, timeout=10)
+        conn.request(method, path, body=body, headers=headers)
+        resp = conn.getresponse()
+        data = resp.read()
+        conn.close()
+        name = "/stock" if path.startswith("/stock/") else path.split("?")[0]
+        self.sim.metrics.request(name, int((self.sim.clock.now - EPOCH_START) // 60),
+                                 len(body or b""), len(data))
+        return resp.status, resp.getheader("Content-Type", ""), data
+
+    # ------------------------------------------------------------ cache
+
+    def store(self, quote, fetched, from_peer=False):
+        held = self.cache.get(quote["symbol"])
+        if held is not None and held["fetched"] >= fetched:
+            return False
+        if not from_peer:
+            self.version += 1
+        # cacheSymbolData(): peer entries get version 0, so delta heartbeats skip them
+        self.cache[quote["symbol"]] = {"quote": quote, "fetched": fetched,
+                                       "version": 0 if from_peer else self.version}
+        return True
+
+    def fresh(self, symbol, ttl):
+        held = self.cache.get(symbol)
+        return held is not None and self.sim.clock.now - held["fetched"] <= ttl
+
+    def api_fetch(self, symbol):
+        self.sim.metrics.api_calls += 1
+        now = self.sim.clock.now
+        self.store(self.sim.market_quote(symbol, int(now)), now)
+
+    # ------------------------------------------------------------ P2P client
+
+    def register(self):
+        body = json.dumps({"nodeId": self.node_id, "address": "10.0.0.1", "firmwareVersion": "sim",
+                           "wire": self.sim.wire_offer, "symbols": self.symbols}).encode()
+        status, _, data = self.http("POST", "/register", body)
+        if status != 200:
+            return
+        resp = json.loads(data)
+        wire = resp.get("wire", reg.WIRE_V1_JSON)
+        self.wire = wire if wire in self.sim.wire_offer else reg.WIRE_V1_JSON
+        self.registered = True
+        self.acked_version = 0
+        self.last_heartbeat = self.sim.clock.now
+        self.warm()
+
+    def lookup(self, symbol):
+        """p2pFetchStock(): one /stock round trip, unless a recent bulk lookup covered it."""
+        now = self.sim.clock.now
+        if self.bulk_at is not None and now - self.bulk_at <= QUOTE_TTL_SEC and symbol in self.bulk_symbols:
+            if not self.fresh(symbol, QUOTE_TTL_SEC):
+                return False
+            self.sim.metrics.bulk_covered += 1
+            return True
+        self.sim.metrics.lookups += 1
+        accept = reg.MSGPACK_TYPE if self.wire >= reg.WIRE_V2_MSGPACK else None
+        status, ctype, data = self.http("GET", "/stock/" + urlquote(symbol), accept=accept)
+        if status != 200:
+            return False
+        now = self.sim.clock.now
+        if ctype.startswith(reg.MSGPACK_TYPE):
+            resp = reg.mp_unpack(data)[0]
+            quote = reg.quote_from_v2(resp.get("q")) if resp.get("found") else None
+            if quote is None or now - quote["timestamp"] > PEER_TTL_SEC:
+                return False
+            self.store(quote, quote["timestamp"], from_peer=True)
+            self.sim.metrics.served_age += now - quote["timestamp"]
+        else:
+            resp = json.loads(data)
+            if not resp.get("found") or resp.get("ageSeconds", 9999) > PEER_TTL_SEC:
+                return False
+            fetched = now - resp["ageSeconds"]
+            self.store(reg.quote_from_v1(symbol, resp["data"], int(fetched)), fetched, from_peer=True)
+            self.sim.metrics.served_age += resp["ageSeconds"]
+        self.sim.metrics.served += 1
+        self.sim.metrics.lookup_hits += 1
+        return True
+
+    def warm(self):
+        """p2pWarmRotation(): one /stocks request for every stale rotation symbol."""
+        if not self.sim.bulk or not self.bulk_supported or self.wire < reg.WIRE_V2_MSGPACK:
+            return
+        wanted = [s for s in self.symbols if not self.fresh(s, QUOTE_TTL_SEC)][:BULK_MAX_SYMBOLS]
+        if not wanted:
+            return
+        path = f"/stocks?age={PEER_TTL_SEC}&symbols=" + ",".join(urlquote(s) for s in wanted)
+        status, _, data = self.http("GET", path, accept=reg.MSGPACK_TYPE)
+        if status == 404:
+            self.bulk_supported = False
+            return
+        self.sim.metrics.bulk_requested += len(wanted)
+        self.bulk_symbols, self.bulk_at = tuple(wanted), self.sim.clock.now
+        header, pos = reg.mp_unpack(data)
+        for _ in range(header.get("n", 0)):
+            array, pos = reg.mp_unpack(data, pos)
+            quote = reg.quote_from_v2(array)
+            if quote and self.sim.clock.now - quote["timestamp"] <= PEER_TTL_SEC:
+                self.store(quote, quote["timestamp"], from_peer=True)
+                self.sim.metrics.bulk_returned += 1
+                self.sim.metrics.served += 1
+                self.sim.metrics.served_age += self.sim.clock.now - quote["timestamp"]
+
+    def heartbeat_tick(self):
+        """p2pHeartbeatDue(): shortly after unsent local fetches, else a keep-alive."""
+        now = self.sim.clock.now
+        since_last = now - self.last_heartbeat if self.last_heartbeat is not None else float("inf")
+        if self.sim.fixed_heartbeat:
+            due = since_last >= HEARTBEAT_KEEPALIVE_SEC
+        else:
+            due = False
+            if self.version > self.acked_version:
+                if self.pending_since is None:
+                    self.pending_since = now
+                due = now - self.pending_since >= HEARTBEAT_SETTLE_SEC and since_last >= HEARTBEAT_MIN_GAP_SEC
+            else:
+                self.pending_since = None
+            due = due or since_last >= HEARTBEAT_KEEPALIVE_SEC  # The simulated session is all market hours
+        if due:
+            self.heartbeat()
+            self.last_heartbeat = now
+
+    def heartbeat(self):
+        """p2pHeartbeat(): delta since the last acknowledged heartbeat, or full."""
+        if not self.registered:
+            self.register()
+            return
+        full = not self.sim.delta or self.acked_version == 0 or self.since_full + 1 >= FULL_SYNC_EVERY
+        sending = self.version
+        now = self.sim.clock.now
+        entries = [e for e in self.cache.values()
+                   if (full or e["version"] > self.acked_version) and now - e["fetched"] <= PEER_TTL_SEC]
+        if self.wire >= reg.WIRE_V2_MSGPACK:
+            doc = {"nodeId": self.node_id, "v": reg.WIRE_V2_MSGPACK, "full": full,
+                   "quotes": [reg.quote_to_v2(e["quote"]) for e in entries]}
+            body, ctype = bytes(reg.mp_pack(doc)), reg.MSGPACK_TYPE
+        else:
+            stock_data = {}
+            for e in entries:
+                v1 = reg.quote_to_v1(e["quote"])
+                v1["timestamp"] = int(e["fetched"])
+                stock_data[e["quote"]["symbol"]] = v1
+            doc = {"nodeId": self.node_id, "full": full, "stockData": stock_data}
+            body, ctype = json.dumps(doc).encode(), "application/json"
+        status, _, _ = self.http("POST", "/heartbeat", body, ctype)
+        if status == 200:
+            self.acked_version = sending
+            self.since_full = 0 if full else self.since_full + 1
+        elif status == 404:
+            self.registered = False
+
+    def rotate(self):
+        """Rotation tick: prefetchStockData() with stale-while-revalidate."""
+        symbol = self.symbols[self.rotation_index % len(self.symbols)]
+        self.rotation_index += 1
+        self.sim.metrics.rotations += 1
+        if self.fresh(symbol, QUOTE_TTL_SEC):
+            self.sim.metrics.local_hits += 1
+            return
+        if self.registered and self.lookup(symbol):
+            return
+        self.api_fetch(symbol)
+
+
+class Simulation:
+    def __init__(self, args):
+        self.args = args
+        self.rng = random.Random(args.seed)
+        self.clock = Clock()
+        self.metrics = Metrics()
+        self.wire_offer = [reg.WIRE_V1_JSON] if args.wire == 1 else [reg.WIRE_V1_JSON, reg.WIRE_V2_MSGPACK]
+        self.bulk = args.bulk
+        self.delta = args.delta
+        self.fixed_heartbeat = args.fixed_heartbeat
+        self.universe = [f"S{i:03d}" for i in range(args.universe)]
+        self.weights = [1.0 / (rank + 1) ** args.zipf for rank in range(args.universe)]
+        self.events = []
+        self.seq = 0
+
+        self.registry = reg.Registry(args.wire, clock=self.clock)
+        handler = type("SimHandler", (reg.Handler,), {"registry": self.registry,
+                                                       "network_key": NETWORK_KEY, "quiet": True})
+        self.server = ThreadingHTTPServer(("127.0.0.1", 0), handler)
+        self.port = self.server.server_address[1]
+        threading.Thread(target=self.server.serve_forever, daemon=True).start()
+
+    def market_quote(self, symbol, ts):
+        base = 20 + (zlib.crc32(symbol.encode()) % 480)
+        price = round(base * (1 + 0.01 * self.rng.uniform(-1, 1)), 2)
+        return {"symbol": symbol, "timestamp": ts, "price": price, "prevClose": base, "open": base,
+                "high": price * 1.01, "low": price * 0.99, "volume": float(self.rng.randint(10**5, 10**8)),
+                "fiftyTwoLow": base * 0.7, "fiftyTwoHigh": base * 1.3, "oneMonthLow": base * 0.9,
+                "oneMonthHigh": base * 1.1, "flags": reg.PQ_FLAG_MARKET_OPEN, "name": ""}
+
+    def schedule(self, at, node, action, period):
+        heapq.heappush(self.events, (at, self.seq, node, action, period))
+        self.seq += 1
+
+    def run(self):
+        args = self.args
+        for i in range(args.nodes):
+            count = self.rng.randint(args.min_symbols, args.max_symbols)
+            symbols = []
+            while len(symbols) < count:
+                pick = self.rng.choices(self.universe, self.weights)[0]
+                if pick not in symbols:
+                    symbols.append(pick)
+            node = Node(i, self, symbols, self.rng.choice(args.rotation_minutes) * 60)
+            boot = self.rng.uniform(0, 60)
+            self.schedule(EPOCH_START + boot, node, Node.register, None)
+            self.schedule(EPOCH_START + boot + 1, node, Node.rotate, node.rotation_sec)
+            self.schedule(EPOCH_START + boot + HEARTBEAT_POLL_SEC, node, Node.heartbeat_tick, HEARTBEAT_POLL_SEC)
+            if self.bulk:
+                self.schedule(EPOCH_START + boot + QUOTE_TTL_SEC, node, Node.warm, QUOTE_TTL_SEC)
+
+        end = EPOCH_START + args.hours * 3600
+        while self.events and self.events[0][0] < end:
+            at, _, node, action, period = heapq.heappop(self.events)
+            self.clock.now = at
+            action(node)
+            if period:
+                self.schedule(at + period, node, action, period)
+        self.server.shutdown()
+
+    def report(self):
+        m, args = self.metrics, self.args
+        seconds = args.hours * 3600
+        total = sum(e[0] for e in m.endpoints.values())
+        print(f"{args.nodes} nodes, {args.hours:g} h, {args.universe} symbols (zipf {args.zipf}), "
+              f"wire v{args.wire}, bulk {'on' if self.bulk else 'off'}, heartbeat {'delta' if self.delta else 'full'} "
+              f"{'every 10 min' if self.fixed_heartbeat else 'after fetches'}")
+        print(f"{'endpoint':<12}{'requests':>10}{'req/s':>9}{'avg up B':>10}{'avg down B':>12}{'total KB':>10}")
+        for name, (count, sent, received) in sorted(m.endpoints.items()):
+            print(f"{name:<12}{count:>10}{count / seconds:>9.2f}{sent / count:>10.0f}{received / count:>12.0f}"
+                  f"{(sent + received) / 1024:>10.0f}")
+        peak = max(m.per_minute.values()) if m.per_minute else 0
+        print(f"{'all':<12}{total:>10}{total / seconds:>9.2f}   peak {peak / 60:.2f} req/s (busiest minute)")
+        print(f"registry quote writes: {self.registry.quote_writes} ({self.registry.quote_writes / seconds:.2f}/s)")
+
+        def ratio(a, b):
+            return f"{100.0 * a / b:.1f}%" if b else "n/a"
+        print(f"rotations {m.rotations}: local cache hits {ratio(m.local_hits, m.rotations)}, "
+              f"covered by bulk {ratio(m.bulk_covered, m.rotations)}, "
+              f"registry lookups {m.lookups} found {ratio(m.lookup_hits, m.lookups)}")
+        if m.served:
+            print(f"quotes served by the registry: {m.served}, average age {m.served_age / m.served:.0f} s")
+        if m.bulk_requested:
+            print(f"bulk warm: {m.bulk_returned}/{m.bulk_requested} symbols served ({ratio(m.bulk_returned, m.bulk_requested)})")
+        print(f"API calls {m.api_calls} ({m.api_calls / (args.nodes * args.hours):.1f} per node-hour)")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="P2P registry load simulator")
+    parser.add_argument("--nodes", type=int, default=200)
+    parser.add_argument("--hours", type=float, default=1.0, help="simulated market-hours duration")
+    parser.add_argument("--universe", type=int, default=80, help="distinct symbols across all nodes")
+    parser.add_argument("--zipf", type=float, default=1.1, help="symbol popularity skew")
+    parser.add_argument("--min-symbols", type=int, default=3)
+    parser.add_argument("--max-symbols", type=int, default=12)
+    parser.add_argument("--rotation-minutes", type=int, nargs="+", default=[1, 2, 5],
+                        help="rotation intervals to pick from per node")
+    parser.add_argument("--wire", type=int, choices=(1, 2), default=2)
+    parser.add_argument("--no-bulk", dest="bulk", action="store_false")
+    parser.add_argument("--no-delta", dest="delta", action="store_false")
+    parser.add_argument("--fixed-heartbeat", action="store_true",
+                        help="heartbeat on the original fixed 10-minute timer")
+    parser.add_argument("--seed", type=int, default=1)
+    args = parser.parse_args()
+
+    sim = Simulation(args)
+    sim.run()
+    sim.report()
+
+
+if __name__ == "__main__":
+    main()
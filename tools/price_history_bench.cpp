@@ -0,0 +1,97 @@
+// price_history_bench.cpp - Host benchmark for the price history codec
+//
+// Build and run from the repo root:
+//   g++ -O2 -std=c++17 -Isrc tools/price_history_bench.cpp src/price_history.cpp -o /tmp/ph_bench
+//   /tmp/ph_bench [days]
+//
+// Generates synthetic intraday ticks (6.5h sessions, 1-minute cadence with
+// occasional jitter/gaps, random-walk price rounded to cents), encodes them into
+// 2 KB blocks as the device does, verifies a lossless round trip and reports
+// bytes/point and decode throughput.
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "price_history.h"
+
+struct Point {
+  uint32_t ts;
+  float price;
+};
+
+static std::vector<Point> generate(int days, float start, float volatility, uint32_t seed) {
+  std::mt19937 rng(seed);
+  std::normal_distribution<double> step(0.0, volatility);
+  std::uniform_int_distribution<int> jitter(0, 99);
+  std::vector<Point> pts;
+  double price = start;
+  uint32_t dayStart = 1760103000;  // 09:30 ET on a weekday
+  for (int d = 0; d < days; d++) {
+    uint32_t ts = dayStart + (uint32_t)d * 86400;
+    for (int m = 0; m < 390; m++) {
+      int j = jitter(rng);
+      ts += 60;
+      if (j < 5) ts += 1 + j;            // Late poll
+      if (j == 99) { ts += 180; m += 3; } // Missed a few polls
+      price = std::max(1.0, price + price * step(rng));
+      pts.push_back({ts, (float)(std::round(price * 100.0) / 100.0)});
+    }
+  }
+  return pts;
+}
+
+static void run(const char *label, const std::vector<Point> &pts) {
+  PriceSeries series;
+  series.init(2048, PriceSeries::MAX_BLOCKS, malloc, free);
+  size_t stored = 0;
+  for (const Point &p : pts) {
+    if (series.append(p.ts, p.price)) stored++;
+  }
+
+  // Round-trip check (the ring may have dropped the oldest blocks).
+  size_t offset = pts.size() - series.count();
+  size_t idx = offset;
+  bool ok = true;
+  series.forEach([&](uint32_t ts, float price) {
+    if (idx >= pts.size() || pts[idx].ts != ts || pts[idx].price != price) {
+      ok = false;
+      return false;
+    }
+    idx++;
+    return true;
+  });
+  ok = ok && idx == pts.size();
+
+  const int iterations = 50;
+  volatile uint32_t sink = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++) {
+    series.forEach([&](uint32_t ts, float price) {
+      sink = sink + ts + (uint32_t)price;
+      return true;
+    });
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  double secs = std::chrono::duration<double>(t1 - t0).count();
+  double decodedPts = (double)series.count() * iterations;
+
+  double bpp = (double)series.bytesUsed() / (double)series.count();
+  printf("%-22s points=%-6zu retained=%-6zu bytes=%-7zu %.2f B/pt (raw 8.00, %.1fx)  decode %.1f Mpts/s  %s\n",
+         label, pts.size(), series.count(), series.bytesUsed(), bpp, 8.0 / bpp,
+         decodedPts / secs / 1e6, ok ? "OK" : "MISMATCH");
+  (void)stored;
+}
+
+int main(int argc, char **argv) {
+  int days = argc > 1 ? atoi(argv[1]) : 10;
+  if (days < 1) days = 1;
+  run("large cap ($480)", generate(days, 480.0f, 0.0006, 1));
+  run("mid cap ($72)", generate(days, 72.0f, 0.0010, 2));
+  run("penny ($3.10)", generate(days, 3.10f, 0.0030, 3));
+  run("flat ETF ($100)", generate(days, 100.0f, 0.00005, 4));
+  return 0;
+}
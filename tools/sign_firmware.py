@@ -0,0 +1,114 @@
+"""Release signature for LAN firmware distribution.
+
+Tickers only pass an image on to their LAN peers when it carries a signature
+from the release key (see src/lan_ota.h). The signature is ECDSA P-256 over
+SHA-256("<version>:<sha256 of firmware.bin in hex>"), DER-encoded and written
+as one line of hex:
+
+  firmware.bin.sig   publish next to firmware.bin in each GitHub release
+
+The private key never goes near a device; only its public half is built in,
+as LAN_OTA_PUBLIC_KEY in include/config.h. One-time setup:
+
+  openssl ecparam -name prime256v1 -genkey -noout -out release-key.pem
+  python tools/sign_firmware.py --pubkey release-key.pem   # paste into config.h
+
+Standalone:   python tools/sign_firmware.py release-key.pem firmware.bin [version]
+              python tools/sign_firmware.py --check release-key.pem firmware.bin.sig firmware.bin [version]
+PlatformIO:   listed in extra_scripts; writes $BUILD_DIR/firmware.bin.sig
+              after every firmware.bin build when custom_ota_signing_key is set.
+The version defaults to FIRMWARE_VERSION in src/main.cpp. Needs openssl.
+"""
+import hashlib
+import os
+import re
+import subprocess
+import sys
+import tempfile
+
+SIG_SUFFIX = ".sig"
+
+
+def firmware_version(main_cpp):
+    with open(main_cpp, encoding="utf-8") as f:
+        match = re.search(r'#define\s+FIRMWARE_VERSION\s+"([^"]+)"', f.read())
+    if match is None:
+        raise ValueError("no FIRMWARE_VERSION in %s" % main_cpp)
+    return match.group(1)
+
+
+def signed_message(image, version):
+    return ("%s:%s" % (version, hashlib.sha256(image).hexdigest())).encode("ascii")
+
+
+def _openssl(args, message):
+    return subprocess.run(["openssl"] + args, input=message, stdout=subprocess.PIPE, check=True).stdout
+
+
+def public_key_pem(key_path):
+    return _openssl(["pkey", "-in", key_path, "-pubout"], None).decode("ascii")
+
+
+def write_signature(key_path, image_path, version):
+    with open(image_path, "rb") as f:
+        image = f.read()
+    sig = _openssl(["dgst", "-sha256", "-sign", key_path], signed_message(image, version))
+    sig_path = image_path + SIG_SUFFIX
+    with open(sig_path, "w") as f:
+        f.write(sig.hex() + "\n")
+    return sig_path
+
+
+def check_signature(key_path, sig_path, image_path, version):
+    with open(image_path, "rb") as f:
+        image = f.read()
+    with open(sig_path) as f:
+        sig = bytes.fromhex(f.read().strip())
+    with tempfile.TemporaryDirectory() as tmp:
+        pub_path = os.path.join(tmp, "pub.pem")
+        with open(pub_path, "w") as f:
+            f.write(public_key_pem(key_path))
+        sig_bin = os.path.join(tmp, "sig.der")
+        with open(sig_bin, "wb") as f:
+            f.write(sig)
+        result = subprocess.run(["openssl", "dgst", "-sha256", "-verify", pub_path, "-signature", sig_bin],
+                                input=signed_message(image, version), stdout=subprocess.PIPE)
+    return result.returncode == 0
+
+
+def _config_define(pem):
+    lines = ['"%s\\n"' % line for line in pem.strip().splitlines()]
+    return "#define LAN_OTA_PUBLIC_KEY \\\n  " + " \\\n  ".join(lines)
+
+
+try:
+    Import("env")  # noqa: F821 - provided by PlatformIO/SCons
+except NameError:
+    env = None
+
+if env is not None:
+    _key = env.GetProjectOption("custom_ota_signing_key", "")
+    if _key:
+        _key = os.path.join(env.subst("$PROJECT_DIR"), _key)
+        _version = firmware_version(os.path.join(env.subst("$PROJECT_SRC_DIR"), "main.cpp"))
+
+        def _sign_action(target, source, env):
+            print("signature: v%s -> %s" % (_version, write_signature(_key, str(target[0]), _version)))
+
+        env.AddPostAction("$BUILD_DIR/${PROGNAME}.bin", _sign_action)
+elif __name__ == "__main__":
+    _main_cpp = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "src", "main.cpp")
+    if len(sys.argv) == 3 and sys.argv[1] == "--pubkey":
+        print(_config_define(public_key_pem(sys.argv[2])))
+    elif len(sys.argv) in (5, 6) and sys.argv[1] == "--check":
+        version = sys.argv[5] if len(sys.argv) == 6 else firmware_version(_main_cpp)
+        if not check_signature(sys.argv[2], sys.argv[3], sys.argv[4], version):
+            print("%s: BAD signature for v%s" % (sys.argv[3], version))
+            sys.exit(1)
+        print("%s: OK for v%s" % (sys.argv[3], version))
+    elif len(sys.argv) in (3, 4):
+        version = sys.argv[3] if len(sys.argv) == 4 else firmware_version(_main_cpp)
+        print("signature: v%s -> %s" % (version, write_signature(sys.argv[1], sys.argv[2], version)))
+    else:
+        print(__doc__)
+        sys.exit(1)
@@ -0,0 +1,101 @@
+"""Symbol metadata table builder.
+
+Packs tools/symbols.csv into the fixed-record binary image that the firmware
+maps from the "symbols" flash partition (see src/symbol_table.h):
+
+  header (16 bytes): magic "SYMT", u16 version, u16 record size, u32 count, u32 crc32(records)
+  records (64 bytes each, sorted by symbol for binary search):
+    char symbol[8]  char exchange[10]  u8 assetType  u8 reserved  char name[44]
+
+Standalone:   python tools/symbol_table.py [symbols.csv] [out.bin]
+PlatformIO:   listed in extra_scripts; builds $BUILD_DIR/symbols.bin and adds
+              the "upload_symbols" target (pio run -t upload_symbols).
+"""
+import csv
+import os
+import struct
+import zlib
+
+MAGIC = b"SYMT"
+VERSION = 1
+RECORD_SIZE = 64
+PARTITION_NAME = "symbols"
+ASSET_TYPES = {"stock": 1, "etf": 2, "adr": 3, "index": 4}
+
+SYMBOL_LEN = 8
+EXCHANGE_LEN = 10
+NAME_LEN = 44
+
+
+def _field(text, size):
+    data = text.encode("ascii", "replace")[: size - 1]
+    return data + b"\0" * (size - len(data))
+
+
+def build_table(csv_path):
+    rows = {}
+    with open(csv_path, newline="", encoding="utf-8") as f:
+        for row in csv.DictReader(f):
+            symbol = row["symbol"].strip().upper()
+            if not symbol or len(symbol) >= SYMBOL_LEN:
+                raise ValueError("bad symbol %r in %s" % (symbol, csv_path))
+            rows[symbol] = row
+
+    records = b""
+    for symbol in sorted(rows):  # byte-wise order, matches strncmp() on device
+        row = rows[symbol]
+        records += (_field(symbol, SYMBOL_LEN)
+                    + _field(row["exchange"].strip(), EXCHANGE_LEN)
+                    + struct.pack("<BB", ASSET_TYPES.get(row["type"].strip().lower(), 0), 0)
+                    + _field(row["name"].strip(), NAME_LEN))
+
+    header = MAGIC + struct.pack("<HHII", VERSION, RECORD_SIZE, len(rows), zlib.crc32(records))
+    return header + records
+
+
+def partition_offset(partitions_csv, name=PARTITION_NAME):
+    with open(partitions_csv, encoding="utf-8") as f:
+        for line in f:
+            line = line.split("#", 1)[0].strip()
+            cols = [c.strip() for c in line.split(",")]
+            if len(cols) >= 5 and cols[0] == name:
+                return int(cols[3], 0), int(cols[4], 0)
+    raise ValueError("no %r partition in %s" % (name, partitions_csv))
+
+
+def write_table(csv_path, out_path):
+    image = build_table(csv_path)
+    with open(out_path, "wb") as f:
+        f.write(image)
+    return image
+
+
+try:
+    Import("env")  # noqa: F821 - provided by PlatformIO/SCons
+except NameError:
+    env = None
+
+if env is not None:
+    project_dir = env.subst("$PROJECT_DIR")
+    build_dir = env.subst("$BUILD_DIR")
+    os.makedirs(build_dir, exist_ok=True)
+    out_bin = os.path.join(build_dir, "symbols.bin")
+    image = write_table(os.path.join(project_dir, "tools", "symbols.csv"), out_bin)
+    offset, size = partition_offset(os.path.join(project_dir, env.GetProjectOption("board_build.partitions")))
+    if len(image) > size:
+        raise ValueError("symbols.bin (%d bytes) exceeds partition size %d" % (len(image), size))
+    print("Symbol table: %d records -> %s (partition @0x%x)" % ((len(image) - 16) // RECORD_SIZE, out_bin, offset))
+    env.AddCustomTarget(
+        name="upload_symbols",
+        dependencies=None,
+        actions=['"$PYTHONEXE" "$UPLOADER" --chip esp32s3 write_flash 0x%x "%s"' % (offset, out_bin)],
+        title="Upload symbol table",
+        description="Flash the symbol metadata table into the 'symbols' partition",
+    )
+elif __name__ == "__main__":
+    import sys
+    here = os.path.dirname(os.path.abspath(__file__))
+    src = sys.argv[1] if len(sys.argv) > 1 else os.path.join(here, "symbols.csv")
+    dst = sys.argv[2] if len(sys.argv) > 2 else "symbols.bin"
+    image = write_table(src, dst)
+    print("%d records, %d bytes -> %s" % ((len(image) - 16) // RECORD_SIZE, len(image), dst))